@@ -4,6 +4,11 @@
 
 #include "devavxprng.h"
 #include "dSFMTAVX2search.hpp"
+#include "PolynomialContext.hpp"
+#include "PolynomialEvaluation.hpp"
+#include "GF2Matrix.hpp"
+#include <vector>
+#include <string>
 //#include "Annihilate.hpp"
 #include <errno.h>
 #include <stdlib.h>
@@ -15,13 +20,16 @@
 #include <MTToolBox/AlgorithmReducibleRecursionSearch.hpp>
 
 namespace MTToolBox {
-    template<typename G, typename U>
-    U calc_fixpoint(const G& dsfmt, const NTL::GF2X& irreducible,
-                         const NTL::GF2X& quotient)
+    /**
+     * \b dsfmt_const becomes the constant of the transition projected
+     * to the irreducible part.
+     */
+    template<typename G>
+    void project_const(G& dsfmt_const, const NTL::GF2X& irreducible,
+                       const NTL::GF2X& quotient)
     {
         using namespace std;
         GF2X a, b, d;
-        G dsfmt_const(dsfmt);
         /* a*irreducible + b*quotient = d */
         XGCD(d, a, b, irreducible, quotient);
         if (deg(d) != 0) {
@@ -32,7 +40,17 @@ namespace MTToolBox {
         a *= irreducible;
         dsfmt_const.setConst();
         //Annihilate<G> annihilate;
-        annihilate<U>(&dsfmt_const, b);
+        window_annihilate(&dsfmt_const, b);
+    }
+
+    template<typename G, typename U>
+    U calc_fixpoint(const G& dsfmt, const NTL::GF2X& irreducible,
+                         const NTL::GF2X& quotient)
+    {
+        using namespace std;
+        GF2X a, b, d;
+        G dsfmt_const(dsfmt);
+        project_const(dsfmt_const, irreducible, quotient);
 
         GF2X t1(1, 1);
         SetCoeff(t1, 0);
@@ -45,8 +63,156 @@ namespace MTToolBox {
             cout << "deg(t1) = " << dec << deg(t1) << endl;
             throw new logic_error("failure d != 1");
         }
-        annihilate<U>(&dsfmt_const, b);
+        window_annihilate(&dsfmt_const, b);
         return dsfmt_const.getParityValue();
     }
+
+    /**
+     * same as above, the irreducible factor and the quotient are
+     * taken from \b context, which must have the characteristic
+     * polynomial.
+     */
+    template<typename G, typename U>
+    U calc_fixpoint(const G& dsfmt, PolynomialContext& context)
+    {
+        NTL::GF2X quotient = context.getQuotient();
+        return calc_fixpoint<G, U>(dsfmt, context.getIrreducible(),
+                                   quotient);
+    }
+
+    /** largest matrix of calc_fixpoint_direct(), bytes */
+    const double fixpoint_matrix_limit = 16.0 * 1024 * 1024;
+
+    /**
+     * @param bitSize size of the state
+     * @return true if the matrix of calc_fixpoint_direct(), n x (n + 1)
+     * bits for n = \b bitSize, is not larger than fixpoint_matrix_limit
+     */
+    inline bool fixpoint_matrix_fits(int bitSize)
+    {
+        double n = bitSize;
+        return n * (n + 1) / 8 <= fixpoint_matrix_limit;
+    }
+
+    /**
+     * fix point by a linear equation instead of the second XGCD and
+     * annihilation of calc_fixpoint().
+     *
+     * The matrix of A + I, A the transition, is made from generators
+     * of one bit state, and (A + I)y = c is solved by GF2Matrix, where
+     * c is the projected constant. The solution differs from that of
+     * calc_fixpoint() by a vector in the kernel of A + I, which is in
+     * the reducible part, so period certification is same.
+     *
+     * The matrix takes bitSize^2 / 8 bytes, so this throws when it is
+     * larger than fixpoint_matrix_limit.
+     * @param dsfmt generator
+     * @param context polynomials of the parameter set of \b dsfmt,
+     * which must have the characteristic polynomial
+     * @return lung of the fix point
+     */
+    template<typename G, typename U>
+    U calc_fixpoint_direct(const G& dsfmt, PolynomialContext& context)
+    {
+        using namespace std;
+        if (!fixpoint_matrix_fits(dsfmt.bitSize())) {
+            throw new logic_error("matrix of fix point is too large");
+        }
+        G dsfmt_const(dsfmt);
+        NTL::GF2X quotient = context.getQuotient();
+        project_const(dsfmt_const, context.getIrreducible(), quotient);
+        int n = dsfmt_const.bitSize();
+        GF2Matrix m(n, n + 1);
+        G unit(dsfmt);
+        G image(dsfmt);
+        for (int j = 0; j < n; j++) {
+            unit.setOneBit(j);
+            image.setOneBit(j);
+            image.next_state();
+            image.add(&unit);
+            for (int i = 0; i < n; i++) {
+                if (image.getOneBit(i)) {
+                    m.set(i, j, true);
+                }
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            if (dsfmt_const.getOneBit(i)) {
+                m.set(i, n, true);
+            }
+        }
+        vector<bool> y;
+        if (!m.solve(y)) {
+            throw new logic_error("fix point equation has no solution");
+        }
+        const int lung_bits = sizeof(U) * 8;
+        U fix;
+        setZero(fix);
+        for (int k = 0; k < lung_bits; k++) {
+            if (y[n - lung_bits + k]) {
+                fix.u64[k / 64] |= UINT64_C(1) << (k % 64);
+            }
+        }
+        return fix;
+    }
+
+    /**
+     * fix point by \b method, one of poly, direct and check. check
+     * runs both methods to validate one by the other.
+     *
+     * poly is the method of the search. direct builds and eliminates
+     * a bitSize^2 matrix, which is 40 to 2000 times slower than poly
+     * by the cost estimate, and the matrix doesn't fit in
+     * fixpoint_matrix_limit above mexp 11213, so direct and check are
+     * kept for validation at small mexp only.
+     * @param dsfmt generator
+     * @param context polynomials of the parameter set of \b dsfmt
+     * @param method method
+     * @param[out] fix fix point
+     * @param[out] other fix point by the other method if both are run
+     * @return true if both are run
+     */
+    template<typename G, typename U>
+    bool select_fixpoint(const G& dsfmt, PolynomialContext& context,
+                         const std::string& method, U& fix, U& other)
+    {
+        if (method == "check") {
+            fix = calc_fixpoint<G, U>(dsfmt, context);
+            other = calc_fixpoint_direct<G, U>(dsfmt, context);
+            return true;
+        }
+        if (method == "direct") {
+            fix = calc_fixpoint_direct<G, U>(dsfmt, context);
+        } else {
+            fix = calc_fixpoint<G, U>(dsfmt, context);
+        }
+        return false;
+    }
+
+    /**
+     * @param dsfmt generator which has parity check vector
+     * @param fix fix point
+     * @param other another fix point
+     * @return true if period certification by two fix points is same
+     */
+    template<typename G, typename U>
+    bool same_fixpoint(const G& dsfmt, const U& fix, const U& other)
+    {
+        const int lung_bits = sizeof(U) * 8;
+        U diff = fix;
+        diff ^= other;
+        G work(dsfmt);
+        G unit(dsfmt);
+        work.setZero();
+        int base = work.bitSize() - lung_bits;
+        for (int k = 0; k < lung_bits; k++) {
+            if ((diff.u64[k / 64] >> (k % 64)) & 1) {
+                unit.setOneBit(base + k);
+                work.add(&unit);
+            }
+        }
+        // the difference is orthogonal to the parity check vector
+        return work.periodCertification(true) == 0;
+    }
 }
 #endif // ALGORITHM_CALC_FIXPOINT_HPP
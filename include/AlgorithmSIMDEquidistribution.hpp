@@ -6,6 +6,11 @@
  */
 
 #include "devavxprng.h"
+#include "SIMDKernel.hpp"
+#include "EquidistributionBound.hpp"
+#include "ParallelModes.hpp"
+#include "WorkStealing.hpp"
+#include "BasisArena.hpp"
 
 #if HAVE_STD_SP
 #include <memory>
@@ -16,6 +21,7 @@
 #endif
 
 #include <stdexcept>
+#include <vector>
 #include <MTToolBox/util.hpp>
 
 namespace MTToolBox {
@@ -76,10 +82,10 @@ namespace MTToolBox {
         simd_linear_generator_vector<U, SIMDGenerator>(
             const SIMDGenerator& generator,
             SIMDInfo& info,
-            bool lsb = false)
+            bool lsb = false,
+            void * storage = NULL)
             {
-            shared_ptr<SIMDGenerator> r(new SIMDGenerator(generator));
-            rand = r;
+            init_rand(generator, storage);
             count = 0;
             zero = false;
             setZero(next);
@@ -114,10 +120,9 @@ namespace MTToolBox {
          */
         simd_linear_generator_vector<U, SIMDGenerator>(
             const SIMDGenerator& generator,
-            int bit_pos, SIMDInfo& info, bool lsb = false) {
-            shared_ptr<SIMDGenerator> r(new SIMDGenerator(generator));
-            rand = r;
-            rand->setZero();
+            int bit_pos, SIMDInfo& info, bool lsb = false,
+            void * storage = NULL) {
+            init_lazy(generator, storage);
             count = 0;
             zero = false;
 //            next = getOne<U>() << (bit_size<U>() - bit_pos - 1);
@@ -148,7 +153,13 @@ namespace MTToolBox {
          * A GF(2) linear pseudo random number generator
          *\endenglish
          */
-        shared_ptr<SIMDGenerator> rand;
+        SIMDGenerator * rand;
+        /**
+         * owner of \b rand allocated on heap, empty if \b rand is in
+         * BasisArena. A vector of the standard basis has zero state and
+         * \b rand is NULL until something is added to it.
+         */
+        shared_ptr<SIMDGenerator> owner;
         /**
          *\japanese
          * next_state() が呼ばれた回数
@@ -191,6 +202,49 @@ namespace MTToolBox {
 #if defined(USE_SPECIAL)
         int special;
 #endif
+    private:
+        /**
+         * copy \b generator on heap, or into \b storage if not NULL.
+         */
+        void init_rand(const SIMDGenerator& generator, void * storage) {
+            this->storage = storage;
+            stateBits = generator.bitSize();
+            materialize(generator);
+        }
+
+        /**
+         * a vector of zero state, whose generator is not made until
+         * something is added to it.
+         */
+        void init_lazy(const SIMDGenerator& generator, void * storage) {
+            this->storage = storage;
+            stateBits = generator.bitSize();
+            rand = NULL;
+        }
+
+        /**
+         * make the generator as a copy of \b generator. Zero state
+         * plus \b generator is same as a copy of \b generator.
+         */
+        void materialize(const SIMDGenerator& generator) {
+            if (storage == NULL) {
+                owner = shared_ptr<SIMDGenerator>(
+                    new SIMDGenerator(generator));
+                rand = owner.get();
+            } else {
+                rand = new (storage) SIMDGenerator(generator);
+            }
+        }
+
+        /**
+         * storage in BasisArena of the generator, NULL for heap
+         */
+        void * storage;
+
+        /**
+         * bitSize() of the generator
+         */
+        int stateBits;
     };
 
     /**
@@ -271,13 +325,30 @@ namespace MTToolBox {
             cout << "bit_size = " << dec << bit_size << endl;
 #endif
             this->info = info;
+            bitLength = bit_len;
+            nextLength = bit_len;
             size = bit_size + 1;
-            basis = new linear_vec * [size];
             stateBitSize = maxbitsize;
-            for (int i = 0; i < bit_size; i++) {
-                basis[i] = new linear_vec(rand, i, info, lsb);
+            BasisArena<SIMDGenerator, linear_vec>& arena
+                = BasisArena<SIMDGenerator, linear_vec>::local();
+            if (lease.acquire(arena, size)) {
+                basis = arena.lattice();
+                for (int i = 0; i < bit_size; i++) {
+                    basis[i] = new (arena.vector(i))
+                        linear_vec(rand, i, info, lsb, arena.generator(i));
+                    lease.constructed();
+                }
+                basis[bit_size] = new (arena.vector(bit_size))
+                    linear_vec(rand, info, lsb, arena.generator(bit_size));
+                lease.constructed();
+            } else {
+                basis = new linear_vec * [size];
+                for (int i = 0; i < bit_size; i++) {
+                    basis[i] = new linear_vec(rand, i, info, lsb);
+                }
+                basis[bit_size] = new linear_vec(rand, info, lsb);
             }
-            basis[bit_size] = new linear_vec(rand, info, lsb);
+            source = basis[bit_size]->rand;
             basis[bit_size]->next_state(bit_len);
 #if defined(DEBUG)
             cout << "zero = " << dec << basis[bit_size]->zero << endl;
@@ -295,6 +366,10 @@ namespace MTToolBox {
          *\endenglish
          */
         ~AlgorithmSIMDEquidistribution() {
+            if (lease.held()) {
+                // lease destroys the vectors in the arena
+                return;
+            }
             for (int i = 0; i < size; i++) {
                 delete basis[i];
             }
@@ -302,8 +377,11 @@ namespace MTToolBox {
         }
 
         int get_equidist(int bitLen);
+        void get_all_equidist(int veq[]);
+        int get_next_equidist();
     private:
         int get_equidist_main(int bit_len);
+        void adjust(int new_len);
 
         /**
          *\japanese
@@ -323,6 +401,17 @@ namespace MTToolBox {
          */
         linear_vec **basis;
 
+        /**
+         * generator of the last vector, which is never lazy
+         */
+        SIMDGenerator * source;
+
+        /**
+         * use of the arena of this thread, not held if vectors are on
+         * heap
+         */
+        typename BasisArena<SIMDGenerator, linear_vec>::Lease lease;
+
         /**
          *\japanese
          * vビット精度均等分布次元の計算の v
@@ -331,7 +420,13 @@ namespace MTToolBox {
          * \b v of dimension of equi-distribution with v-bit accuracy.
          *\endenglish
          */
-        //int bit_len;
+        int bitLength;
+
+        /**
+         * v of k(v) calculated by the next get_next_equidist(), 0 after
+         * k(1)
+         */
+        int nextLength;
 
         /**
          *\japanese
@@ -419,6 +514,100 @@ namespace MTToolBox {
         return get_equidist_main(bitLen);
     }
 
+    /**
+     * k(v) for v = bit_length to 1. The lattice reduced for k(v + 1)
+     * is projected to the upper v bits and reduced again, instead of
+     * building a new lattice for each v. Results are same as
+     * get_equidist() of a new object for each v.
+     * @param[out] veq k(v) of v = 1 to bit_length, in veq[v - 1]
+     */
+    template<typename U, typename V>
+    void AlgorithmSIMDEquidistribution<U, V>::get_all_equidist(int veq[])
+    {
+        for (int v = bitLength; v > 0; v--) {
+            veq[v - 1] = get_next_equidist();
+        }
+    }
+
+    /**
+     * k(v) of the next v, from bit_length down to 1. The first call
+     * gives k(bit_length), and each call after it projects the lattice
+     * to one bit less as get_all_equidist() does, so that a caller can
+     * stop before v = 1.
+     * @return k(v), -1 if k(1) has already been calculated
+     */
+    template<typename U, typename V>
+    int AlgorithmSIMDEquidistribution<U, V>::get_next_equidist()
+    {
+        if (nextLength <= 0) {
+            return -1;
+        }
+        int v = nextLength--;
+        if (v < bitLength) {
+            adjust(v);
+        }
+        return get_equidist_main(v);
+    }
+
+    /**
+     * project vectors reduced for v = new_len + 1 to the upper
+     * \b new_len bits, and reduce them again so that basis[i] has its
+     * leading one at i for i < new_len * elementNo, and the rest are
+     * zero vectors.
+     * @param new_len v of k(v) to be calculated next
+     */
+    template<typename U, typename V>
+    void AlgorithmSIMDEquidistribution<U, V>::adjust(int new_len)
+    {
+        using namespace std;
+        int bitSize = new_len * info.elementNo;
+        for (int i = 0; i < size; i++) {
+            if (basis[i]->zero) {
+                continue;
+            }
+            shrink_msb(&basis[i]->next, info.elementNo, new_len + 1,
+                       info.bitSize);
+            if (isZero(basis[i]->next)) {
+                basis[i]->next_state(new_len);
+            }
+        }
+        vector<linear_vec *> pivot(bitSize, NULL);
+        vector<linear_vec *> rest;
+        for (int i = 0; i < size; i++) {
+            linear_vec * x = basis[i];
+            while (!x->zero) {
+                int p = leading_one(x->next);
+                if (p < 0 || p >= bitSize) {
+                    throw new std::logic_error("pivot error in adjust");
+                }
+                if (pivot[p] == NULL) {
+                    pivot[p] = x;
+                    x = NULL;
+                    break;
+                }
+                if (x->count > pivot[p]->count) {
+                    swap(x, pivot[p]);
+                }
+                x->add(*pivot[p]);
+                if (isZero(x->next)) {
+                    x->next_state(new_len);
+                }
+            }
+            if (x != NULL) {
+                rest.push_back(x);
+            }
+        }
+        for (int i = 0; i < bitSize; i++) {
+            if (pivot[i] == NULL) {
+                throw new std::logic_error("rank error in adjust");
+            }
+            basis[i] = pivot[i];
+        }
+        for (size_t i = 0; i < rest.size(); i++) {
+            basis[bitSize + i] = rest[i];
+        }
+    }
+
     /**
      *\japanese
      * ベクトルの加法
@@ -435,7 +624,14 @@ namespace MTToolBox {
         const simd_linear_generator_vector<U, SIMDGenerator>& src) {
         using namespace std;
 
-        rand->add(*src.rand);
+        // zero state of NULL rand is not changed by adding zero state
+        if (src.rand != NULL) {
+            if (rand == NULL) {
+                materialize(*src.rand);
+            } else {
+                rand->add(src.rand);
+            }
+        }
         next ^= src.next;
 #if defined(USE_SPECIAL)
         special = 0;
@@ -450,53 +646,35 @@ namespace MTToolBox {
     template<typename U, typename SIMDGenerator>
     void simd_linear_generator_vector<U, SIMDGenerator>::get_next(int bitSize) {
         using namespace std;
+        if (rand == NULL) {
+            // output of zero state
+            setZero(next);
+            return;
+        }
         U w = rand->generate();
 #if defined(DEBUG) && 0
         cout << "w = " << w << endl;
 #endif
-        bitSize = bitSize * info.elementNo;
-        setZero(next);
-        int k = info.bitSize - 1;
         if (info.bitMode == 32) {
             if (lsb) {
                 for (int i = 0; i < info.elementNo; i++) {
                     w.u[i] = reverse_bit(w.u[i]);
                 }
             }
-            for (int i = 0; i < info.elementNo; i++) {
-                uint32_t mask = UINT32_C(0x80000000);
-                for (int j = 0; j < bitSize; j += info.elementNo) {
-                    if (w.u[i] & mask) {
-                        setBitOfPos(&next, k, 1);
-                    } else {
-                        setBitOfPos(&next, k, 0);
-                    }
-                    k--;
-                    mask = mask >> 1;
-                }
-            }
+            extract_msb(&next, w, info.elementNo, 32, 31, bitSize,
+                        info.bitSize);
         } else {
             if (lsb) {
                 for (int i = 0; i < info.elementNo; i++) {
                     w.u64[i] = reverse_bit(w.u64[i]);
                 }
             }
-            for (int i = 0; i < info.elementNo; i++) {
-                uint64_t mask = UINT64_C(0x8000000000000000);
-                for (int j = 0; j < bitSize; j += info.elementNo) {
-                    if (w.u64[i] & mask) {
-                        setBitOfPos(&next, k, 1);
-                    } else {
-                        setBitOfPos(&next, k, 0);
-                    }
-                    k--;
-                    mask = mask >> 1;
-                }
-            }
+            extract_msb(&next, w, info.elementNo, 64, 63, bitSize,
+                        info.bitSize);
         }
 #if defined(DEBUG)
         if (!isZero(next)) {
-            cout << "bitSize = " << dec << bitSize;
+            cout << "bitSize = " << dec << bitSize * info.elementNo;
             cout << " info.elementNo = " << dec << info.elementNo << endl;
             cout << "get_next w = " << hex << w << endl;
             cout << "get_next next = " << next << endl;
@@ -527,6 +705,12 @@ namespace MTToolBox {
         if (zero) {
             return;
         }
+        if (rand == NULL) {
+            // zero state outputs zero forever, count as the loop below
+            count += stateBits * 2 + 1;
+            zero = true;
+            return;
+        }
         int zero_count = 0;
         get_next(bitLen);
         count++;
@@ -574,7 +758,7 @@ namespace MTToolBox {
         int pivot_index;
         int old_pivot = 0;
 
-        pivot_index = calc_1pos(basis[bitSize]->next);
+        pivot_index = leading_one(basis[bitSize]->next);
 #if defined(DEBUG)
         cout << "get_equidist_main step 1" << endl;
 #endif
@@ -604,11 +788,11 @@ namespace MTToolBox {
                 cout << "next = " << hex << basis[bitSize]->next << endl;
                 throw new std::logic_error("pivot error 0.1");
             }
-            if (pivot_index != calc_1pos(basis[pivot_index]->next)) {
+            if (pivot_index != leading_one(basis[pivot_index]->next)) {
                 cerr << "pivot error 1" << endl;
                 cerr << "pivot_index:" << dec << pivot_index << endl;
                 cerr << "calc_1pos:" << dec
-                     << calc_1pos(basis[pivot_index]->next) << endl;
+                     << leading_one(basis[pivot_index]->next) << endl;
                 cerr << "next:" << hex << basis[pivot_index]->next << endl;
                 for (int i = 0; i < bitSize; i++) {
                     cerr << dec << i << ":" << hex << basis[i]->next << endl;
@@ -646,7 +830,7 @@ namespace MTToolBox {
             // 全部0なら次の状態に進める。（内部でcount が大きくなる）
             if (isZero(basis[bitSize]->next)) {
                 basis[bitSize]->next_state(v);
-                pivot_index = calc_1pos(basis[bitSize]->next);
+                pivot_index = leading_one(basis[bitSize]->next);
 #if defined(DEBUG)
                 cout << "zero" << endl;
                 cout << "pivot_index = " << dec << pivot_index << endl;
@@ -669,7 +853,7 @@ namespace MTToolBox {
             // 次の add で全部0になる。
             } else {
                 old_pivot = pivot_index;
-                pivot_index = calc_1pos(basis[bitSize]->next);
+                pivot_index = leading_one(basis[bitSize]->next);
                 if (pivot_index >= bitSize) {
                     cout << "pivot_index = " << dec << pivot_index << endl;
                     cout << "bitSize = " << bitSize << endl;
@@ -716,7 +900,7 @@ namespace MTToolBox {
             cout << "stateBitSize = " << dec << stateBitSize << endl;
             cout << "elementNo = " << dec << info.elementNo << endl;
             cout << "result = " << dec << result << endl;
-            cerr << basis[0]->rand->getParamString() << endl;
+            cerr << source->getParamString() << endl;
 #if 0
             for(int i = 0; i < size; i++) {
                 basis[i]->debug_print();
@@ -816,6 +1000,441 @@ namespace MTToolBox {
         return veq;
     }
 
+    /**
+     * k(v) for v = 1 to \b bit_len by one lattice for each weight
+     * mode, see AlgorithmSIMDEquidistribution::get_all_equidist().
+     * Results are same as calc_SIMD_equidist() for each v.
+     *
+     * calc_SIMD_equidist() does not reset the maximum over weight
+     * modes for each start mode, so the maximum never decreases and
+     * the minimum over start modes is the maximum of start mode 0.
+     * Start modes after 0 can't change k(v), and only start mode 0 is
+     * evaluated here.
+     * @param[out] veq k(v) in veq[v - 1]
+     */
+    template<typename U, typename SIMDGenerator>
+    void calc_SIMD_all_equidist(int veq[],
+                                int bit_len,
+                                const SIMDGenerator& rand,
+                                SIMDInfo& info,
+                                int mexp,
+                                bool lsb = false)
+    {
+        using namespace std;
+        int weight_max = info.bitSize / 32;
+        int weight_dec;
+        if (info.bitMode == 32) {
+            weight_dec = 1;
+        } else {
+            weight_dec = 2;
+        }
+        int weight_start = weight_dec;
+        if (info.fastMode) {
+            weight_start = weight_max;
+        }
+        const int sm = 0;
+        vector<int> e(bit_len);
+        for (int i = 0; i < bit_len; i++) {
+            veq[i] = -1;
+        }
+        for (int wm = weight_start; wm <= weight_max; wm += weight_dec) {
+            SIMDGenerator work = rand;
+            work.setStartMode(sm);
+            work.setWeightMode(wm);
+            work.generate();
+            AlgorithmSIMDEquidistribution<U, SIMDGenerator>
+                ase(work, bit_len, info, rand.bitSize(), lsb);
+            ase.get_all_equidist(&e[0]);
+            for (int v = 1; v <= bit_len; v++) {
+                int e2;
+                if (info.bitMode == 32) {
+                    e2 = e[v - 1] * info.elementNo
+                        - (info.elementNo - wm);
+                } else { // 64
+                    e2 = e[v - 1] * info.elementNo
+                        - (info.elementNo - wm / 2);
+                }
+                if (e2 > mexp / v) {
+                    cerr << "over theoretical bound" << endl;
+                    cout << "start_mode = " << dec << sm;
+                    cout << " weight_mode = " << dec << wm;
+                    cout << " mexp = " << dec << mexp;
+                    cout << " e = " << dec << e2;
+                    cout << " v = " << dec << v << endl;
+                    throw new std::logic_error("over theoretical bound");
+                }
+                if (e2 > veq[v - 1]) {
+                    veq[v - 1] = e2;
+                }
+            }
+        }
+    }
+
+    /**
+     * start modes and weight modes which can change the result of
+     * calc_SIMD_equidist(). Only start mode 0 is listed, see
+     * calc_SIMD_all_equidist().
+     * @param info SIMD information
+     * @param[out] start_modes start modes
+     * @param[out] weight_modes weight modes
+     */
+    inline void simd_mode_lists(const SIMDInfo& info,
+                                std::vector<int>& start_modes,
+                                std::vector<int>& weight_modes)
+    {
+        int weight_max = info.bitSize / 32;
+        int weight_dec;
+        if (info.bitMode == 32) {
+            weight_dec = 1;
+        } else {
+            weight_dec = 2;
+        }
+        int weight_start = weight_dec;
+        if (info.fastMode) {
+            weight_start = weight_max;
+        }
+        start_modes.clear();
+        weight_modes.clear();
+        start_modes.push_back(0);
+        for (int wm = weight_start; wm <= weight_max; wm += weight_dec) {
+            weight_modes.push_back(wm);
+        }
+    }
+
+    /**
+     * k(v) of v = 1 to \b bit_len of one pair of start mode and weight
+     * mode, adjusted by weight mode.
+     * @param[out] e k(v) in e[v - 1]
+     * @param sm start mode
+     * @param wm weight mode
+     */
+    template<typename U, typename SIMDGenerator>
+    void calc_SIMD_mode_equidist(int e[],
+                                 int bit_len,
+                                 int sm,
+                                 int wm,
+                                 const SIMDGenerator& rand,
+                                 SIMDInfo& info,
+                                 int mexp,
+                                 bool lsb = false)
+    {
+        using namespace std;
+        SIMDGenerator work = rand;
+        work.setStartMode(sm);
+        work.setWeightMode(wm);
+        work.generate();
+        AlgorithmSIMDEquidistribution<U, SIMDGenerator>
+            ase(work, bit_len, info, rand.bitSize(), lsb);
+        ase.get_all_equidist(e);
+        for (int v = 1; v <= bit_len; v++) {
+            if (info.bitMode == 32) {
+                e[v - 1] = e[v - 1] * info.elementNo
+                    - (info.elementNo - wm);
+            } else { // 64
+                e[v - 1] = e[v - 1] * info.elementNo
+                    - (info.elementNo - wm / 2);
+            }
+            if (e[v - 1] > mexp / v) {
+                cerr << "over theoretical bound" << endl;
+                cout << "start_mode = " << dec << sm;
+                cout << " weight_mode = " << dec << wm;
+                cout << " mexp = " << dec << mexp;
+                cout << " e = " << dec << e[v - 1];
+                cout << " v = " << dec << v << endl;
+                throw new std::logic_error("over theoretical bound");
+            }
+        }
+    }
+
+    /**
+     * k(v) of one pair of start mode and weight mode, adjusted by
+     * weight mode.
+     * @param sm start mode
+     * @param wm weight mode
+     * @return k(v)
+     */
+    template<typename U, typename SIMDGenerator>
+    int calc_SIMD_mode_equidist_v(int v,
+                                  int sm,
+                                  int wm,
+                                  const SIMDGenerator& rand,
+                                  SIMDInfo& info,
+                                  int mexp,
+                                  bool lsb = false)
+    {
+        using namespace std;
+        SIMDGenerator work = rand;
+        work.setStartMode(sm);
+        work.setWeightMode(wm);
+        work.generate();
+        AlgorithmSIMDEquidistribution<U, SIMDGenerator>
+            ase(work, v, info, rand.bitSize(), lsb);
+        int e = ase.get_equidist(v);
+        if (info.bitMode == 32) {
+            e = e * info.elementNo - (info.elementNo - wm);
+        } else { // 64
+            e = e * info.elementNo - (info.elementNo - wm / 2);
+        }
+        if (e > mexp / v) {
+            cerr << "over theoretical bound" << endl;
+            cout << "start_mode = " << dec << sm;
+            cout << " weight_mode = " << dec << wm;
+            cout << " mexp = " << dec << mexp;
+            cout << " e = " << dec << e;
+            cout << " v = " << dec << v << endl;
+            throw new std::logic_error("over theoretical bound");
+        }
+        return e;
+    }
+
+    /**
+     * same as calc_SIMD_all_equidist(), but pairs of start mode and
+     * weight mode are evaluated by threads, see ParallelModes.hpp.
+     * @param[out] veq k(v) in veq[v - 1]
+     * @param threads number of threads, 0 for all cores
+     */
+    template<typename U, typename SIMDGenerator>
+    void calc_SIMD_all_equidist_parallel(int veq[],
+                                         int bit_len,
+                                         const SIMDGenerator& rand,
+                                         SIMDInfo& info,
+                                         int mexp,
+                                         int threads,
+                                         bool lsb = false)
+    {
+        std::vector<int> start_modes;
+        std::vector<int> weight_modes;
+        simd_mode_lists(info, start_modes, weight_modes);
+        auto eval = [&](int sm, int wm, int e[]) {
+            calc_SIMD_mode_equidist<U, SIMDGenerator>(e, bit_len, sm, wm,
+                                                      rand, info, mexp, lsb);
+        };
+        parallel_mode_minmax(eval, start_modes, weight_modes, bit_len,
+                             threads, veq);
+    }
+
+    /**
+     * same as calc_SIMD_equidist(), but pairs of start mode and weight
+     * mode are evaluated by threads, see ParallelModes.hpp.
+     * @param threads number of threads, 0 for all cores
+     * @return k(v)
+     */
+    template<typename U, typename SIMDGenerator>
+    int calc_SIMD_equidist_parallel(int v,
+                                    const SIMDGenerator& rand,
+                                    SIMDInfo& info,
+                                    int mexp,
+                                    int threads,
+                                    bool lsb = false)
+    {
+        std::vector<int> start_modes;
+        std::vector<int> weight_modes;
+        simd_mode_lists(info, start_modes, weight_modes);
+        auto eval = [&](int sm, int wm, int e[]) {
+            e[0] = calc_SIMD_mode_equidist_v<U, SIMDGenerator>(v, sm, wm,
+                                                               rand, info,
+                                                               mexp, lsb);
+        };
+        int veq;
+        parallel_mode_minmax(eval, start_modes, weight_modes, 1, threads,
+                             &veq);
+        return veq;
+    }
+
+    /**
+     * k(v) of several bit modes by WorkStealing, one task for each bit
+     * mode, start mode and weight mode. A task reduces one lattice and
+     * gets k(v) of all v in descending order of v, see
+     * calc_SIMD_mode_equidist(). Results are same as
+     * calc_SIMD_equidist() for each v.
+     *
+     * With MPI, tasks are assigned to processes by assign_processes().
+     * A process can not skip start modes by the results of other
+     * processes, so it runs all of its tasks, and the maximums over
+     * weight modes of all processes are merged by \b reduce_max before
+     * the minimum over start modes is taken. Every process gets k(v)
+     * of all v. When a task of any process throws, all processes throw
+     * after reduce_max, see throw_process_error().
+     * @param[out] veq k(v) of info[b] in veq[b][v - 1]
+     * @param bit_len maximum v of info[b] in bit_len[b]
+     * @param info bit modes
+     * @param modes number of bit modes
+     * @param threads number of threads, 0 for all cores
+     * @param verbose print time of tasks
+     * @param rank rank of this process
+     * @param num_process number of processes
+     * @param reduce_max reduce_max(data, n) sets each of n ints in
+     * data to the maximum over all processes, as MPI_Allreduce with
+     * MPI_MAX. Not called when \b num_process is 1.
+     */
+    template<typename U, typename SIMDGenerator, typename R>
+    void calc_SIMD_scheduled_equidist(int * veq[],
+                                      const int bit_len[],
+                                      SIMDInfo info[],
+                                      int modes,
+                                      const SIMDGenerator& rand,
+                                      int mexp,
+                                      int threads,
+                                      bool verbose,
+                                      int rank,
+                                      int num_process,
+                                      R& reduce_max,
+                                      bool lsb = false)
+    {
+        using namespace std;
+        vector<int> start_no(modes);
+        vector<int> weight_no(modes);
+        vector<eq_task> tasks;
+        vector<shared_ptr<ModeMinMax> > minmax;
+        for (int b = 0; b < modes; b++) {
+            vector<int> start_modes;
+            vector<int> weight_modes;
+            simd_mode_lists(info[b], start_modes, weight_modes);
+            start_no[b] = start_modes.size();
+            weight_no[b] = weight_modes.size();
+            minmax.push_back(shared_ptr<ModeMinMax>(
+                                 new ModeMinMax(start_no[b], weight_no[b],
+                                                bit_len[b])));
+            for (int s = 0; s < start_no[b]; s++) {
+                for (int w = 0; w < weight_no[b]; w++) {
+                    tasks.push_back(eq_task(b, bit_len[b], bit_len[b],
+                                            start_modes[s],
+                                            weight_modes[w], s,
+                                            static_cast<long>(bit_len[b])
+                                            * info[b].elementNo));
+                }
+            }
+        }
+        if (num_process > 1) {
+            vector<long> cost;
+            for (size_t i = 0; i < tasks.size(); i++) {
+                cost.push_back(tasks[i].cost);
+            }
+            vector<int> owner = assign_processes(cost, num_process);
+            vector<eq_task> mine;
+            for (size_t i = 0; i < tasks.size(); i++) {
+                if (owner[i] == rank) {
+                    mine.push_back(tasks[i]);
+                }
+            }
+            tasks.swap(mine);
+        }
+        auto exec = [&](eq_task& t) {
+            ModeMinMax& mm = *minmax[t.mode];
+            if (num_process == 1 && !mm.can_lower(t.start_index)) {
+                t.skipped = true;
+                mm.done(t.start_index, true);
+                return;
+            }
+            vector<int> e(t.v);
+            calc_SIMD_mode_equidist<U, SIMDGenerator>(
+                &e[0], t.v, t.sm, t.wm, rand, info[t.mode], mexp, lsb);
+            t.k = e[t.v - 1];
+            mm.update(t.start_index, &e[0]);
+            mm.done(t.start_index, false);
+        };
+        int th = mode_threads(threads, static_cast<int>(tasks.size()));
+        WorkStealing ws(th);
+        if (num_process == 1) {
+            ws.run(tasks, exec);
+            for (int b = 0; b < modes; b++) {
+                minmax[b]->result(veq[b]);
+            }
+        } else {
+            logic_error * error = NULL;
+            try {
+                ws.run(tasks, exec);
+            } catch (logic_error * e) {
+                error = e;
+            }
+            vector<int> first(modes);
+            int size = 0;
+            for (int b = 0; b < modes; b++) {
+                first[b] = size;
+                size += start_no[b] * bit_len[b];
+            }
+            // the last element is the error flag, so that all
+            // processes call reduce_max and all throw on an error
+            vector<int> m(size + 1);
+            for (int b = 0; b < modes; b++) {
+                minmax[b]->maximums(&m[first[b]]);
+            }
+            m[size] = error != NULL;
+            reduce_max(&m[0], size + 1);
+            throw_process_error(error, m[size]);
+            for (int b = 0; b < modes; b++) {
+                ModeMinMax::fold(&m[first[b]], start_no[b], bit_len[b],
+                                 veq[b]);
+            }
+        }
+        if (verbose) {
+            print_task_times(cout, tasks, th, ws.steals());
+        }
+    }
+
+    /**
+     * k(v) of several bit modes by WorkStealing in one process.
+     * @param[out] veq k(v) of info[b] in veq[b][v - 1]
+     * @param bit_len maximum v of info[b] in bit_len[b]
+     * @param info bit modes
+     * @param modes number of bit modes
+     * @param threads number of threads, 0 for all cores
+     * @param verbose print time of tasks
+     */
+    template<typename U, typename SIMDGenerator>
+    void calc_SIMD_scheduled_equidist(int * veq[],
+                                      const int bit_len[],
+                                      SIMDInfo info[],
+                                      int modes,
+                                      const SIMDGenerator& rand,
+                                      int mexp,
+                                      int threads,
+                                      bool verbose,
+                                      bool lsb = false)
+    {
+        auto none = [](int *, int) {};
+        calc_SIMD_scheduled_equidist<U, SIMDGenerator>(veq, bit_len, info,
+                                                       modes, rand, mexp,
+                                                       threads, verbose,
+                                                       0, 1, none, lsb);
+    }
+
+    /**
+     * compare k(v) by calc_SIMD_all_equidist() with k(v) by
+     * calc_SIMD_equidist() for each v, and print v which differ.
+     * @param[out] veq k(v) in veq[v - 1] by calc_SIMD_all_equidist()
+     * @return true if k(v) of all v are same
+     */
+    template<typename U, typename SIMDGenerator>
+    bool check_SIMD_all_equidist(int veq[],
+                                 int bit_len,
+                                 const SIMDGenerator& rand,
+                                 SIMDInfo& info,
+                                 int mexp,
+                                 bool lsb = false)
+    {
+        using namespace std;
+        calc_SIMD_all_equidist<U, SIMDGenerator>(veq, bit_len, rand, info,
+                                                 mexp, lsb);
+        bool same = true;
+        for (int v = 1; v <= bit_len; v++) {
+            int e = calc_SIMD_equidist<U, SIMDGenerator>(v, rand, info,
+                                                         mexp, lsb);
+            if (e != veq[v - 1]) {
+                cout << "bitMode = " << dec << info.bitMode
+                     << " k(" << v << ") = " << veq[v - 1]
+                     << " by all v, " << e << " by each v" << endl;
+                same = false;
+            }
+        }
+        return same;
+    }
+
+    /**
+     * k(v) for v = 1 to \b bit_len, computed in descending order of v
+     * by calc_SIMD_all_equidist().
+     * @return sum of d(v)
+     */
     template<typename U, typename SIMDGenerator>
     int calc_SIMD_equidistribution(const SIMDGenerator& rand,
                                    int veq[],
@@ -824,14 +1443,79 @@ namespace MTToolBox {
                                    int mexp,
                                    bool lsb = false)
     {
+        calc_SIMD_all_equidist<U, SIMDGenerator>(veq, bit_len, rand, info,
+                                                 mexp, lsb);
         int sum = 0;
         for (int i = 0; i < bit_len; i++) {
-            veq[i] = calc_SIMD_equidist<U, SIMDGenerator>(i + 1, rand, info,
-                                                          mexp, lsb);
             sum += mexp / (i + 1) - veq[i];
         }
         return sum;
     }
 
+    /**
+     * same as calc_SIMD_equidistribution() but abandons the candidate
+     * when the sum of defects exceeds \b max_delta, see
+     * EquidistributionBound.hpp. One lattice of start mode 0 is made
+     * for each weight mode, and k(v) of all weight modes is computed
+     * by one step of get_next_equidist() of each lattice, so that v
+     * not reached are not computed at all.
+     * @return sum of defects, greater than \b max_delta if abandoned
+     */
+    template<typename U, typename SIMDGenerator>
+    int calc_SIMD_equidistribution_bound(const SIMDGenerator& rand,
+                                         int veq[],
+                                         int bit_len,
+                                         SIMDInfo& info,
+                                         int mexp,
+                                         int max_delta,
+                                         DeltaBoundStats& stats,
+                                         bool lsb = false)
+    {
+        using namespace std;
+        typedef AlgorithmSIMDEquidistribution<U, SIMDGenerator> ase_t;
+        vector<int> start_modes;
+        vector<int> weight_modes;
+        simd_mode_lists(info, start_modes, weight_modes);
+        vector<shared_ptr<ase_t> > lattice;
+        auto kv = [&](int v) -> int {
+            if (lattice.empty()) {
+                // made here to be timed with the first step
+                for (size_t i = 0; i < weight_modes.size(); i++) {
+                    SIMDGenerator work = rand;
+                    work.setStartMode(0);
+                    work.setWeightMode(weight_modes[i]);
+                    work.generate();
+                    lattice.push_back(shared_ptr<ase_t>(
+                        new ase_t(work, bit_len, info, rand.bitSize(),
+                                  lsb)));
+                }
+            }
+            int k = -1;
+            for (size_t i = 0; i < weight_modes.size(); i++) {
+                int wm = weight_modes[i];
+                int e = lattice[i]->get_next_equidist();
+                if (info.bitMode == 32) {
+                    e = e * info.elementNo - (info.elementNo - wm);
+                } else { // 64
+                    e = e * info.elementNo - (info.elementNo - wm / 2);
+                }
+                if (e > mexp / v) {
+                    cerr << "over theoretical bound" << endl;
+                    cout << "start_mode = 0";
+                    cout << " weight_mode = " << dec << wm;
+                    cout << " mexp = " << dec << mexp;
+                    cout << " e = " << dec << e;
+                    cout << " v = " << dec << v << endl;
+                    throw new std::logic_error("over theoretical bound");
+                }
+                if (e > k) {
+                    k = e;
+                }
+            }
+            return k;
+        };
+        return calc_equidistribution_bound(kv, veq, bit_len, mexp,
+                                           max_delta, stats);
+    }
 }
 #endif // MTTOOLBOX_ALGORITHM_EQUIDISTRIBUTION_HPP
@@ -0,0 +1,108 @@
+#pragma once
+#ifndef ANNIBENCHOPTIONS_HPP
+#define ANNIBENCHOPTIONS_HPP
+/**
+ * @file AnniBenchOptions.hpp
+ */
+#include "devavxprng.h"
+#include <string>
+
+namespace MTToolBox {
+    /**
+     * options of annihilation benchmark
+     */
+    class AnniBenchOptions {
+    public:
+        uint64_t seed;
+        int repeat;
+        std::string type;
+
+        AnniBenchOptions() {
+            seed = 1234;
+            repeat = 1;
+            type = "dSFMTAVX2";
+        }
+
+        /**
+         * command line option parser
+         * @param argc number of command line arguments
+         * @param argv command line arguments
+         * @return command line options have error, or not
+         */
+        bool parse(int argc, char **argv) {
+            using namespace std;
+            int c;
+            bool error = false;
+            string pgm = argv[0];
+            static struct option longopts[] = {
+                {"type", required_argument, NULL, 't'},
+                {"seed", required_argument, NULL, 's'},
+                {"repeat", required_argument, NULL, 'r'},
+                {NULL, 0, NULL, 0}};
+            errno = 0;
+            for (;;) {
+                c = getopt_long(argc, argv, "t:s:r:", longopts, NULL);
+                if (error) {
+                    break;
+                }
+                if (c == -1) {
+                    break;
+                }
+                switch (c) {
+                case 't':
+                    type = optarg;
+                    if (type != "SFMTAVX2" && type != "SFMTAVX512F"
+                        && type != "dSFMTAVX2" && type != "dSFMTAVX512F") {
+                        error = true;
+                        cerr << "type must be one of SFMTAVX2, SFMTAVX512F, "
+                             << "dSFMTAVX2 and dSFMTAVX512F" << endl;
+                    }
+                    break;
+                case 's':
+                    seed = strtoull(optarg, NULL, 0);
+                    if (errno) {
+                        error = true;
+                        cerr << "seed must be a number" << endl;
+                    }
+                    break;
+                case 'r':
+                    repeat = strtol(optarg, NULL, 10);
+                    if (errno || repeat < 1) {
+                        error = true;
+                        cerr << "repeat must be a positive number" << endl;
+                    }
+                    break;
+                case '?':
+                default:
+                    error = true;
+                    break;
+                }
+            }
+            if (error) {
+                output_help(pgm);
+                return false;
+            }
+            return true;
+        }
+    private:
+        /**
+         * showing help message
+         * @param pgm program name
+         */
+        void output_help(std::string& pgm) {
+            using namespace std;
+            cerr << "usage:" << endl;
+            cerr << pgm << " [-t type] [-s seed] [-r repeat]" << endl;
+            cerr << "\n"
+                 << "--type, -t type       SFMTAVX2, SFMTAVX512F, dSFMTAVX2 "
+                 << "or dSFMTAVX512F.\n"
+                 << "                      default dSFMTAVX2.\n"
+                 << "--seed, -s seed       seed of parameters and "
+                 << "polynomials.\n"
+                 << "--repeat, -r repeat   number of polynomials for each "
+                 << "mexp. default 1.\n";
+            cerr << endl;
+        }
+    };
+}
+#endif // ANNIBENCHOPTIONS_HPP
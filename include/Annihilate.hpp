@@ -7,6 +7,14 @@
 #include <MTToolBox/period.hpp>
 #include <MTToolBox/AlgorithmReducibleRecursionSearch.hpp>
 #include "w256.hpp"
+#include "BitslicedMinPoly.hpp"
+#include "ParallelSearch.hpp"
+#include "PolynomialContext.hpp"
+#include "PolynomialEvaluation.hpp"
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
 
 namespace MTToolBox {
     /**
@@ -17,36 +25,61 @@ namespace MTToolBox {
     template<typename G, typename U>
     class Annihilate {
     public:
+        /**
+         * @param threads number of threads of getLCMPoly(), 0 for all
+         * cores, it is 1 if NTL is not thread safe
+         */
+        explicit Annihilate(int threads = 1)
+            : threads(threads), folded_batches(0) {
+        }
+
         bool anni(G& sf) {
+            PolynomialContext context;
+            return anni(sf, context);
+        }
+
+        /**
+         * annihilate the quotient of the characteristic polynomial by
+         * the irreducible factor. Polynomials in \b context are used
+         * instead of computing them, and polynomials computed are
+         * stored in \b context.
+         * @param sf generator
+         * @param context polynomials of the parameter set of \b sf
+         * @return false if the quotient can't be annihilated
+         */
+        bool anni(G& sf, PolynomialContext& context) {
             using namespace NTL;
             using namespace std;
             //G gen(sf);
             GF2X poly;
-            minpoly(poly, sf);
-            GF2X irreducible = poly;
-            if (!hasFactorOfDegree(irreducible, sf.getMexp())) {
-                cout << "error does not have factor of degree(0) "
-                     << dec << sf.getMexp()
-                     << endl;
-                cout << "deg poly = " << dec << deg(poly) << endl;
-                cout << "deg irreducible = " << dec << deg(irreducible) << endl;
-                cout << sf.getParamString() << endl;
-                sf.d_p();
-                cout << "poly:" << endl;
-                cout << poly << endl;
-                cout << "irreducible:" << endl;
-                cout << irreducible << endl;
-                return false;
-            }
-#if 1
-            calcCharacteristicPolynomial(&sf, poly);
-            if (deg(poly) != sf.bitSize()) {
-                getLCMPoly(poly, sf);
+            GF2X irreducible;
+            if (context.hasIrreducible()) {
+                PolynomialContext::avoid();
+                irreducible = context.getIrreducible();
+            } else {
+                minPolyBlock(poly, sf, 0);
+                irreducible = poly;
+                if (!hasFactorOfDegree(irreducible, sf.getMexp())) {
+                    cout << "error does not have factor of degree(0) "
+                         << dec << sf.getMexp()
+                         << endl;
+                    cout << "deg poly = " << dec << deg(poly) << endl;
+                    cout << "deg irreducible = " << dec << deg(irreducible)
+                         << endl;
+                    cout << sf.getParamString() << endl;
+                    sf.d_p();
+                    cout << "poly:" << endl;
+                    cout << poly << endl;
+                    cout << "irreducible:" << endl;
+                    cout << irreducible << endl;
+                    return false;
+                }
+                context.setIrreducible(irreducible);
             }
-#endif
+            poly = characteristic(context, sf);
             int degp = deg(poly);
             //printBinary(stdout, poly);
-            GF2X quotient = poly / irreducible;
+            GF2X quotient = context.getQuotient();
 #if defined(DEBUG)
             cout << "deg irreducible = " << dec << deg(irreducible) << endl;
             cout << "deg characteristic = " << dec << deg(poly)
@@ -58,8 +91,8 @@ namespace MTToolBox {
                 cout << "quotient * irreducible != poly" << endl;
                 return false;
             }
-            annihilate<U>(&sf, quotient);
-            minpoly(poly, sf);
+            window_annihilate(&sf, quotient);
+            minPolyBlock(poly, sf, 0);
             if (poly != irreducible) {
                 cout << "annihilate failed" << endl;
                 cout << "deg poly = " << dec << degp << endl;
@@ -80,55 +113,227 @@ namespace MTToolBox {
             }
             return true;
         }
+        /**
+         * characteristic polynomial of the state transition of \b sf,
+         * LCM of minimal polynomials when its degree is less than
+         * bitSize(). It is computed only if \b context doesn't have it.
+         * @param context polynomials of the parameter set of \b sf
+         * @param sf generator
+         * @return characteristic polynomial
+         */
+        NTL::GF2X characteristic(PolynomialContext& context, const G& sf) {
+            using namespace NTL;
+            if (context.hasCharacteristic()) {
+                PolynomialContext::avoid();
+                return context.getCharacteristic();
+            }
+            G gen(sf);
+            GF2X poly;
+            calcCharacteristicPolynomial(&gen, poly);
+            if (deg(poly) != gen.bitSize()) {
+                getLCMPoly(poly, gen);
+            }
+            context.setCharacteristic(poly);
+            return poly;
+        }
+
+        /**
+         * LCM of \b lcm and minimal polynomials of bits of lung of
+         * \b sf and of generators of one bit state. Sequences of 64
+         * bits are processed at once by bitsliced_berlekamp_massey(),
+         * and the calculation ends when deg(lcm) reaches bitSize().
+         *
+         * Batches of 64 state bits are taken by threads. The LCM of
+         * minimal polynomials of a batch is merged into the shared LCM
+         * under a lock, and all threads stop when the shared LCM
+         * reaches bitSize().
+         * @param[in,out] lcm polynomial, zero is taken as 1 because
+         * LCM with zero is zero
+         * @param sf generator
+         */
         void getLCMPoly(NTL::GF2X& lcm, const G& sf) {
             using namespace NTL;
             using namespace std;
+            if (IsZero(lcm)) {
+                set(lcm);
+            }
             G gen(sf);
-            lungLCM(lcm, gen);
+            folded_batches = 0;
+            if (lungLCM(lcm, gen)) {
+                return;
+            }
             int bitSize = gen.bitSize();
-            GF2X poly;
-            for (int i = 0; i < bitSize; i++) {
-                gen.setOneBit(i);
-#if 0
-                for (int j = 0; j < 256; j++) {
-                    minPolyLung(poly, gen, j);
-                    //minpoly(poly, gen, j);
-                    LCM(lcm, lcm, poly);
+            int batches = (bitSize + 63) / 64;
+            int th = 1;
+            if (threads != 1) {
+                th = search_threads(threads, batches);
+            }
+            mutex lock;
+            atomic<int> next_batch(0);
+            atomic<int> folded(0);
+            atomic<bool> done(false);
+            auto worker = [&](int) {
+                G work(sf);
+                vector<uint64_t> seq(2 * bitSize);
+                GF2X part;
+                for (;;) {
+                    int b = next_batch++;
+                    if (done || b >= batches) {
+                        break;
+                    }
+                    int lanes = oneBitSequences(seq, work, b * 64);
+                    set(part);
+                    foldLCM(part, seq, lanes, bitSize);
+                    folded++;
+                    lock_guard<mutex> guard(lock);
+                    LCM(lcm, lcm, part);
                     if (deg(lcm) == bitSize) {
-                        return;
+                        done = true;
                     }
                 }
-#else
-                minPolyLung(poly, gen, 0);
-                //minpoly(poly, gen);
-                LCM(lcm, lcm, poly);
-                if (deg(lcm) == bitSize) {
-                    return;
+            };
+            if (th == 1) {
+                worker(0);
+            } else {
+                vector<thread> pool;
+                for (int w = 0; w < th; w++) {
+                    pool.push_back(thread(worker, w));
+                }
+                for (int w = 0; w < th; w++) {
+                    pool[w].join();
                 }
-#endif
             }
+            folded_batches = folded;
+        }
+
+        /**
+         * @return number of batches of 64 one bit states folded by the
+         * last getLCMPoly(), 0 if the lung was enough
+         */
+        int getFoldedBatches() const {
+            return folded_batches;
         }
     private:
-        void lungLCM(NTL::GF2X& lcm, G& sf) {
+        /**
+         * LCM of \b lcm and minimal polynomials of all bits of lung.
+         * The sequence of lung is generated once, and word g of lung
+         * is the sequences of bits 64g to 64g + 63.
+         * @return true if deg(lcm) reached bitSize()
+         */
+        bool lungLCM(NTL::GF2X& lcm, G& sf) {
+            using namespace std;
+            int bitSize = sf.bitSize();
+            int length = 2 * bitSize;
+            vector<U> lung(length);
+            for (int j = 0; j < length; j += block_size) {
+                int n = length - j;
+                if (n > block_size) {
+                    n = block_size;
+                }
+                sf.parity_block(&lung[j], n);
+            }
+            vector<uint64_t> seq(length);
+            for (int g = 0; g < int(sizeof(U) / 8); g++) {
+                for (int j = 0; j < length; j++) {
+                    seq[j] = lung[j].u64[g];
+                }
+                if (foldLCM(lcm, seq, 64, bitSize)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * sequences of generators whose state is one bit from
+         * \b first to \b first + 63.
+         * @param[out] seq bit l of seq[n] is n-th output of the
+         * generator of bit \b first + l
+         * @param gen generator, its state is changed
+         * @param first first state bit
+         * @return number of sequences, less than 64 at the end of state
+         */
+        int oneBitSequences(std::vector<uint64_t>& seq, G& gen, int first) {
+            using namespace std;
+            int bitSize = gen.bitSize();
+            int length = seq.size();
+            int lanes = bitSize - first < 64 ? bitSize - first : 64;
+            for (int j = 0; j < length; j++) {
+                seq[j] = 0;
+            }
+            U buf[block_size];
+            for (int l = 0; l < lanes; l++) {
+                gen.setOneBit(first + l);
+                for (int j = 0; j < length; j += block_size) {
+                    int n = length - j;
+                    if (n > block_size) {
+                        n = block_size;
+                    }
+                    gen.parity_block(buf, n);
+                    for (int k = 0; k < n; k++) {
+                        seq[j + k] |= (buf[k].u64[0] & 1) << l;
+                    }
+                }
+            }
+            return lanes;
+        }
+
+        /**
+         * fold minimal polynomials of 64 sequences into \b lcm.
+         * @param[in,out] lcm polynomial
+         * @param seq bit l of seq[n] is n-th term of l-th sequence
+         * @param lanes number of sequences used
+         * @param bitSize size of state
+         * @return true if deg(lcm) reached \b bitSize
+         */
+        bool foldLCM(NTL::GF2X& lcm, const std::vector<uint64_t>& seq,
+                     int lanes, int bitSize) {
             using namespace NTL;
             using namespace std;
+            vector<uint64_t> c;
+            int L[64];
+            bitsliced_berlekamp_massey(c, L, &seq[0], seq.size(), bitSize);
             GF2X poly;
-            for (int i = 0; i < 256; i++) {
-                minPolyLung(poly, sf, i);
+            for (int l = 0; l < lanes; l++) {
+                // minimal polynomial is the reciprocal of connection
+                // polynomial of degree L
+                clear(poly);
+                for (int i = 0; i <= L[l]; i++) {
+                    if ((c[i] >> l) & 1) {
+                        SetCoeff(poly, L[l] - i);
+                    }
+                }
                 LCM(lcm, lcm, poly);
+                if (deg(lcm) == bitSize) {
+                    return true;
+                }
             }
+            return false;
         }
 
-        void minPolyLung(NTL::GF2X& poly, G& sf, int pos) {
+        enum {block_size = 128};
+        int threads;
+        int folded_batches;
+
+        /**
+         * same as minpoly of MTToolBox, but outputs are generated by
+         * generate_block of the generator.
+         */
+        void minPolyBlock(NTL::GF2X& poly, G& sf, int pos) {
             using namespace NTL;
-            using namespace std;
             Vec<GF2> v;
             int size = sf.bitSize();
             v.SetLength(2 * size);
-            for (int i = 0; i < 2 * size; i++) {
-                sf.generate();
-                U w = sf.getParityValue();
-                v[i] = getBitOfPos(w, pos);
+            U buf[block_size];
+            for (int i = 0; i < 2 * size; i += block_size) {
+                int n = 2 * size - i;
+                if (n > block_size) {
+                    n = block_size;
+                }
+                sf.generate_block(buf, n);
+                for (int j = 0; j < n; j++) {
+                    v[i + j] = getBitOfPos(buf[j], pos);
+                }
             }
             MinPolySeq(poly, v, size);
         }
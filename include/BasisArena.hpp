@@ -0,0 +1,229 @@
+#pragma once
+#ifndef BASISARENA_HPP
+#define BASISARENA_HPP
+/**
+ * @file BasisArena.hpp
+ *
+ * @brief contiguous storage of the basis of PIS method
+ *
+ * The lattice of PIS method has bitSize + 1 vectors, each of which
+ * has a generator. When they are allocated one by one, every add()
+ * follows pointers to scattered memory. The arena keeps generator
+ * objects in one cache line aligned block, records of vectors (next,
+ * count, ...) in another block, and the array of the lattice in a
+ * third one. The lattice array holds pointers into the arena, so a
+ * swap exchanges slots of 8 bytes and never moves a generator.
+ *
+ * Generators of a fixed mexp, which the eq tools make by
+ * dispatch_mexp(), have state, lung and previous output inline, so the
+ * whole generator is in its slot. A generator of mexp 0, as used by
+ * the MPI eq tools, has its state array on heap, and only the rest of
+ * it is in the arena. Fields of vectors are kept together in a record,
+ * not split into an array for each field, and lattice entries are
+ * pointers, not indices; both keep the reduction code of MTToolBox
+ * as it is.
+ *
+ * One arena is kept for each thread and each type of generator, and
+ * is reused by later calculations, so nothing is allocated unless
+ * the lattice becomes larger than before. An arena is used by one
+ * calculation at a time through a Lease, a calculation started while
+ * the arena is busy allocates its vectors on heap.
+ */
+#include "devavxprng.h"
+#include <new>
+#include <stdlib.h>
+
+namespace MTToolBox {
+    /**
+     * @class BasisArena
+     * @tparam G generator
+     * @tparam V vector of the lattice, which has a generator
+     */
+    template<typename G, typename V>
+    class BasisArena {
+    public:
+        BasisArena() : gen_block(NULL), vec_block(NULL), ptr_block(NULL),
+                       capacity(0), busy(false) {
+        }
+
+        ~BasisArena() {
+            free(gen_block);
+            free(vec_block);
+            free(ptr_block);
+        }
+
+        /**
+         * @class Lease
+         * @brief use of the arena by one calculation
+         *
+         * Vectors constructed in slots 0, 1, ... are counted by
+         * constructed(). When the lease is destroyed, also by an
+         * exception thrown while the vectors are constructed, the
+         * vectors and their generators are destroyed and the arena is
+         * released.
+         */
+        class Lease {
+        public:
+            Lease() : arena(NULL), count(0) {
+            }
+
+            ~Lease() {
+                release();
+            }
+
+            /**
+             * @param arena arena to be used
+             * @param n number of vectors
+             * @return false if the arena is used by another calculation
+             */
+            bool acquire(BasisArena& arena, int n) {
+                if (!arena.acquire(n)) {
+                    return false;
+                }
+                this->arena = &arena;
+                count = 0;
+                return true;
+            }
+
+            /**
+             * @return true if the arena is held
+             */
+            bool held() const {
+                return arena != NULL;
+            }
+
+            /**
+             * the vector of the next slot has been constructed.
+             */
+            void constructed() {
+                count++;
+            }
+
+            /**
+             * destroy constructed vectors and release the arena.
+             */
+            void release() {
+                if (arena == NULL) {
+                    return;
+                }
+                // vectors are permuted in the lattice, but each keeps
+                // its slot
+                for (int i = 0; i < count; i++) {
+                    V * x = static_cast<V *>(arena->vector(i));
+                    G * g = x->rand;
+                    x->~V();
+                    if (g != NULL) {
+                        g->~G();
+                    }
+                }
+                arena->release();
+                arena = NULL;
+                count = 0;
+            }
+        private:
+            Lease(const Lease&);
+            Lease& operator=(const Lease&);
+
+            BasisArena * arena;
+            int count;
+        };
+
+        /**
+         * @return arena of this thread
+         */
+        static BasisArena& local() {
+            static thread_local BasisArena arena;
+            return arena;
+        }
+
+        /**
+         * Use Lease instead, which releases the arena on exceptions.
+         * @param n number of vectors
+         * @return false if the arena is used by another calculation
+         */
+        bool acquire(int n) {
+            if (busy) {
+                return false;
+            }
+            reserve(n);
+            busy = true;
+            return true;
+        }
+
+        /**
+         * Objects constructed in the arena must be destroyed by the
+         * caller before release.
+         */
+        void release() {
+            busy = false;
+        }
+
+        /**
+         * @param i index of slot
+         * @return storage of i-th generator, not constructed
+         */
+        void * generator(int i) {
+            return gen_block + i * stride<G>();
+        }
+
+        /**
+         * @param i index of slot
+         * @return storage of i-th vector, not constructed
+         */
+        void * vector(int i) {
+            return vec_block + i * stride<V>();
+        }
+
+        /**
+         * @return storage of the lattice array of capacity pointers
+         */
+        V ** lattice() {
+            return ptr_block;
+        }
+    private:
+        BasisArena(const BasisArena&);
+        BasisArena& operator=(const BasisArena&);
+
+        enum { cache_line = 64 };
+
+        /**
+         * @return size of T rounded up to a multiple of cache line
+         */
+        template<typename T>
+        static size_t stride() {
+            return (sizeof(T) + cache_line - 1) / cache_line * cache_line;
+        }
+
+        static char * allocate(size_t size) {
+            void * p;
+            if (posix_memalign(&p, cache_line, size) != 0) {
+                throw std::bad_alloc();
+            }
+            return static_cast<char *>(p);
+        }
+
+        void reserve(int n) {
+            if (n <= capacity) {
+                return;
+            }
+            free(gen_block);
+            free(vec_block);
+            free(ptr_block);
+            gen_block = NULL;
+            vec_block = NULL;
+            ptr_block = NULL;
+            capacity = 0;
+            gen_block = allocate(n * stride<G>());
+            vec_block = allocate(n * stride<V>());
+            ptr_block = reinterpret_cast<V **>(allocate(n * sizeof(V *)));
+            capacity = n;
+        }
+
+        char * gen_block;
+        char * vec_block;
+        V ** ptr_block;
+        int capacity;
+        bool busy;
+    };
+}
+#endif // BASISARENA_HPP
@@ -0,0 +1,88 @@
+#pragma once
+#ifndef BITSLICEDMINPOLY_HPP
+#define BITSLICEDMINPOLY_HPP
+/**
+ * @file BitslicedMinPoly.hpp
+ *
+ * @brief Berlekamp-Massey algorithm for 64 sequences over GF(2) at once
+ *
+ * Bit l of seq[n] is the n-th term of the l-th sequence. Coefficients
+ * of the connection polynomials are kept in the same way, bit l of
+ * c[j] is the coefficient of x^j of the l-th polynomial, so one word
+ * operation updates 64 polynomials.
+ *
+ * B(x) is multiplied by x at every step, then C(x) += B(x) in the lanes
+ * of non zero discrepancy, and B(x) is replaced by the old C(x) in the
+ * lanes where the linear complexity grows. Only the update of L is
+ * done lane by lane.
+ */
+#include "devavxprng.h"
+#include <vector>
+
+namespace MTToolBox {
+    /**
+     * @param[out] c connection polynomials, bit l of c[j] is the
+     * coefficient of x^j of the l-th polynomial, c.size() is
+     * \b max_degree + 1
+     * @param[out] L linear complexity of 64 sequences
+     * @param seq 64 sequences, bit l of seq[n] is the n-th term of the
+     * l-th sequence
+     * @param length number of terms
+     * @param max_degree upper bound of linear complexity, terms of
+     * higher degree are dropped
+     */
+    inline void bitsliced_berlekamp_massey(std::vector<uint64_t>& c,
+                                           int L[64],
+                                           const uint64_t seq[],
+                                           int length,
+                                           int max_degree)
+    {
+        using namespace std;
+        int cap = max_degree + 1;
+        c.assign(cap, 0);
+        c[0] = ~UINT64_C(0);
+        // B(x) is multiplied by x by moving its origin down
+        vector<uint64_t> bbuf(length + cap + 1, 0);
+        int off = length;
+        bbuf[off] = ~UINT64_C(0);
+        int clen = 1;
+        int blen = 1;
+        for (int l = 0; l < 64; l++) {
+            L[l] = 0;
+        }
+        for (int n = 0; n < length; n++) {
+            uint64_t d = 0;
+            int m = clen - 1 < n ? clen - 1 : n;
+            for (int i = 0; i <= m; i++) {
+                d ^= c[i] & seq[n - i];
+            }
+            off--;
+            bbuf[off] = 0;
+            if (blen < cap) {
+                blen++;
+            }
+            if (d == 0) {
+                continue;
+            }
+            uint64_t grow = 0;
+            for (uint64_t r = d; r != 0; r &= r - 1) {
+                int l = __builtin_ctzll(r);
+                if (2 * L[l] <= n) {
+                    grow |= UINT64_C(1) << l;
+                    L[l] = n + 1 - L[l];
+                }
+            }
+            int len = clen > blen ? clen : blen;
+            uint64_t * b = &bbuf[off];
+            for (int j = 0; j < len; j++) {
+                uint64_t cj = c[j];
+                uint64_t bj = b[j];
+                c[j] = cj ^ (d & bj);
+                b[j] = (grow & cj) | (~grow & bj);
+            }
+            clen = len;
+            blen = len;
+        }
+    }
+}
+#endif // BITSLICEDMINPOLY_HPP
@@ -0,0 +1,117 @@
+#pragma once
+#ifndef BULKOUTPUT_HPP
+#define BULKOUTPUT_HPP
+/**
+ * @file BulkOutput.hpp
+ *
+ * @brief output of generators to caller's buffers
+ *
+ * Helpers for fill_bytes() of the generators and the 32-bit, 64-bit
+ * and double views of dSFMT outputs. Outputs are generated by
+ * generate_block() into a small buffer and then copied, so that no
+ * generator state sized value is returned per word.
+ */
+#include "devavxprng.h"
+#include <string.h>
+
+namespace MTToolBox {
+    enum {bulk_block_size = 64};
+
+    /**
+     * fill \b nbytes bytes from \b p by outputs of \b g.
+     * Outputs are same as generate() called sizeof(U) bytes by
+     * sizeof(U) bytes. If \b nbytes is not a multiple of sizeof(U),
+     * the last bytes are the head of one more output.
+     * @tparam U w256_t or w512_t
+     * @tparam G generator which has fill() and generate_block()
+     * @param g generator
+     * @param p buffer
+     * @param nbytes size of buffer in bytes
+     */
+    template<typename U, typename G>
+    void bulk_fill_bytes(G& g, void * p, size_t nbytes)
+    {
+        unsigned char * dst = static_cast<unsigned char *>(p);
+        size_t n = nbytes / sizeof(U);
+        if ((reinterpret_cast<uintptr_t>(dst) % sizeof(uint64_t)) == 0) {
+            g.fill(reinterpret_cast<U *>(dst), n);
+        } else {
+            U buf[bulk_block_size];
+            for (size_t i = 0; i < n; i += bulk_block_size) {
+                int m = bulk_block_size;
+                if (n - i < static_cast<size_t>(bulk_block_size)) {
+                    m = static_cast<int>(n - i);
+                }
+                g.generate_block(buf, m);
+                memcpy(dst + i * sizeof(U), buf, m * sizeof(U));
+            }
+        }
+        size_t rest = nbytes % sizeof(U);
+        if (rest > 0) {
+            U w = g.generate();
+            memcpy(dst + n * sizeof(U), &w, rest);
+        }
+    }
+
+    /**
+     * fill \b out by \b n 64-bit lanes of outputs of \b g, each lane
+     * converted by \b conv. Lanes are taken from u64[0] upward. If \b n
+     * is not a multiple of lanes in U, the rest of the last output is
+     * discarded.
+     * @tparam U w256_t or w512_t
+     * @tparam G generator which has generate_block()
+     * @tparam T type of element of \b out
+     * @param g generator
+     * @param out buffer
+     * @param n number of elements of \b out
+     * @param conv conversion from a lane to T
+     */
+    template<typename U, typename G, typename T>
+    void bulk_fill_lanes(G& g, T * out, size_t n, T (*conv)(uint64_t))
+    {
+        const size_t lanes = sizeof(U) / sizeof(uint64_t);
+        U buf[bulk_block_size];
+        while (n > 0) {
+            size_t k = bulk_block_size * lanes;
+            if (n < k) {
+                k = n;
+            }
+            g.generate_block(buf, static_cast<int>((k + lanes - 1) / lanes));
+            for (size_t i = 0; i < k; i++) {
+                out[i] = conv(buf[i / lanes].u64[i % lanes]);
+            }
+            out += k;
+            n -= k;
+        }
+    }
+
+    /*
+     * conversions of a 64-bit lane of dSFMT output.
+     * The lower 52 bits are the mantissa, the upper 12 bits are the
+     * prefix, which is zero while searching.
+     */
+    inline uint64_t dsfmt_lane_uint64(uint64_t x)
+    {
+        return x;
+    }
+
+    inline uint32_t dsfmt_lane_uint32(uint64_t x)
+    {
+        return static_cast<uint32_t>(x);
+    }
+
+    /**
+     * @return double in [1, 2), like genrand_close1_open2 of dSFMT
+     */
+    inline double dsfmt_lane_double(uint64_t x)
+    {
+        union {
+            uint64_t u;
+            double d;
+        } c;
+        c.u = (x & UINT64_C(0x000fffffffffffff))
+            | UINT64_C(0x3ff0000000000000);
+        return c.d;
+    }
+}
+#endif // BULKOUTPUT_HPP
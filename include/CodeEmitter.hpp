@@ -0,0 +1,596 @@
+#pragma once
+#ifndef CODEEMITTER_HPP
+#define CODEEMITTER_HPP
+/**
+ * @file CodeEmitter.hpp
+ *
+ * @brief emit C source of a generator for one parameter set
+ *
+ * The emitted header has shift amounts, permutation index and masks
+ * as constants, and generates outputs by a pass over the whole state
+ * (gen_rand_all) or straight into the caller's buffer (gen_rand_array)
+ * like SFMT. Initialization ends with period certification of the
+ * lung. A throughput benchmark and a known answer test, whose expected
+ * values are taken from generate() of the search class, are emitted
+ * with it.
+ */
+#include "devavxprng.h"
+#include <string>
+#include <sstream>
+#include <vector>
+#include <ostream>
+
+namespace MTToolBox {
+    /**
+     * @class emit_spec
+     * @brief everything the emitted code depends on
+     */
+    struct emit_spec {
+        /** name of search class, like SFMTAVX2 */
+        std::string type;
+        /** prefix of identifiers in emitted code */
+        std::string name;
+        /** parameter string of get_string() */
+        std::string param_string;
+        /** 256 or 512 */
+        int bits;
+        bool dsfmt;
+        int mexp;
+        /** number of elements of state, not including lung */
+        int n;
+        int pos1;
+        int sl1;
+        int sr1;
+        int perm;
+        /** mat1 of SFMT, msk1 of dSFMT */
+        std::vector<uint64_t> mask;
+        std::vector<uint64_t> parity;
+        /** number of words mixed by seed() of the search class */
+        int mix_words;
+        /** seed of known answer test */
+        std::vector<uint64_t> seed;
+        /** outputs of generate() from seed, lanes of 64 bits */
+        std::vector<std::vector<uint64_t> > expected;
+    };
+
+    /**
+     * @class CodeEmitter
+     * @brief writer of header, benchmark and known answer test
+     */
+    class CodeEmitter {
+    public:
+        explicit CodeEmitter(const emit_spec& spec) : spec(spec) {
+        }
+
+        void emit_header(std::ostream& os) const {
+            std::string s = header_template();
+            if (spec.dsfmt) {
+                s += dsfmt_template();
+            }
+            s += "\n#endif /* @UNAME@_H */\n";
+            os << substitute(s);
+        }
+
+        void emit_kat(std::ostream& os) const {
+            std::stringstream ss;
+            ss << "static const @WORD@ seed[@SEEDWORDS@] = {";
+            for (size_t i = 0; i < spec.seed.size(); i++) {
+                ss << (i == 0 ? "" : ", ") << hex_word(spec.seed[i]);
+            }
+            ss << "};\n\n";
+            ss << "static const uint64_t expected[@K@][@LANES@] = {\n";
+            for (size_t i = 0; i < spec.expected.size(); i++) {
+                ss << "    {";
+                for (size_t j = 0; j < spec.expected[i].size(); j++) {
+                    if (j > 0) {
+                        ss << ",";
+                        ss << ((j % 2 == 0) ? "\n     " : " ");
+                    }
+                    ss << hex64(spec.expected[i][j]);
+                }
+                ss << "},\n";
+            }
+            ss << "};\n";
+            std::string s = kat_template();
+            replace(s, "@EXPECTED@", ss.str());
+            os << substitute(s);
+        }
+
+        void emit_bench(std::ostream& os) const {
+            os << substitute(bench_template());
+        }
+    private:
+        const emit_spec& spec;
+
+        CodeEmitter& operator=(const CodeEmitter&);
+
+        static void replace(std::string& s, const std::string& from,
+                            const std::string& to) {
+            size_t pos = 0;
+            while ((pos = s.find(from, pos)) != std::string::npos) {
+                s.replace(pos, from.size(), to);
+                pos += to.size();
+            }
+        }
+
+        static std::string hex64(uint64_t x) {
+            std::stringstream ss;
+            ss << "UINT64_C(0x" << std::hex << std::setw(16)
+               << std::setfill('0') << x << ")";
+            return ss.str();
+        }
+
+        std::string hex_word(uint64_t x) const {
+            if (spec.dsfmt) {
+                return hex64(x);
+            }
+            std::stringstream ss;
+            ss << "UINT32_C(0x" << std::hex << std::setw(8)
+               << std::setfill('0') << x << ")";
+            return ss.str();
+        }
+
+        static std::string num(long x) {
+            std::stringstream ss;
+            ss << std::dec << x;
+            return ss.str();
+        }
+
+        static std::string upper(const std::string& s) {
+            std::string r = s;
+            for (size_t i = 0; i < r.size(); i++) {
+                if (r[i] >= 'a' && r[i] <= 'z') {
+                    r[i] = r[i] - 'a' + 'A';
+                }
+            }
+            return r;
+        }
+
+        /*
+         * constant vector from 64-bit lanes, lane 0 first
+         */
+        std::string vector_constant(const std::vector<uint64_t>& v) const {
+            std::stringstream ss;
+            if (spec.bits == 256) {
+                ss << "_mm256_set_epi64x(";
+            } else {
+                ss << "_mm512_set_epi64(";
+            }
+            for (int i = static_cast<int>(v.size()) - 1; i >= 0; i--) {
+                ss << "\n        " << hex64(v[i]);
+                if (i > 0) {
+                    ss << ",";
+                }
+            }
+            ss << ")";
+            return ss.str();
+        }
+
+        /*
+         * permutation index, element i of result is element
+         * (i + perm) mod lanes of source
+         */
+        std::string perm_index() const {
+            int lanes = spec.bits / 32;
+            std::stringstream ss;
+            ss << (spec.bits == 256 ? "_mm256_setr_epi32("
+                   : "_mm512_setr_epi32(");
+            for (int i = 0; i < lanes; i++) {
+                ss << ((i + spec.perm) % lanes);
+                if (i < lanes - 1) {
+                    ss << ", ";
+                }
+            }
+            ss << ")";
+            return ss.str();
+        }
+
+        std::string recursion() const {
+            if (spec.bits == 256 && !spec.dsfmt) {
+                return
+"    __m256i l = _mm256_permutevar8x32_epi32(*lung, perm);\n"
+"    __m256i t;\n"
+"    l = _mm256_xor_si256(l, y);\n"
+"    l = _mm256_xor_si256(l, _mm256_slli_epi64(x, @UNAME@_SL1));\n"
+"    *lung = l;\n"
+"    t = _mm256_srli_epi64(_mm256_and_si256(y, mask), @UNAME@_SR1);\n"
+"    return _mm256_xor_si256(_mm256_xor_si256(t, l), x);\n";
+            } else if (spec.bits == 256) {
+                return
+"    __m256i l = _mm256_permutevar8x32_epi32(*lung, perm);\n"
+"    __m256i t;\n"
+"    l = _mm256_xor_si256(l, y);\n"
+"    l = _mm256_xor_si256(l, _mm256_slli_epi64(x, @UNAME@_SL1));\n"
+"    *lung = l;\n"
+"    t = _mm256_xor_si256(_mm256_srli_epi64(l, @UNAME@_SR1), x);\n"
+"    return _mm256_xor_si256(t, _mm256_and_si256(l, mask));\n";
+            } else if (!spec.dsfmt) {
+                return
+"    __m512i l = _mm512_permutexvar_epi32(perm, *lung);\n"
+"    __m512i t;\n"
+"    l = _mm512_ternarylogic_epi64(l, y,\n"
+"            _mm512_slli_epi64(x, @UNAME@_SL1), 0x96);\n"
+"    *lung = l;\n"
+"    t = _mm512_srli_epi64(_mm512_and_si512(y, mask), @UNAME@_SR1);\n"
+"    return _mm512_ternarylogic_epi64(t, l, x, 0x96);\n";
+            } else {
+                return
+"    __m512i l = _mm512_permutexvar_epi32(perm, *lung);\n"
+"    __m512i t;\n"
+"    l = _mm512_ternarylogic_epi64(l, y,\n"
+"            _mm512_slli_epi64(x, @UNAME@_SL1), 0x96);\n"
+"    *lung = l;\n"
+"    t = _mm512_xor_si512(_mm512_srli_epi64(l, @UNAME@_SR1), x);\n"
+"    /* t ^ (l & mask) */\n"
+"    return _mm512_ternarylogic_epi64(t, l, mask, 0x78);\n";
+            }
+        }
+
+        std::string substitute(std::string s) const {
+            int lanes = spec.bits / 64;
+            int seed_words = spec.dsfmt ? lanes : lanes * 2;
+            replace(s, "@RECURSION@", recursion());
+            replace(s, "@PERMIDX@", perm_index());
+            replace(s, "@MASK@", vector_constant(spec.mask));
+            std::stringstream parity;
+            for (size_t i = 0; i < spec.parity.size(); i++) {
+                parity << (i == 0 ? "" : ",") << "\n    "
+                       << hex64(spec.parity[i]);
+            }
+            replace(s, "@PARITY@", parity.str());
+            if (spec.bits == 256) {
+                replace(s, "@VEC@", "__m256i");
+                replace(s, "@LOAD@", "_mm256_loadu_si256((const __m256i *)");
+                replace(s, "@STORE@", "_mm256_storeu_si256((__m256i *)");
+                replace(s, "@OR@", "_mm256_or_si256");
+                replace(s, "@SET1@", "_mm256_set1_epi64x");
+                replace(s, "@FLAGS@", "-mavx2");
+            } else {
+                replace(s, "@VEC@", "__m512i");
+                replace(s, "@LOAD@", "_mm512_loadu_si512((const void *)");
+                replace(s, "@STORE@", "_mm512_storeu_si512((void *)");
+                replace(s, "@OR@", "_mm512_or_si512");
+                replace(s, "@SET1@", "_mm512_set1_epi64");
+                replace(s, "@FLAGS@", "-mavx512f");
+            }
+            if (spec.dsfmt) {
+                replace(s, "@WORD@", "uint64_t");
+                replace(s, "@MULT@", "UINT64_C(6364136223846793005)");
+                replace(s, "@SHIFT@", "62");
+                replace(s, "@MASKINIT@",
+                        "    for (i = 0; i < @UNAME@_N * @SEEDWORDS@; i++) {\n"
+                        "        p[i] &= UINT64_C(0x000fffffffffffff);\n"
+                        "    }\n");
+            } else {
+                replace(s, "@WORD@", "uint32_t");
+                replace(s, "@MULT@", "UINT32_C(1812433253)");
+                replace(s, "@SHIFT@", "30");
+                replace(s, "@MASKINIT@", "");
+            }
+            replace(s, "@SEEDWORDS@", num(seed_words));
+            replace(s, "@MIX@", num(spec.mix_words));
+            replace(s, "@K@", num(spec.expected.size()));
+            replace(s, "@LANES@", num(lanes));
+            replace(s, "@BYTES@", num(spec.bits / 8));
+            replace(s, "@MEXP@", num(spec.mexp));
+            replace(s, "@N@", num(spec.n));
+            replace(s, "@POS1@", num(spec.pos1));
+            replace(s, "@SL1@", num(spec.sl1));
+            replace(s, "@SR1@", num(spec.sr1));
+            replace(s, "@PERM@", num(spec.perm));
+            replace(s, "@PARAM@", spec.param_string);
+            replace(s, "@TYPE@", spec.type);
+            replace(s, "@UNAME@", upper(spec.name));
+            replace(s, "@NAME@", spec.name);
+            return s;
+        }
+
+        static const char * header_template() {
+            return
+"/**\n"
+" * @file @NAME@.h\n"
+" *\n"
+" * @brief @TYPE@ generator of mexp @MEXP@\n"
+" *\n"
+" * Generated by emitgen from parameters\n"
+" * @PARAM@\n"
+" *\n"
+" * Initialization and outputs are same as seed(), followed by\n"
+" * periodCertification(), and generate() of the search class\n"
+" * @TYPE@ in start mode 0 and full weight mode.\n"
+" * Compile with @FLAGS@.\n"
+" */\n"
+"#ifndef @UNAME@_H\n"
+"#define @UNAME@_H\n"
+"\n"
+"#include <stddef.h>\n"
+"#include <stdint.h>\n"
+"#include <string.h>\n"
+"#include <immintrin.h>\n"
+"\n"
+"#define @UNAME@_MEXP @MEXP@\n"
+"#define @UNAME@_N @N@\n"
+"#define @UNAME@_POS1 @POS1@\n"
+"#define @UNAME@_SL1 @SL1@\n"
+"#define @UNAME@_SR1 @SR1@\n"
+"#define @UNAME@_PERM @PERM@\n"
+"/* bytes of one output */\n"
+"#define @UNAME@_BYTES @BYTES@\n"
+"\n"
+"typedef struct {\n"
+"    @VEC@ state[@UNAME@_N];\n"
+"    @VEC@ lung;\n"
+"    /* index of next output in state, @UNAME@_N means empty */\n"
+"    int idx;\n"
+"} @NAME@_t;\n"
+"\n"
+"/* parity check vector of the lung for period certification */\n"
+"static const uint64_t @NAME@_parity[@LANES@] = {@PARITY@};\n"
+"\n"
+"/*\n"
+" * The period is 2^@UNAME@_MEXP - 1 or its multiple if the inner\n"
+" * product of the lung and the parity check vector is 1, otherwise\n"
+" * a bit of the lung is flipped to make it 1.\n"
+" * returns 1 if the lung was not changed, 0 if a bit was flipped.\n"
+" */\n"
+"static inline int @NAME@_period_certification(@NAME@_t *g)\n"
+"{\n"
+"    uint64_t lung[@LANES@];\n"
+"    int c = 0;\n"
+"    int i;\n"
+"    @STORE@lung, g->lung);\n"
+"    for (i = 0; i < @LANES@; i++) {\n"
+"        c ^= __builtin_popcountll(lung[i] & @NAME@_parity[i]) & 1;\n"
+"    }\n"
+"    if (c == 1) {\n"
+"        return 1;\n"
+"    }\n"
+"    if ((@NAME@_parity[0] & 1) == 1) {\n"
+"        lung[0] ^= 1;\n"
+"    } else {\n"
+"        for (i = @LANES@ - 1; i >= 0; i--) {\n"
+"            if (@NAME@_parity[i] != 0) {\n"
+"                lung[i] ^= @NAME@_parity[i] & (~@NAME@_parity[i] + 1);\n"
+"                break;\n"
+"            }\n"
+"        }\n"
+"    }\n"
+"    g->lung = @LOAD@lung);\n"
+"    return 0;\n"
+"}\n"
+"\n"
+"static inline @VEC@ @NAME@_recursion(@VEC@ x, @VEC@ y, @VEC@ *lung)\n"
+"{\n"
+"    const @VEC@ perm = @PERMIDX@;\n"
+"    const @VEC@ mask = @MASK@;\n"
+"@RECURSION@"
+"}\n"
+"\n"
+"/* one pass over the whole state, like gen_rand_all of SFMT */\n"
+"static inline void @NAME@_gen_rand_all(@NAME@_t *g)\n"
+"{\n"
+"    @VEC@ l = g->lung;\n"
+"    int i;\n"
+"    for (i = 0; i < @UNAME@_N - @UNAME@_POS1; i++) {\n"
+"        g->state[i] = @NAME@_recursion(g->state[i],\n"
+"                                       g->state[i + @UNAME@_POS1], &l);\n"
+"    }\n"
+"    for (; i < @UNAME@_N; i++) {\n"
+"        g->state[i] = @NAME@_recursion(\n"
+"            g->state[i], g->state[i + @UNAME@_POS1 - @UNAME@_N], &l);\n"
+"    }\n"
+"    g->lung = l;\n"
+"}\n"
+"\n"
+"/*\n"
+" * n >= @UNAME@_N outputs straight into out, like gen_rand_array of\n"
+" * SFMT. The state must be empty.\n"
+" */\n"
+"static inline void @NAME@_gen_rand_array(@NAME@_t *g, unsigned char *out,\n"
+"                                         size_t n)\n"
+"{\n"
+"    const size_t b = @UNAME@_BYTES;\n"
+"    const size_t sz = @UNAME@_N;\n"
+"    const size_t pos1 = @UNAME@_POS1;\n"
+"    @VEC@ l = g->lung;\n"
+"    size_t i;\n"
+"    for (i = 0; i < sz - pos1; i++) {\n"
+"        @STORE@(out + i * b),\n"
+"            @NAME@_recursion(g->state[i], g->state[i + pos1], &l));\n"
+"    }\n"
+"    for (; i < sz; i++) {\n"
+"        @STORE@(out + i * b),\n"
+"            @NAME@_recursion(g->state[i],\n"
+"                @LOAD@(out + (i + pos1 - sz) * b)), &l));\n"
+"    }\n"
+"    for (; i < n; i++) {\n"
+"        @STORE@(out + i * b),\n"
+"            @NAME@_recursion(@LOAD@(out + (i - sz) * b)),\n"
+"                @LOAD@(out + (i - sz + pos1) * b)), &l));\n"
+"    }\n"
+"    for (i = 0; i < sz; i++) {\n"
+"        g->state[i] = @LOAD@(out + (n - sz + i) * b));\n"
+"    }\n"
+"    g->lung = l;\n"
+"}\n"
+"\n"
+"/*\n"
+" * Initialization by seed() and periodCertification() of the search\n"
+" * class. The search class outputs state[1] first, so the state is\n"
+" * rotated by one.\n"
+" */\n"
+"static inline void @NAME@_init(@NAME@_t *g,\n"
+"                                const @WORD@ seed[@SEEDWORDS@])\n"
+"{\n"
+"    @WORD@ p[(@UNAME@_N + 1) * @SEEDWORDS@];\n"
+"    int i;\n"
+"    memset(p, 0, sizeof(p));\n"
+"    memcpy(p, seed, sizeof(@WORD@) * @SEEDWORDS@);\n"
+"    for (i = 1; i < @MIX@; i++) {\n"
+"        p[i] ^= (@WORD@)i + @MULT@ * (p[i - 1] ^ (p[i - 1] >> @SHIFT@));\n"
+"    }\n"
+"@MASKINIT@"
+"    for (i = 0; i < @UNAME@_N; i++) {\n"
+"        g->state[i] = @LOAD@(p + ((i + 1) % @UNAME@_N) * @SEEDWORDS@));\n"
+"    }\n"
+"    g->lung = @LOAD@(p + @UNAME@_N * @SEEDWORDS@));\n"
+"    g->idx = @UNAME@_N;\n"
+"    @NAME@_period_certification(g);\n"
+"}\n"
+"\n"
+"static inline @VEC@ @NAME@_next(@NAME@_t *g)\n"
+"{\n"
+"    if (g->idx >= @UNAME@_N) {\n"
+"        @NAME@_gen_rand_all(g);\n"
+"        g->idx = 0;\n"
+"    }\n"
+"    return g->state[g->idx++];\n"
+"}\n"
+"\n"
+"/*\n"
+" * n outputs of @UNAME@_BYTES bytes to out, same as n calls of\n"
+" * @NAME@_next(). out need not be aligned.\n"
+" */\n"
+"static inline void @NAME@_fill(@NAME@_t *g, void *out, size_t n)\n"
+"{\n"
+"    unsigned char *p = (unsigned char *)out;\n"
+"    while (n > 0 && g->idx < @UNAME@_N) {\n"
+"        @STORE@p, g->state[g->idx++]);\n"
+"        p += @UNAME@_BYTES;\n"
+"        n--;\n"
+"    }\n"
+"    if (n >= (size_t)@UNAME@_N) {\n"
+"        @NAME@_gen_rand_array(g, p, n);\n"
+"        return;\n"
+"    }\n"
+"    while (n > 0) {\n"
+"        @STORE@p, @NAME@_next(g));\n"
+"        p += @UNAME@_BYTES;\n"
+"        n--;\n"
+"    }\n"
+"}\n";
+        }
+
+        static const char * dsfmt_template() {
+            return
+"\n"
+"/*\n"
+" * doubles in [1, 2), each 64-bit lane of outputs gives one.\n"
+" * n must be a multiple of @LANES@.\n"
+" */\n"
+"static inline void @NAME@_fill_close1_open2(@NAME@_t *g, double *out,\n"
+"                                            size_t n)\n"
+"{\n"
+"    const @VEC@ one = @SET1@(0x3ff0000000000000LL);\n"
+"    unsigned char *p = (unsigned char *)out;\n"
+"    size_t i;\n"
+"    @NAME@_fill(g, out, n / @LANES@);\n"
+"    for (i = 0; i < n / @LANES@; i++) {\n"
+"        @STORE@(p + i * @UNAME@_BYTES),\n"
+"            @OR@(@LOAD@(p + i * @UNAME@_BYTES)), one));\n"
+"    }\n"
+"}\n";
+        }
+
+        static const char * kat_template() {
+            return
+"/**\n"
+" * @file @NAME@_kat.c\n"
+" *\n"
+" * @brief known answer test of @NAME@.h\n"
+" *\n"
+" * Expected values are outputs of generate() of the search class\n"
+" * @TYPE@ after periodCertification() fixed the lung from seed.\n"
+" * The first third is checked through @NAME@_next(), the rest\n"
+" * through @NAME@_fill().\n"
+" */\n"
+"#include <stdio.h>\n"
+"#include \"@NAME@.h\"\n"
+"\n"
+"@EXPECTED@"
+"\n"
+"int main(void)\n"
+"{\n"
+"    static uint64_t buf[@K@][@LANES@];\n"
+"    @NAME@_t g;\n"
+"    int i;\n"
+"    int k = @K@;\n"
+"    @NAME@_init(&g, seed);\n"
+"    if (!@NAME@_period_certification(&g)) {\n"
+"        printf(\"@NAME@: NG period certification\\n\");\n"
+"        return 1;\n"
+"    }\n"
+"    for (i = 0; i < k / 3; i++) {\n"
+"        @STORE@buf[i], @NAME@_next(&g));\n"
+"    }\n"
+"    @NAME@_fill(&g, buf[k / 3], k - k / 3);\n"
+"    for (i = 0; i < k; i++) {\n"
+"        if (memcmp(buf[i], expected[i], @UNAME@_BYTES) != 0) {\n"
+"            printf(\"@NAME@: NG at %d\\n\", i);\n"
+"            return 1;\n"
+"        }\n"
+"    }\n"
+"    printf(\"@NAME@: OK\\n\");\n"
+"    return 0;\n"
+"}\n";
+        }
+
+        static const char * bench_template() {
+            return
+"/**\n"
+" * @file @NAME@_bench.c\n"
+" *\n"
+" * @brief throughput of @NAME@_fill()\n"
+" *\n"
+" * usage: @NAME@_bench [rounds]\n"
+" */\n"
+"#define _POSIX_C_SOURCE 199309L\n"
+"#include <stdio.h>\n"
+"#include <stdlib.h>\n"
+"#include <time.h>\n"
+"#include \"@NAME@.h\"\n"
+"\n"
+"int main(int argc, char **argv)\n"
+"{\n"
+"    const size_t n = @UNAME@_N > 16384 ? @UNAME@_N : 16384;\n"
+"    long rounds = 1000;\n"
+"    static const @WORD@ seed[@SEEDWORDS@] = {1};\n"
+"    @NAME@_t g;\n"
+"    uint64_t *buf;\n"
+"    uint64_t sum = 0;\n"
+"    struct timespec start;\n"
+"    struct timespec end;\n"
+"    double sec;\n"
+"    double bytes;\n"
+"    long r;\n"
+"    size_t i;\n"
+"    if (argc > 1) {\n"
+"        rounds = atol(argv[1]);\n"
+"    }\n"
+"    buf = malloc(n * @UNAME@_BYTES);\n"
+"    if (buf == NULL) {\n"
+"        return 1;\n"
+"    }\n"
+"    @NAME@_init(&g, seed);\n"
+"    clock_gettime(CLOCK_MONOTONIC, &start);\n"
+"    for (r = 0; r < rounds; r++) {\n"
+"        @NAME@_fill(&g, buf, n);\n"
+"        sum ^= buf[r % (n * @LANES@)];\n"
+"    }\n"
+"    clock_gettime(CLOCK_MONOTONIC, &end);\n"
+"    for (i = 0; i < n * @LANES@; i++) {\n"
+"        sum ^= buf[i];\n"
+"    }\n"
+"    sec = (end.tv_sec - start.tv_sec)\n"
+"        + (end.tv_nsec - start.tv_nsec) * 1e-9;\n"
+"    bytes = (double)rounds * n * @UNAME@_BYTES;\n"
+"    printf(\"@NAME@: %.3f GB/s, %.3f ns per 64 bits (check %016llx)\\n\",\n"
+"           bytes / sec * 1e-9, sec * 1e9 / (bytes / 8),\n"
+"           (unsigned long long)sum);\n"
+"    free(buf);\n"
+"    return 0;\n"
+"}\n";
+        }
+    };
+}
+#endif // CODEEMITTER_HPP
@@ -5,6 +5,8 @@
  * @file DCOptions.hpp
  */
 #include "devavxprng.h"
+#include "SIMDKernel.hpp"
+#include "MexpDispatch.hpp"
 #include <string>
 #include <sstream>
 #include <fstream>
@@ -25,8 +27,22 @@ namespace MTToolBox {
         int fixedSR1;
         int fixedPerm;
         uint64_t seed;
+        /** rank of MPI process, 0 if not MPI, see worker_seed() */
+        int rank;
         long count;
         int min_mexp;
+        bool stream_mode;
+        long stream_first;
+        int threads;
+        bool pipeline_mode;
+        /** threads of search, preparation and equidistribution */
+        int pipeline[3];
+        /** limits of the sum of defects, -1 means no limit */
+        int max_delta32;
+        int max_delta64;
+        int max_delta52;
+        /** method of fix point of dSFMT, poly, direct, auto or check */
+        std::string fixpoint;
 
         DCOptions(int min_mexp) {
             mexp = 0;
@@ -39,8 +55,41 @@ namespace MTToolBox {
             fixedSR1 = 0;
             fixedPerm = 0;
             seed = (uint64_t)clock();
+            rank = 0;
             count = 1;
             this->min_mexp = min_mexp;
+            stream_mode = false;
+            stream_first = 0;
+            threads = 0;
+            pipeline_mode = false;
+            pipeline[0] = 1;
+            pipeline[1] = 1;
+            pipeline[2] = 1;
+            max_delta32 = -1;
+            max_delta64 = -1;
+            max_delta52 = -1;
+            fixpoint = "poly";
+        }
+
+        /**
+         * @return true if any limit of the sum of defects is given
+         */
+        bool hasMaxDelta() const {
+            return max_delta32 >= 0 || max_delta64 >= 0 || max_delta52 >= 0;
+        }
+        /**
+         * @return true if all shift and permutation parameters are
+         * fixed to the given values, in other words, the search can use
+         * a generator specialized at compile time.
+         */
+        bool allFixed(int sl1, int sr1, int perm) const {
+            if (!fixedL || !fixedP) {
+                return false;
+            }
+            if (useSR1 && (!fixedR || fixedSR1 != sr1)) {
+                return false;
+            }
+            return fixedSL1 == sl1 && fixedPerm == perm;
         }
 #if defined(DEBUG)
         void d_p() {
@@ -55,8 +104,19 @@ namespace MTToolBox {
             cout << "fixedSR1:" << dec << fixedSR1 << endl;
             cout << "fixedPerm:" << dec << fixedPerm << endl;
             cout << "seed:" << dec << seed << endl;
+            cout << "rank:" << dec << rank << endl;
             cout << "count:" << dec << count << endl;
             cout << "min_mexp:" << dec << min_mexp << endl;
+            cout << "stream_mode:" << stream_mode << endl;
+            cout << "stream_first:" << dec << stream_first << endl;
+            cout << "threads:" << dec << threads << endl;
+            cout << "pipeline_mode:" << pipeline_mode << endl;
+            cout << "pipeline:" << dec << pipeline[0] << ","
+                 << pipeline[1] << "," << pipeline[2] << endl;
+            cout << "max_delta32:" << dec << max_delta32 << endl;
+            cout << "max_delta64:" << dec << max_delta64 << endl;
+            cout << "max_delta52:" << dec << max_delta52 << endl;
+            cout << "fixpoint:" << fixpoint << endl;
         }
 #endif
         /**
@@ -72,6 +132,8 @@ namespace MTToolBox {
             int c;
             bool error = false;
             string pgm = argv[0];
+            enum {max_delta32_opt = 256, max_delta64_opt, max_delta52_opt,
+                  fixpoint_opt};
             static struct option longopts[] = {
                 {"verbose", no_argument, NULL, 'v'},
                 {"fixed-SL1", optional_argument, NULL, 'L'},
@@ -79,10 +141,19 @@ namespace MTToolBox {
                 {"fixed-Perm", optional_argument, NULL, 'P'},
                 {"count", required_argument, NULL, 'c'},
                 {"seed", required_argument, NULL, 's'},
+                {"kernel", required_argument, NULL, 'k'},
+                {"stream-id", required_argument, NULL, 'i'},
+                {"threads", required_argument, NULL, 't'},
+                {"pipeline", required_argument, NULL, 'p'},
+                {"max-delta32", required_argument, NULL, max_delta32_opt},
+                {"max-delta64", required_argument, NULL, max_delta64_opt},
+                {"max-delta52", required_argument, NULL, max_delta52_opt},
+                {"fixpoint", required_argument, NULL, fixpoint_opt},
                 {NULL, 0, NULL, 0}};
             errno = 0;
             for (;;) {
-                c = getopt_long(argc, argv, "vs:c:L::R::P::", longopts, NULL);
+                c = getopt_long(argc, argv, "vs:c:k:i:t:p:L::R::P::",
+                                longopts, NULL);
                 if (error) {
                     break;
                 }
@@ -133,6 +204,64 @@ namespace MTToolBox {
                         }
                     }
                     break;
+                case 'k':
+#if defined(RUNTIME_DISPATCH)
+                    if (!select_kernel(optarg)) {
+                        error = true;
+                        cerr << "kernel must be one of auto, scalar, avx2, "
+                             << "avx512 and runnable on this CPU" << endl;
+                    }
+#else
+                    error = true;
+                    cerr << "--kernel needs configure --enable-dispatch"
+                         << endl;
+#endif
+                    break;
+                case 'i':
+                    stream_mode = true;
+                    stream_first = strtol(optarg, NULL, 10);
+                    if (errno || stream_first < 0) {
+                        error = true;
+                        cerr << "stream id must be a non negative number"
+                             << endl;
+                    }
+                    break;
+                case 't':
+                    threads = strtol(optarg, NULL, 10);
+                    if (errno || threads < 1) {
+                        error = true;
+                        cerr << "threads must be a positive number" << endl;
+                    }
+                    break;
+                case 'p':
+                    pipeline_mode = true;
+                    if (!parse_pipeline(optarg)) {
+                        error = true;
+                        cerr << "pipeline must be three positive numbers"
+                             << " separated by comma" << endl;
+                    }
+                    break;
+                case max_delta32_opt:
+                    error = !parse_max_delta(optarg, max_delta32, useSR1);
+                    break;
+                case max_delta64_opt:
+                    error = !parse_max_delta(optarg, max_delta64, useSR1);
+                    break;
+                case max_delta52_opt:
+                    error = !parse_max_delta(optarg, max_delta52, !useSR1);
+                    break;
+                case fixpoint_opt:
+                    fixpoint = optarg;
+                    if (useSR1) {
+                        error = true;
+                        cerr << "--fixpoint is an option of dSFMT" << endl;
+                    } else if (fixpoint != "poly" && fixpoint != "direct"
+                               && fixpoint != "check") {
+                        error = true;
+                        cerr << "fixpoint must be one of poly, direct "
+                             << "and check" << endl;
+                    }
+                    break;
                 case 'c':
                     count = strtoll(optarg, NULL, 10);
                     if (errno) {
@@ -146,16 +275,21 @@ namespace MTToolBox {
                     break;
                 }
             }
+            if (stream_mode && (count < 1 || stream_first + count > 65536)) {
+                error = true;
+                cerr << "stream ids must be from 0 to 65535" << endl;
+            }
+            if (stream_mode && pipeline_mode) {
+                error = true;
+                cerr << "pipeline can't be used in stream mode" << endl;
+            }
             argc -= optind;
             argv += optind;
             if (argc < 1) {
                 error = true;
             } else {
                 long mexp = strtol(argv[0], NULL, 10);
-                const int allowed_mexp[] = {607, 1279, 2281, 3217,
-                                            4253, 4423,
-                                            9689, 9941, 11213, 19937,
-                                            21701, 23209, 44497, -1};
+                const int * allowed_mexp = supported_mexp;
                 if (! errno) {
                     if (mexp < min_mexp) {
                         error = true;
@@ -190,6 +324,47 @@ namespace MTToolBox {
             return true;
         }
     private:
+        /**
+         * @param str numbers of threads of stages, like 1,1,4
+         * @return false if \b str is not three positive numbers
+         */
+        bool parse_pipeline(const char * str) {
+            char * end;
+            for (int i = 0; i < 3; i++) {
+                pipeline[i] = strtol(str, &end, 10);
+                if (errno || end == str || pipeline[i] < 1) {
+                    return false;
+                }
+                if (*end != (i < 2 ? ',' : '\0')) {
+                    return false;
+                }
+                str = end + 1;
+            }
+            return true;
+        }
+
+        /**
+         * @param str limit of the sum of defects
+         * @param max_delta limit parsed
+         * @param allowed the option is for this generator
+         * @return false if \b str is not a non negative number
+         */
+        bool parse_max_delta(const char * str, int& max_delta,
+                             bool allowed) {
+            using namespace std;
+            if (!allowed) {
+                cerr << "max-delta32 and max-delta64 are for SFMT, "
+                     << "max-delta52 is for dSFMT" << endl;
+                return false;
+            }
+            max_delta = strtol(str, NULL, 10);
+            if (errno || max_delta < 0) {
+                cerr << "max delta must be a non negative number" << endl;
+                return false;
+            }
+            return true;
+        }
+
         /**
          * showing help message
          * @param pgm program name
@@ -198,7 +373,8 @@ namespace MTToolBox {
             using namespace std;
             cerr << "usage:" << endl;
             cerr << pgm
-                 << " [-s seed] [-v] [-c count]";
+                 << " [-s seed] [-v] [-c count] [-k kernel] [-i first-id]"
+                 << " [-t threads] [-p s,a,e]";
             cerr << " [-L [value]] ";
             if (useSR1) {
                 cerr << "[-R [value]] ";
@@ -213,6 +389,54 @@ namespace MTToolBox {
                  << "--count, -c count             Output count. The number of "
                  << "parameters to be outputted.\n"
                  << "--seed, -s seed               seed of randomness.\n"
+                 << "--kernel, -k kernel           auto, scalar, avx2 or "
+                 << "avx512. SIMD kernel used in\n"
+                 << "                              search. "
+                 << "(--enable-dispatch)\n"
+                 << "--stream-id, -i first-id      stream mode. Search count "
+                 << "streams of ids from\n"
+                 << "                              first-id, which have "
+                 << "distinct characteristic\n"
+                 << "                              polynomials, concurrently. "
+                 << "Output one table\n"
+                 << "                              in the order of id.\n"
+                 << "--threads, -t threads         number of search threads."
+                 << " Needs NTL built\n"
+                 << "                              with NTL_THREADS. Stream "
+                 << "mode uses all cores\n"
+                 << "                              by default.\n"
+                 << "--pipeline, -p s,a,e          pipeline mode. Use s "
+                 << "threads for search,\n"
+                 << "                              a threads for parity and "
+                 << "annihilation, and e\n"
+                 << "                              threads for "
+                 << "equidistribution.\n";
+            if (useSR1) {
+                cerr << "--max-delta32 delta           discard parameters "
+                     << "whose sum of 32-bit\n"
+                     << "                              dimension defects "
+                     << "exceeds delta.\n"
+                     << "--max-delta64 delta           same for 64-bit.\n";
+            } else {
+                cerr << "--max-delta52 delta           discard parameters "
+                     << "whose sum of 52-bit\n"
+                     << "                              dimension defects "
+                     << "exceeds delta.\n"
+                     << "--fixpoint method             poly: fix point by "
+                     << "polynomials, direct:\n"
+                     << "                              by linear equation, "
+                     << "check: both, and\n"
+                     << "                              compare them. "
+                     << "direct is much slower\n"
+                     << "                              and is for "
+                     << "validation.\n"
+                     << "                              direct and check "
+                     << "are limited to states\n"
+                     << "                              of 11585 bits, a "
+                     << "matrix of 16 MB.\n"
+                     << "                              default poly.\n";
+            }
+            cerr
                  << "--fixed-SL1, -L [shift-value] "
                  << "use fixed shift parameter.\n";
             if (useSR1) {
@@ -5,6 +5,7 @@
  * @file EQOptions.hpp
  */
 #include "devavxprng.h"
+#include "SIMDKernel.hpp"
 #include <stdlib.h>
 #include <getopt.h>
 
@@ -14,12 +15,30 @@ namespace MTToolBox {
     public:
         bool verbose;
         uint64_t seed;
+        /**
+         * threads of start mode and weight mode, and of LCM of
+         * minimal polynomials, 0 for all cores, see also mpi_threads()
+         */
+        int threads;
+        /**
+         * schedule tasks of each bit mode, start mode and weight mode
+         * by WorkStealing
+         */
+        bool work_stealing;
+        /**
+         * compare k(v) by one lattice for all v with k(v) by a lattice
+         * for each v
+         */
+        bool check;
         P params;
 
         EQOptions() {
             using namespace std;
             verbose = false;
             seed = (uint64_t)clock();
+            threads = 0;
+            work_stealing = false;
+            check = false;
         }
 
         /**
@@ -40,9 +59,13 @@ namespace MTToolBox {
             static struct option longopts[] = {
                 {"verbose", no_argument, NULL, 'v'},
                 {"seed", required_argument, NULL, 's'},
+                {"kernel", required_argument, NULL, 'k'},
+                {"threads", required_argument, NULL, 't'},
+                {"work-stealing", no_argument, NULL, 'w'},
+                {"check", no_argument, NULL, 'c'},
                 {NULL, 0, NULL, 0}};
             for (;;) {
-                c = getopt_long(argc, argv, "vs:", longopts, NULL);
+                c = getopt_long(argc, argv, "vs:k:t:wc", longopts, NULL);
                 if (error) {
                     break;
                 }
@@ -60,6 +83,32 @@ namespace MTToolBox {
                         cerr << "seed must be a number" << endl;
                     }
                     break;
+                case 'k':
+#if defined(RUNTIME_DISPATCH)
+                    if (!select_kernel(optarg)) {
+                        error = true;
+                        cerr << "kernel must be one of auto, scalar, avx2, "
+                             << "avx512 and runnable on this CPU" << endl;
+                    }
+#else
+                    error = true;
+                    cerr << "--kernel needs configure --enable-dispatch"
+                         << endl;
+#endif
+                    break;
+                case 't':
+                    threads = strtol(optarg, NULL, 10);
+                    if (errno || threads < 1) {
+                        error = true;
+                        cerr << "threads must be a positive number" << endl;
+                    }
+                    break;
+                case 'w':
+                    work_stealing = true;
+                    break;
+                case 'c':
+                    check = true;
+                    break;
                 case '?':
                 default:
                     error = true;
@@ -88,14 +137,31 @@ namespace MTToolBox {
                 using namespace std;
                 cerr << "usage:" << endl;
                 cerr << pgm
-                     << " [-v] [-s] \""
+                     << " [-v] [-s] [-k kernel] [-t threads] [-w] [-c] \""
                      << params.get_header()
                      << "\""
                      << endl;
                 cerr << "\n"
                      << "--verbose, -v        Verbose mode. Output detailed "
                      << "information.\n"
-                     << "--seed, -s seed      seed of randomness.\n";
+                     << "--seed, -s seed      seed of randomness.\n"
+                     << "--kernel, -k kernel  auto, scalar, avx2 or avx512.\n"
+                     << "--threads, -t threads number of threads evaluating "
+                     << "start modes and\n"
+                     << "                     weight modes, and calculating "
+                     << "minimal\n"
+                     << "                     polynomials. All cores by "
+                     << "default, shared by\n"
+                     << "                     MPI processes of a node "
+                     << "in MPI tools.\n"
+                     << "--work-stealing, -w  schedule each bit mode, "
+                     << "start mode and weight\n"
+                     << "                     mode as a task of work "
+                     << "stealing threads.\n"
+                     << "--check, -c          compute k(v) by one lattice "
+                     << "for all v and by a\n"
+                     << "                     lattice for each v, and "
+                     << "compare them.\n";
         }
     };
 }
@@ -0,0 +1,153 @@
+#pragma once
+#ifndef EMITOPTIONS_HPP
+#define EMITOPTIONS_HPP
+/**
+ * @file EmitOptions.hpp
+ */
+#include "devavxprng.h"
+#include <string>
+
+namespace MTToolBox {
+    /**
+     * options of generator code emitter
+     */
+    class EmitOptions {
+    public:
+        bool verbose;
+        int kat_count;
+        std::string type;
+        std::string outdir;
+        std::string name;
+
+        EmitOptions() {
+            verbose = false;
+            kat_count = 0;
+            outdir = ".";
+        }
+
+        /**
+         * command line option parser
+         * @param argc number of command line arguments
+         * @param argv command line arguments
+         * @return command line options have error, or not
+         */
+        bool parse(int argc, char **argv) {
+            using namespace std;
+            int c;
+            bool error = false;
+            string pgm = argv[0];
+            static struct option longopts[] = {
+                {"verbose", no_argument, NULL, 'v'},
+                {"type", required_argument, NULL, 't'},
+                {"outdir", required_argument, NULL, 'o'},
+                {"name", required_argument, NULL, 'n'},
+                {"count", required_argument, NULL, 'c'},
+                {NULL, 0, NULL, 0}};
+            errno = 0;
+            for (;;) {
+                c = getopt_long(argc, argv, "vt:o:n:c:", longopts, NULL);
+                if (error) {
+                    break;
+                }
+                if (c == -1) {
+                    break;
+                }
+                switch (c) {
+                case 'v':
+                    verbose = true;
+                    break;
+                case 't':
+                    type = optarg;
+                    if (type != "SFMTAVX2" && type != "SFMTAVX512F"
+                        && type != "dSFMTAVX2" && type != "dSFMTAVX512F") {
+                        error = true;
+                        cerr << "type must be one of SFMTAVX2, SFMTAVX512F, "
+                             << "dSFMTAVX2 and dSFMTAVX512F" << endl;
+                    }
+                    break;
+                case 'o':
+                    outdir = optarg;
+                    break;
+                case 'n':
+                    name = optarg;
+                    if (!valid_name(name)) {
+                        error = true;
+                        cerr << "name must be a C identifier" << endl;
+                    }
+                    break;
+                case 'c':
+                    kat_count = strtol(optarg, NULL, 10);
+                    if (errno || kat_count < 0) {
+                        error = true;
+                        cerr << "count must be a non negative number"
+                             << endl;
+                    }
+                    break;
+                case '?':
+                default:
+                    error = true;
+                    break;
+                }
+            }
+            if (type.empty()) {
+                error = true;
+            }
+            if (error) {
+                output_help(pgm);
+                return false;
+            }
+            if (name.empty()) {
+                for (size_t i = 0; i < type.size(); i++) {
+                    name += static_cast<char>(tolower(type[i]));
+                }
+            }
+            return true;
+        }
+    private:
+        static bool valid_name(const std::string& s) {
+            if (s.empty() || isdigit(static_cast<unsigned char>(s[0]))) {
+                return false;
+            }
+            for (size_t i = 0; i < s.size(); i++) {
+                if (!isalnum(static_cast<unsigned char>(s[i]))
+                    && s[i] != '_') {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * showing help message
+         * @param pgm program name
+         */
+        void output_help(std::string& pgm) {
+            using namespace std;
+            cerr << "usage:" << endl;
+            cerr << pgm
+                 << " [-v] [-o outdir] [-n name] [-c count] -t type"
+                 << " < parameters" << endl;
+            cerr << "\n"
+                 << "--verbose, -v         Verbose mode. Output names of "
+                 << "files written.\n"
+                 << "--type, -t type       SFMTAVX2, SFMTAVX512F, dSFMTAVX2 "
+                 << "or dSFMTAVX512F.\n"
+                 << "--outdir, -o outdir   directory of emitted files. "
+                 << "default current directory.\n"
+                 << "--name, -n name       prefix of identifiers and file "
+                 << "names, followed by\n"
+                 << "                      _mexp_line. default lower case "
+                 << "type.\n"
+                 << "--count, -c count     number of outputs checked by known "
+                 << "answer test.\n"
+                 << "                      default three times the state "
+                 << "size.\n"
+                 << "parameters            lines of parameters output by "
+                 << "dc tools, from\n"
+                 << "                      standard input. Lines starting "
+                 << "with '#' are ignored.\n";
+            cerr << endl;
+        }
+    };
+}
+#endif // EMITOPTIONS_HPP
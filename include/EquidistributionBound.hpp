@@ -0,0 +1,156 @@
+#pragma once
+#ifndef EQUIDISTRIBUTIONBOUND_HPP
+#define EQUIDISTRIBUTIONBOUND_HPP
+/**
+ * @file EquidistributionBound.hpp
+ *
+ * @brief branch and bound of the sum of dimension defects
+ *
+ * The defect d(v) = floor(mexp / v) - k(v) is not negative, so the sum
+ * of defects computed so far is a lower bound of the sum of all
+ * defects. k(v) is computed for v = bit_len down to 1, as PIS method
+ * does on one lattice projected to one bit less at each step, and the
+ * candidate is abandoned as soon as the partial sum exceeds the limit.
+ * The steps not taken are the time saved.
+ *
+ * k(v) is not increasing in v, but k(u) of u > v only bounds d(v)
+ * from above, so it can't be used to abandon the candidate earlier.
+ */
+#include "devavxprng.h"
+#include <vector>
+#include <ostream>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+
+namespace MTToolBox {
+    /**
+     * @class DeltaBoundStats
+     * @brief number of candidates pruned and computations of k(v)
+     * saved, shared by search threads
+     */
+    class DeltaBoundStats {
+    public:
+        DeltaBoundStats() : candidates(0), pruned(0), evaluated(0),
+                            skipped(0), full_nanos(max_length + 1, 0),
+                            full_count(max_length + 1, 0),
+                            pruned_nanos(max_length + 1, 0),
+                            pruned_count(max_length + 1, 0) {
+        }
+
+        /**
+         * @param is_pruned candidate was abandoned
+         */
+        void add_candidate(bool is_pruned) {
+            candidates++;
+            if (is_pruned) {
+                pruned++;
+            }
+        }
+
+        /**
+         * record one computation of k(v) of v = eval + skip down to 1.
+         * @param eval number of k(v) computed
+         * @param skip number of k(v) not computed, 0 if no k(v) is
+         * skipped
+         * @param nanos time to compute k(v)
+         */
+        void add_evaluations(int eval, int skip, long nanos) {
+            using namespace std;
+            evaluated += eval;
+            skipped += skip;
+            int length = eval + skip;
+            if (length <= 0 || length > max_length) {
+                return;
+            }
+            lock_guard<mutex> guard(lock);
+            if (skip == 0) {
+                full_nanos[length] += nanos;
+                full_count[length]++;
+            } else {
+                pruned_nanos[length] += nanos;
+                pruned_count[length]++;
+            }
+        }
+
+        /**
+         * print statistics. Time saved is the mean time of the
+         * computations of all k(v) of the same bit length, which were
+         * not abandoned, times the number of abandoned ones, less the
+         * time of abandoned ones. Bit lengths without computations of
+         * all k(v) are not counted.
+         * @param os output stream
+         */
+        void print(std::ostream& os) const {
+            using namespace std;
+            double saved = 0;
+            {
+                lock_guard<mutex> guard(lock);
+                for (int len = 1; len <= max_length; len++) {
+                    if (full_count[len] == 0) {
+                        continue;
+                    }
+                    double mean = static_cast<double>(full_nanos[len])
+                        / full_count[len];
+                    saved += mean * pruned_count[len] - pruned_nanos[len];
+                }
+            }
+            os << "candidates = " << dec << candidates
+               << ", pruned = " << pruned
+               << ", k(v) skipped = " << skipped
+               << ", estimated time saved = " << saved / 1.0e9 << "s"
+               << endl;
+        }
+    private:
+        enum {max_length = 64};
+        std::atomic<long> candidates;
+        std::atomic<long> pruned;
+        std::atomic<long> evaluated;
+        std::atomic<long> skipped;
+        mutable std::mutex lock;
+        std::vector<long> full_nanos;
+        std::vector<long> full_count;
+        std::vector<long> pruned_nanos;
+        std::vector<long> pruned_count;
+    };
+
+    /**
+     * sum of dimension defects with branch and bound.
+     * @param kv function object, kv(v) returns k(v). It is called for
+     * v = bit_len, bit_len - 1, ... in this order, and stops at the
+     * step where the candidate is abandoned.
+     * @param veq k(v) of v = 1..bit_len, -1 if not computed
+     * @param bit_len maximum v
+     * @param mexp Mersenne exponent
+     * @param max_delta limit of the sum of defects
+     * @param stats statistics
+     * @return sum of defects, or a lower bound of it greater than
+     * \b max_delta if the candidate is abandoned
+     */
+    template<typename F>
+    int calc_equidistribution_bound(F& kv, int veq[], int bit_len,
+                                    int mexp, int max_delta,
+                                    DeltaBoundStats& stats)
+    {
+        using namespace std;
+        for (int i = 0; i < bit_len; i++) {
+            veq[i] = -1;
+        }
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        int sum = 0;
+        int eval = 0;
+        for (int v = bit_len; v > 0; v--) {
+            veq[v - 1] = kv(v);
+            eval++;
+            sum += mexp / v - veq[v - 1];
+            if (sum > max_delta) {
+                break;
+            }
+        }
+        long nanos = chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now() - start).count();
+        stats.add_evaluations(eval, bit_len - eval, nanos);
+        return sum;
+    }
+}
+#endif // EQUIDISTRIBUTIONBOUND_HPP
@@ -0,0 +1,188 @@
+#pragma once
+#ifndef GF2MATRIX_HPP
+#define GF2MATRIX_HPP
+/**
+ * @file GF2Matrix.hpp
+ *
+ * @brief bit packed matrix over GF(2) and linear equation solver
+ *
+ * Rows are packed into 64 bit words. Gaussian elimination follows the
+ * method of four Russians (M4RI): pivots of a strip of k columns are
+ * found first, then a table of the 2^k sums of the k pivot rows is
+ * made, and each of the other rows is reduced by one addition of a
+ * row of the table, instead of up to k additions.
+ */
+#include "devavxprng.h"
+#include <vector>
+
+namespace MTToolBox {
+    /**
+     * @class GF2Matrix
+     * @brief matrix over GF(2), rows are packed into words
+     */
+    class GF2Matrix {
+    public:
+        /**
+         * zero matrix.
+         * @param rows number of rows
+         * @param cols number of columns
+         */
+        GF2Matrix(int rows, int cols)
+            : rows(rows), cols(cols), words((cols + 63) / 64),
+              bits(rows * words, 0) {
+        }
+
+        int getRows() const {
+            return rows;
+        }
+
+        int getCols() const {
+            return cols;
+        }
+
+        bool get(int i, int j) const {
+            return (row(i)[j / 64] >> (j % 64)) & 1;
+        }
+
+        void set(int i, int j, bool value) {
+            uint64_t mask = UINT64_C(1) << (j % 64);
+            if (value) {
+                row(i)[j / 64] |= mask;
+            } else {
+                row(i)[j / 64] &= ~mask;
+            }
+        }
+
+        /**
+         * solve Mx = b, M is columns 0 to cols - 2 and b is the last
+         * column of this matrix. This matrix is changed into reduced
+         * row echelon form. Free variables are 0.
+         * @param[out] x solution of cols - 1 bits
+         * @return false if the equation has no solution
+         */
+        bool solve(std::vector<bool>& x) {
+            int n = cols - 1;
+            std::vector<int> pivot = eliminate(n);
+            x.assign(n, false);
+            for (int i = static_cast<int>(pivot.size()); i < rows; i++) {
+                if (get(i, n)) {
+                    return false;
+                }
+            }
+            for (size_t i = 0; i < pivot.size(); i++) {
+                x[pivot[i]] = get(i, n);
+            }
+            return true;
+        }
+    private:
+        enum { strip = 8 };
+        int rows;
+        int cols;
+        int words;
+        std::vector<uint64_t> bits;
+
+        uint64_t * row(int i) {
+            return &bits[i * words];
+        }
+
+        const uint64_t * row(int i) const {
+            return &bits[i * words];
+        }
+
+        void add_row(uint64_t * dst, const uint64_t * src) {
+            for (int w = 0; w < words; w++) {
+                dst[w] ^= src[w];
+            }
+        }
+
+        void swap_rows(int a, int b) {
+            if (a == b) {
+                return;
+            }
+            uint64_t * p = row(a);
+            uint64_t * q = row(b);
+            for (int w = 0; w < words; w++) {
+                uint64_t t = p[w];
+                p[w] = q[w];
+                q[w] = t;
+            }
+        }
+
+        /**
+         * Gauss-Jordan elimination of columns 0 to \b n - 1 by strips.
+         * @param n number of columns eliminated
+         * @return pivot column of row i, for rows which have a pivot
+         */
+        std::vector<int> eliminate(int n) {
+            std::vector<int> pivot;
+            std::vector<uint64_t> table(words << strip);
+            int r = 0;
+            for (int c0 = 0; c0 < n && r < rows; c0 += strip) {
+                int c1 = c0 + strip < n ? c0 + strip : n;
+                int first = r;
+                std::vector<int> pcol;
+                for (int c = c0; c < c1 && r < rows; c++) {
+                    int found = -1;
+                    for (int i = r; i < rows; i++) {
+                        // reduce the candidate by pivots of this strip
+                        for (size_t j = 0; j < pcol.size(); j++) {
+                            if (get(i, pcol[j])) {
+                                add_row(row(i), row(first + j));
+                            }
+                        }
+                        if (get(i, c)) {
+                            found = i;
+                            break;
+                        }
+                    }
+                    if (found < 0) {
+                        continue;
+                    }
+                    swap_rows(r, found);
+                    pcol.push_back(c);
+                    pivot.push_back(c);
+                    r++;
+                }
+                int k = static_cast<int>(pcol.size());
+                if (k == 0) {
+                    continue;
+                }
+                // pivot rows are made zero at the other pivot columns
+                for (int l = k - 1; l > 0; l--) {
+                    for (int j = 0; j < l; j++) {
+                        if (get(first + j, pcol[l])) {
+                            add_row(row(first + j), row(first + l));
+                        }
+                    }
+                }
+                // table[m] = sum of pivot rows j for bits j of m
+                for (int w = 0; w < words; w++) {
+                    table[w] = 0;
+                }
+                for (int m = 1; m < (1 << k); m++) {
+                    int j = __builtin_ctz(m);
+                    uint64_t * dst = &table[m * words];
+                    const uint64_t * low = &table[(m & (m - 1)) * words];
+                    const uint64_t * src = row(first + j);
+                    for (int w = 0; w < words; w++) {
+                        dst[w] = low[w] ^ src[w];
+                    }
+                }
+                for (int i = 0; i < rows; i++) {
+                    if (i >= first && i < first + k) {
+                        continue;
+                    }
+                    int m = 0;
+                    for (int j = 0; j < k; j++) {
+                        m |= static_cast<int>(get(i, pcol[j])) << j;
+                    }
+                    if (m != 0) {
+                        add_row(row(i), &table[m * words]);
+                    }
+                }
+            }
+            return pivot;
+        }
+    };
+}
+#endif // GF2MATRIX_HPP
@@ -0,0 +1,274 @@
+#pragma once
+#ifndef JUMP_HPP
+#define JUMP_HPP
+/**
+ * @file Jump.hpp
+ *
+ * @brief jump ahead of search generators
+ *
+ * The state after N steps is f(A)s, where A is the state transition,
+ * s the state and f(x) = x^N mod φ(x), φ the characteristic polynomial
+ * of A, or any polynomial with φ(A) = 0. f(A)s is calculated by
+ * eval_poly_window() using next_state() and add() of the generator.
+ */
+#include "devavxprng.h"
+#include <NTL/GF2X.h>
+#include <stdexcept>
+#include <vector>
+#include <MTToolBox/MersenneTwister64.hpp>
+#include "Annihilate.hpp"
+#include "PolynomialEvaluation.hpp"
+#include "JumpCache.hpp"
+
+namespace MTToolBox {
+    /**
+     * jump polynomial x^steps mod characteristic polynomial.
+     * @param jump_poly result
+     * @param steps number of steps
+     * @param modulus characteristic polynomial
+     */
+    inline void calc_jump_poly(NTL::GF2X& jump_poly, uint64_t steps,
+                               const NTL::GF2XModulus& modulus)
+    {
+        using namespace NTL;
+        GF2X r;
+        set(r);
+        rem(r, r, modulus);
+        for (int i = 63; i >= 0; i--) {
+            if (!IsOne(r)) {
+                SqrMod(r, r, modulus);
+            }
+            if ((steps >> i) & 1) {
+                MulByXMod(r, r, modulus);
+            }
+        }
+        jump_poly = r;
+    }
+
+    /**
+     * jump polynomial x^(2^k) mod characteristic polynomial.
+     * @param jump_poly result
+     * @param k exponent of 2
+     * @param modulus characteristic polynomial
+     */
+    inline void calc_jump_poly_pow2(NTL::GF2X& jump_poly, int k,
+                                    const NTL::GF2XModulus& modulus)
+    {
+        using namespace NTL;
+        GF2X r;
+        SetX(r);
+        rem(r, r, modulus);
+        for (int i = 0; i < k; i++) {
+            SqrMod(r, r, modulus);
+        }
+        jump_poly = r;
+    }
+
+    /**
+     * @class GeneratorJump
+     * @brief jump ahead of generators which have the same parameters
+     *
+     * The characteristic polynomial is calculated once per parameter
+     * set, then any generator with that parameter set can jump.
+     *
+     * @tparam G generator
+     * @tparam U w256_t or w512_t
+     */
+    template<typename G, typename U>
+    class GeneratorJump {
+    public:
+        /**
+         * calculate characteristic polynomial of \b gen as LCM of
+         * minimal polynomials of unit vectors.
+         * @param gen generator
+         * @throws std::logic_error * if the LCM can't be used for jump
+         */
+        explicit GeneratorJump(const G& gen) : cache(NULL) {
+            calcCharacteristic(gen);
+        }
+
+        /**
+         * \b poly is not checked.
+         * @param poly characteristic polynomial of the generator, or
+         * any polynomial φ with φ(A) = 0 for the state transition A
+         */
+        explicit GeneratorJump(const NTL::GF2X& poly) : cache(NULL) {
+            setCharacteristic(poly);
+        }
+
+        /**
+         * take characteristic polynomial and x<sup>2<sup>k</sup></sup>
+         * from \b cache, keyed by parameter string of \b gen. When
+         * the cache does not have them, they are calculated.
+         * @param gen generator
+         * @param cache jump polynomial file, which must live longer
+         * than this object
+         */
+        GeneratorJump(const G& gen, const JumpCache& cache)
+            : cache(&cache) {
+            using namespace NTL;
+            G tmp(gen);
+            key = tmp.getParamString();
+            GF2X poly;
+            if (cache.find(poly, key, -1)) {
+                setCharacteristic(poly);
+                checkCharacteristic(gen);
+            } else {
+                calcCharacteristic(gen);
+            }
+        }
+
+        const NTL::GF2X& getCharacteristic() const {
+            return characteristic;
+        }
+
+        /**
+         * make \b gen same as \b steps calls of next_state().
+         * @param gen generator
+         * @param steps number of steps
+         */
+        void jump(G& gen, uint64_t steps) const {
+            if (cache != NULL && steps != 0 && (steps & (steps - 1)) == 0) {
+                jump_pow2(gen, __builtin_ctzll(steps));
+                return;
+            }
+            NTL::GF2X jump_poly;
+            calc_jump_poly(jump_poly, steps, modulus);
+            jump_by_poly(gen, jump_poly);
+        }
+
+        /**
+         * make \b gen same as 2<sup>k</sup> calls of next_state().
+         * @param gen generator
+         * @param k exponent of 2
+         */
+        void jump_pow2(G& gen, int k) const {
+            NTL::GF2X jump_poly;
+            if (cache == NULL || !cache->find(jump_poly, key, k)) {
+                calc_jump_poly_pow2(jump_poly, k, modulus);
+            }
+            jump_by_poly(gen, jump_poly);
+        }
+
+        /**
+         * state of \b gen becomes f(A)s, f = \b jump_poly.
+         * The previous output, which is used in weight mode, is not
+         * reproduced.
+         * @param gen generator
+         * @param jump_poly polynomial of degree less than bitSize()
+         */
+        void jump_by_poly(G& gen, const NTL::GF2X& jump_poly) const {
+            eval_poly_window(gen, jump_poly, window, false);
+        }
+    private:
+        enum {window = 4, check_states = 64};
+        NTL::GF2X characteristic;
+        NTL::GF2XModulus modulus;
+        const JumpCache * cache;
+        std::string key;
+
+        /*
+         * LCM of minimal polynomials of lung sequences from unit
+         * vectors divides the minimal polynomial of the state
+         * transition, and it can be a proper divisor.
+         */
+        void calcCharacteristic(const G& gen) {
+            using namespace NTL;
+            Annihilate<G, U> annihilate;
+            GF2X poly;
+            annihilate.getLCMPoly(poly, gen);
+            setCharacteristic(poly);
+            checkCharacteristic(gen);
+        }
+
+        /*
+         * A polynomial of degree bitSize() which divides the minimal
+         * polynomial is the characteristic polynomial. A polynomial of
+         * lower degree must annihilate check_states random states: if
+         * φ(A) is not zero, a random state is in its kernel with
+         * probability at most 1/2.
+         */
+        void checkCharacteristic(const G& gen) const {
+            using namespace NTL;
+            if (deg(characteristic) == gen.bitSize()) {
+                return;
+            }
+            MersenneTwister64 mt(deg(characteristic));
+            for (int i = 0; i < check_states; i++) {
+                G work(gen);
+                randomState(work, mt);
+                jump_by_poly(work, characteristic);
+                if (!work.isZero()) {
+                    throw new std::logic_error(
+                        "can't get characteristic polynomial");
+                }
+            }
+        }
+
+        /*
+         * state of \b gen becomes a sum of random unit vectors.
+         */
+        static void randomState(G& gen, MersenneTwister64& mt) {
+            G unit(gen);
+            gen.setZero();
+            uint64_t r = 0;
+            for (int i = 0; i < gen.bitSize(); i++) {
+                if (i % 64 == 0) {
+                    r = mt.generate();
+                }
+                if ((r >> (i % 64)) & 1) {
+                    unit.setOneBit(i);
+                    gen.add(&unit);
+                }
+            }
+        }
+
+        void setCharacteristic(const NTL::GF2X& poly) {
+            characteristic = poly;
+            build(modulus, poly);
+        }
+
+        GeneratorJump& operator=(const GeneratorJump&) {
+            throw std::logic_error("can't assign");
+        }
+    };
+
+    /**
+     * Compare jump() with calls of next_state() for steps from 0 to
+     * \b max_steps, and jump_pow2() for 2<sup>k</sup> up to
+     * \b max_steps.
+     * @param jumper jump object for parameters of \b gen
+     * @param gen generator
+     * @param max_steps maximum number of steps
+     * @return true if all states are same
+     */
+    template<typename G, typename U>
+    bool check_jump(const GeneratorJump<G, U>& jumper, const G& gen,
+                    int max_steps)
+    {
+        G brute(gen);
+        for (int n = 0; n <= max_steps; n++) {
+            G jumped(gen);
+            jumper.jump(jumped, n);
+            jumped.add(&brute);
+            if (!jumped.isZero()) {
+                return false;
+            }
+            if (n > 0 && (n & (n - 1)) == 0) {
+                int k = 0;
+                while ((1 << k) < n) {
+                    k++;
+                }
+                G jumped2(gen);
+                jumper.jump_pow2(jumped2, k);
+                jumped2.add(&brute);
+                if (!jumped2.isZero()) {
+                    return false;
+                }
+            }
+            brute.next_state();
+        }
+        return true;
+    }
+}
+#endif // JUMP_HPP
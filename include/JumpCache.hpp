@@ -0,0 +1,326 @@
+#pragma once
+#ifndef JUMPCACHE_HPP
+#define JUMPCACHE_HPP
+/**
+ * @file JumpCache.hpp
+ *
+ * @brief file of precomputed jump polynomials
+ *
+ * File format, integers are in the byte order of the machine:
+ * - header: magic "DAVXJMP", version, number of entries
+ * - entries sorted by jump_cache_compare()
+ * - data: keys and coefficients of polynomials, 8 byte aligned
+ *
+ * The key is the parameter string given by get_string(). An entry
+ * with k = -1 is the characteristic polynomial, an entry with k >= 0
+ * is x<sup>2<sup>k</sup></sup> mod the characteristic polynomial.
+ * Coefficients are stored by BytesFromGF2X of NTL.
+ *
+ * The file is mapped read only, so many short lived processes can
+ * share it without reading.
+ */
+#include "devavxprng.h"
+#include <NTL/GF2X.h>
+#include <stdexcept>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <stdio.h>
+#if HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#else
+#pragma GCC error "do not have sys/mman.h"
+#endif
+#if HAVE_FCNTL_H
+#include <fcntl.h>
+#else
+#pragma GCC error "do not have fcntl.h"
+#endif
+#include <sys/stat.h>
+
+namespace MTToolBox {
+    struct jump_cache_header {
+        char magic[8];
+        uint32_t version;
+        uint32_t count;
+    };
+
+    struct jump_cache_entry {
+        uint64_t key_offset;
+        uint64_t poly_offset;
+        uint32_t key_length;
+        int32_t k;
+        uint32_t poly_bytes;
+        uint32_t reserved;
+    };
+
+    static const char jump_cache_magic[8] = {'D', 'A', 'V', 'X',
+                                             'J', 'M', 'P', 0};
+    enum {jump_cache_version = 1};
+
+    /**
+     * order of entries. Keys are compared by memcmp(), a key comes
+     * before longer keys which start with it, and entries of the same
+     * key are ordered by k. JumpCacheWriter sorts entries and
+     * JumpCache searches them by this function, so that they can't
+     * disagree.
+     * @return negative, zero or positive as strcmp()
+     */
+    inline int jump_cache_compare(const void * a_key, size_t a_length,
+                                  int a_k, const void * b_key,
+                                  size_t b_length, int b_k)
+    {
+        size_t n = a_length < b_length ? a_length : b_length;
+        int c = memcmp(a_key, b_key, n);
+        if (c != 0) {
+            return c;
+        }
+        if (a_length != b_length) {
+            return a_length < b_length ? -1 : 1;
+        }
+        if (a_k != b_k) {
+            return a_k < b_k ? -1 : 1;
+        }
+        return 0;
+    }
+
+    /**
+     * @class JumpCache
+     * @brief read only view of jump polynomial file
+     */
+    class JumpCache {
+    public:
+        /**
+         * map \b path. Broken files are rejected.
+         * @param path file name
+         */
+        explicit JumpCache(const std::string& path) {
+            fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw new std::runtime_error("can't open " + path);
+            }
+            struct stat st;
+            if (fstat(fd, &st) != 0
+                || static_cast<size_t>(st.st_size)
+                < sizeof(jump_cache_header)) {
+                close(fd);
+                throw new std::runtime_error("broken jump cache " + path);
+            }
+            length = st.st_size;
+            void * p = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) {
+                close(fd);
+                throw new std::runtime_error("can't map " + path);
+            }
+            base = static_cast<const unsigned char *>(p);
+            header = reinterpret_cast<const jump_cache_header *>(base);
+            entries = reinterpret_cast<const jump_cache_entry *>(
+                base + sizeof(jump_cache_header));
+            if (!valid()) {
+                munmap(const_cast<unsigned char *>(base), length);
+                close(fd);
+                throw new std::runtime_error("broken jump cache " + path);
+            }
+        }
+
+        ~JumpCache() {
+            munmap(const_cast<unsigned char *>(base), length);
+            close(fd);
+        }
+
+        /**
+         * @return number of polynomials in the file
+         */
+        int size() const {
+            return header->count;
+        }
+
+        /**
+         * @param poly polynomial found
+         * @param key parameter string
+         * @param k -1 for characteristic polynomial, or exponent of 2
+         * @return true if found
+         */
+        bool find(NTL::GF2X& poly, const std::string& key, int k) const {
+            const jump_cache_entry * e = lookup(key, k);
+            if (e == NULL) {
+                return false;
+            }
+            NTL::GF2XFromBytes(poly, base + e->poly_offset, e->poly_bytes);
+            return true;
+        }
+
+        /**
+         * @param key parameter string
+         * @return largest k such that x<sup>2<sup>j</sup></sup> for
+         * \b key are stored for all j from 0 to k, or -1
+         */
+        int max_k(const std::string& key) const {
+            int k = -1;
+            while (k < INT_MAX && lookup(key, k + 1) != NULL) {
+                k++;
+            }
+            return k;
+        }
+    private:
+        int fd;
+        size_t length;
+        const unsigned char * base;
+        const jump_cache_header * header;
+        const jump_cache_entry * entries;
+
+        /*
+         * binary search of entry
+         */
+        const jump_cache_entry * lookup(const std::string& key,
+                                        int k) const {
+            uint32_t lo = 0;
+            uint32_t hi = header->count;
+            while (lo < hi) {
+                uint32_t mid = lo + (hi - lo) / 2;
+                int c = compare(entries[mid], key, k);
+                if (c == 0) {
+                    return &entries[mid];
+                } else if (c < 0) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            return NULL;
+        }
+
+        int compare(const jump_cache_entry& e, const std::string& key,
+                    int k) const {
+            return jump_cache_compare(base + e.key_offset, e.key_length,
+                                      e.k, key.data(), key.size(), k);
+        }
+
+        bool valid() const {
+            if (memcmp(header->magic, jump_cache_magic, 8) != 0
+                || header->version != jump_cache_version) {
+                return false;
+            }
+            uint64_t table_end = sizeof(jump_cache_header)
+                + static_cast<uint64_t>(header->count)
+                * sizeof(jump_cache_entry);
+            if (table_end > length) {
+                return false;
+            }
+            for (uint32_t i = 0; i < header->count; i++) {
+                const jump_cache_entry& e = entries[i];
+                if (e.key_offset < table_end
+                    || e.key_offset + e.key_length > length
+                    || e.poly_offset < table_end
+                    || e.poly_offset + e.poly_bytes > length) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        JumpCache(const JumpCache&);
+        JumpCache& operator=(const JumpCache&);
+    };
+
+    /**
+     * @class JumpCacheWriter
+     * @brief builder of jump polynomial file
+     */
+    class JumpCacheWriter {
+    public:
+        /**
+         * @param key parameter string
+         * @param k -1 for characteristic polynomial, or exponent of 2
+         * @param poly polynomial
+         */
+        void add(const std::string& key, int k, const NTL::GF2X& poly) {
+            item it;
+            it.key = key;
+            it.k = k;
+            it.bytes.resize(NTL::NumBytes(poly));
+            if (!it.bytes.empty()) {
+                NTL::BytesFromGF2X(&it.bytes[0], poly, it.bytes.size());
+            }
+            items.push_back(it);
+        }
+
+        /**
+         * write all polynomials to \b path. The file is written to a
+         * temporary file and renamed, readers never see a partial file.
+         * @param path file name
+         */
+        void write(const std::string& path) {
+            using namespace std;
+            sort(items.begin(), items.end());
+            for (size_t i = 1; i < items.size(); i++) {
+                if (!(items[i - 1] < items[i])) {
+                    throw new std::logic_error("duplicated jump polynomial");
+                }
+            }
+            jump_cache_header header;
+            memcpy(header.magic, jump_cache_magic, 8);
+            header.version = jump_cache_version;
+            header.count = items.size();
+            vector<jump_cache_entry> entries(items.size());
+            uint64_t offset = sizeof(header)
+                + items.size() * sizeof(jump_cache_entry);
+            for (size_t i = 0; i < items.size(); i++) {
+                jump_cache_entry& e = entries[i];
+                e.key_offset = offset;
+                e.key_length = items[i].key.size();
+                offset = align8(offset + e.key_length);
+                e.poly_offset = offset;
+                e.poly_bytes = items[i].bytes.size();
+                offset = align8(offset + e.poly_bytes);
+                e.k = items[i].k;
+                e.reserved = 0;
+            }
+            string tmp = path + ".tmp";
+            ofstream ofs(tmp.c_str(), ios::out | ios::binary | ios::trunc);
+            ofs.write(reinterpret_cast<const char *>(&header),
+                      sizeof(header));
+            if (!entries.empty()) {
+                ofs.write(reinterpret_cast<const char *>(&entries[0]),
+                          entries.size() * sizeof(jump_cache_entry));
+            }
+            for (size_t i = 0; i < items.size(); i++) {
+                ofs.write(items[i].key.data(), items[i].key.size());
+                pad(ofs, items[i].key.size());
+                if (!items[i].bytes.empty()) {
+                    ofs.write(reinterpret_cast<const char *>(
+                                  &items[i].bytes[0]),
+                              items[i].bytes.size());
+                }
+                pad(ofs, items[i].bytes.size());
+            }
+            ofs.close();
+            if (!ofs || rename(tmp.c_str(), path.c_str()) != 0) {
+                throw new std::runtime_error("can't write " + path);
+            }
+        }
+    private:
+        struct item {
+            std::string key;
+            int k;
+            std::vector<unsigned char> bytes;
+
+            bool operator<(const item& that) const {
+                return jump_cache_compare(key.data(), key.size(), k,
+                                          that.key.data(), that.key.size(),
+                                          that.k) < 0;
+            }
+        };
+        std::vector<item> items;
+
+        static uint64_t align8(uint64_t x) {
+            return (x + 7) & ~UINT64_C(7);
+        }
+
+        static void pad(std::ofstream& ofs, size_t n) {
+            static const char zero[8] = {0};
+            ofs.write(zero, align8(n) - n);
+        }
+    };
+}
+#endif // JUMPCACHE_HPP
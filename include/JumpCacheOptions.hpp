@@ -0,0 +1,122 @@
+#pragma once
+#ifndef JUMPCACHEOPTIONS_HPP
+#define JUMPCACHEOPTIONS_HPP
+/**
+ * @file JumpCacheOptions.hpp
+ */
+#include "devavxprng.h"
+#include <string>
+
+namespace MTToolBox {
+    /**
+     * options of jump polynomial file builder
+     */
+    class JumpCacheOptions {
+    public:
+        bool verbose;
+        int max_k;
+        std::string type;
+        std::string path;
+
+        JumpCacheOptions() {
+            verbose = false;
+            max_k = 64;
+        }
+
+        /**
+         * command line option parser
+         * @param argc number of command line arguments
+         * @param argv command line arguments
+         * @return command line options have error, or not
+         */
+        bool parse(int argc, char **argv) {
+            using namespace std;
+            int c;
+            bool error = false;
+            string pgm = argv[0];
+            static struct option longopts[] = {
+                {"verbose", no_argument, NULL, 'v'},
+                {"type", required_argument, NULL, 't'},
+                {"max-k", required_argument, NULL, 'k'},
+                {NULL, 0, NULL, 0}};
+            errno = 0;
+            for (;;) {
+                c = getopt_long(argc, argv, "vt:k:", longopts, NULL);
+                if (error) {
+                    break;
+                }
+                if (c == -1) {
+                    break;
+                }
+                switch (c) {
+                case 'v':
+                    verbose = true;
+                    break;
+                case 't':
+                    type = optarg;
+                    if (type != "SFMTAVX2" && type != "SFMTAVX512F"
+                        && type != "dSFMTAVX2" && type != "dSFMTAVX512F") {
+                        error = true;
+                        cerr << "type must be one of SFMTAVX2, SFMTAVX512F, "
+                             << "dSFMTAVX2 and dSFMTAVX512F" << endl;
+                    }
+                    break;
+                case 'k':
+                    max_k = strtol(optarg, NULL, 10);
+                    if (errno || max_k < 0) {
+                        error = true;
+                        cerr << "max-k must be a non negative number"
+                             << endl;
+                    }
+                    break;
+                case '?':
+                default:
+                    error = true;
+                    break;
+                }
+            }
+            argc -= optind;
+            argv += optind;
+            if (type.empty()) {
+                error = true;
+            }
+            if (argc < 1) {
+                error = true;
+            } else {
+                path = argv[0];
+            }
+            if (error) {
+                output_help(pgm);
+                return false;
+            }
+            return true;
+        }
+    private:
+        /**
+         * showing help message
+         * @param pgm program name
+         */
+        void output_help(std::string& pgm) {
+            using namespace std;
+            cerr << "usage:" << endl;
+            cerr << pgm
+                 << " [-v] [-k max-k] -t type file < parameters"
+                 << endl;
+            cerr << "\n"
+                 << "--verbose, -v         Verbose mode. Output parameters "
+                 << "and calculation time.\n"
+                 << "--type, -t type       SFMTAVX2, SFMTAVX512F, dSFMTAVX2 "
+                 << "or dSFMTAVX512F.\n"
+                 << "--max-k, -k max-k     x^(2^k) are stored for k = 0 to "
+                 << "max-k. default 64.\n"
+                 << "file                  jump polynomial file to be "
+                 << "written.\n"
+                 << "parameters            lines of parameters output by "
+                 << "dc tools, from\n"
+                 << "                      standard input. Lines starting "
+                 << "with '#' are ignored.\n";
+            cerr << endl;
+        }
+    };
+}
+#endif // JUMPCACHEOPTIONS_HPP
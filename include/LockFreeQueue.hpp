@@ -0,0 +1,113 @@
+#pragma once
+#ifndef LOCKFREEQUEUE_HPP
+#define LOCKFREEQUEUE_HPP
+/**
+ * @file LockFreeQueue.hpp
+ *
+ * @brief bounded queue for many producers and consumers without locks
+ *
+ * Each cell has a sequence number which tells whether the cell is
+ * ready for push or for pop, and producers and consumers take cells
+ * by compare and swap of the enqueue and dequeue positions (Vyukov's
+ * bounded MPMC queue).
+ */
+#include "devavxprng.h"
+#include <atomic>
+#include <vector>
+#include <stdexcept>
+
+namespace MTToolBox {
+    /**
+     * @class LockFreeQueue
+     * @tparam T element, which must be copy assignable
+     */
+    template<typename T>
+    class LockFreeQueue {
+    public:
+        /**
+         * @param capacity number of elements, power of 2
+         */
+        explicit LockFreeQueue(size_t capacity)
+            : cells(capacity), mask(capacity - 1) {
+            if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+                throw new std::logic_error(
+                    "capacity must be a power of 2");
+            }
+            for (size_t i = 0; i < capacity; i++) {
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+            enqueue_pos.store(0, std::memory_order_relaxed);
+            dequeue_pos.store(0, std::memory_order_relaxed);
+        }
+
+        /**
+         * @param x element to be pushed
+         * @return false if the queue is full
+         */
+        bool push(const T& x) {
+            size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+            for (;;) {
+                cell& c = cells[pos & mask];
+                size_t seq = c.sequence.load(std::memory_order_acquire);
+                intptr_t dif = static_cast<intptr_t>(seq)
+                    - static_cast<intptr_t>(pos);
+                if (dif == 0) {
+                    if (enqueue_pos.compare_exchange_weak(
+                            pos, pos + 1, std::memory_order_relaxed)) {
+                        c.data = x;
+                        c.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (dif < 0) {
+                    return false;
+                } else {
+                    pos = enqueue_pos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /**
+         * @param x element popped
+         * @return false if the queue is empty
+         */
+        bool pop(T& x) {
+            size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+            for (;;) {
+                cell& c = cells[pos & mask];
+                size_t seq = c.sequence.load(std::memory_order_acquire);
+                intptr_t dif = static_cast<intptr_t>(seq)
+                    - static_cast<intptr_t>(pos + 1);
+                if (dif == 0) {
+                    if (dequeue_pos.compare_exchange_weak(
+                            pos, pos + 1, std::memory_order_relaxed)) {
+                        x = c.data;
+                        c.sequence.store(pos + mask + 1,
+                                         std::memory_order_release);
+                        return true;
+                    }
+                } else if (dif < 0) {
+                    return false;
+                } else {
+                    pos = dequeue_pos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+    private:
+        struct cell {
+            std::atomic<size_t> sequence;
+            T data;
+        };
+        std::vector<cell> cells;
+        const size_t mask;
+        // producers and consumers on different cache lines
+        char pad0[64];
+        std::atomic<size_t> enqueue_pos;
+        char pad1[64];
+        std::atomic<size_t> dequeue_pos;
+        char pad2[64];
+
+        LockFreeQueue(const LockFreeQueue&);
+        LockFreeQueue& operator=(const LockFreeQueue&);
+    };
+}
+#endif // LOCKFREEQUEUE_HPP
@@ -0,0 +1,59 @@
+#pragma once
+#ifndef MEXPDISPATCH_HPP
+#define MEXPDISPATCH_HPP
+/**
+ * @file MexpDispatch.hpp
+ *
+ * @brief call code templated on mexp with mexp given at run time
+ */
+#include "devavxprng.h"
+
+namespace MTToolBox {
+    /**
+     * Mersenne exponents supported by dc tools, terminated by -1.
+     * Generators for them are instantiated with inline state.
+     */
+    static const int supported_mexp[] = {607, 1279, 2281, 3217,
+                                         4253, 4423,
+                                         9689, 9941, 11213, 19937,
+                                         21701, 23209, 44497, 86243, -1};
+
+    /**
+     * Call <tt>f.template run<MEXP>()</tt> with MEXP equal to \b mexp.
+     * Exponents less than MIN_MEXP and exponents not in supported_mexp
+     * call <tt>f.template run<0>()</tt>, that is, a generator with run
+     * time mexp.
+     *
+     * @tparam MIN_MEXP minimum mexp of the generator
+     * @tparam F class which has <tt>template<int MEXP> int run()</tt>
+     * @param mexp mersenne exponent
+     * @param f function object
+     * @return return value of run()
+     */
+    template<int MIN_MEXP, typename F>
+    int dispatch_mexp(int mexp, F& f)
+    {
+#define DEVAVX_MEXP_CASE(m) \
+        case m: return f.template run<(m >= MIN_MEXP) ? m : 0>()
+        switch (mexp) {
+            DEVAVX_MEXP_CASE(607);
+            DEVAVX_MEXP_CASE(1279);
+            DEVAVX_MEXP_CASE(2281);
+            DEVAVX_MEXP_CASE(3217);
+            DEVAVX_MEXP_CASE(4253);
+            DEVAVX_MEXP_CASE(4423);
+            DEVAVX_MEXP_CASE(9689);
+            DEVAVX_MEXP_CASE(9941);
+            DEVAVX_MEXP_CASE(11213);
+            DEVAVX_MEXP_CASE(19937);
+            DEVAVX_MEXP_CASE(21701);
+            DEVAVX_MEXP_CASE(23209);
+            DEVAVX_MEXP_CASE(44497);
+            DEVAVX_MEXP_CASE(86243);
+        default:
+            return f.template run<0>();
+        }
+#undef DEVAVX_MEXP_CASE
+    }
+}
+#endif // MEXPDISPATCH_HPP
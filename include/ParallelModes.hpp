@@ -0,0 +1,289 @@
+#pragma once
+#ifndef PARALLELMODES_HPP
+#define PARALLELMODES_HPP
+/**
+ * @file ParallelModes.hpp
+ *
+ * @brief evaluation of start mode and weight mode pairs by threads
+ *
+ * k(v) of a generator is the minimum over start modes of the maximum
+ * over weight modes, and each pair of modes is an independent
+ * reduction of a lattice. Pairs are taken by threads from an atomic
+ * counter in the order of start mode, and the maximum and the minimum
+ * are folded by compare and swap, without locks.
+ *
+ * As in calc_SIMD_equidist(), the maximum over weight modes is not
+ * reset for each start mode, so the value of a start mode is the
+ * maximum over all pairs of that and earlier start modes. A partial
+ * maximum is a lower bound of the value, and the remaining pairs of a
+ * start mode are skipped once the bound reaches the minimum of start
+ * modes already completed. The result is same as the serial loop.
+ *
+ * The value of start mode 0 is therefore the minimum, and start modes
+ * after 0 can't change the result. simd_mode_lists() and
+ * dsfmt_mode_lists() give start mode 0 only, so threads take weight
+ * modes of start mode 0 and no pair is wasted.
+ */
+#include "devavxprng.h"
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <climits>
+#include <stdexcept>
+
+namespace MTToolBox {
+    /**
+     * @param requested number of threads requested, 0 for all cores
+     * @param jobs number of jobs
+     * @return number of threads to be used
+     */
+    inline int mode_threads(int requested, int jobs)
+    {
+        int n = requested;
+        if (n < 1) {
+            n = static_cast<int>(std::thread::hardware_concurrency());
+        }
+        if (n > jobs) {
+            n = jobs;
+        }
+        return n < 1 ? 1 : n;
+    }
+
+    /**
+     * @param a atomic variable
+     * @param x value, a is set to max(a, x)
+     */
+    inline void atomic_fetch_max(std::atomic<int>& a, int x)
+    {
+        int old = a.load();
+        while (old < x && !a.compare_exchange_weak(old, x)) {
+        }
+    }
+
+    /**
+     * @param a atomic variable
+     * @param x value, a is set to min(a, x)
+     */
+    inline void atomic_fetch_min(std::atomic<int>& a, int x)
+    {
+        int old = a.load();
+        while (old > x && !a.compare_exchange_weak(old, x)) {
+        }
+    }
+
+    /**
+     * @class ModeMinMax
+     * @brief lock free min over start modes of max over weight modes
+     * of \b n values, k(v) of n different v
+     */
+    class ModeMinMax {
+    public:
+        /**
+         * @param start_no number of start modes
+         * @param weight_no number of weight modes
+         * @param n number of values of a pair
+         */
+        ModeMinMax(int start_no, int weight_no, int n)
+            : start_no(start_no), n(n),
+              maximum(start_no * n), left(start_no), cut(start_no),
+              minimum(n) {
+            for (int i = 0; i < start_no * n; i++) {
+                maximum[i] = -1;
+            }
+            for (int s = 0; s < start_no; s++) {
+                left[s] = weight_no;
+                cut[s] = false;
+            }
+            for (int i = 0; i < n; i++) {
+                minimum[i] = INT_MAX;
+            }
+        }
+
+        /**
+         * @param s index of start mode
+         * @return false if start mode \b s can not lower the minimum
+         */
+        bool can_lower(int s) const {
+            for (int i = 0; i < n; i++) {
+                int bound = -1;
+                for (int t = 0; t <= s; t++) {
+                    int m = maximum[t * n + i];
+                    if (m > bound) {
+                        bound = m;
+                    }
+                }
+                if (bound < minimum[i]) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * fold values of a pair of start mode \b s.
+         * @param s index of start mode
+         * @param e n values
+         */
+        void update(int s, const int e[]) {
+            for (int i = 0; i < n; i++) {
+                atomic_fetch_max(maximum[s * n + i], e[i]);
+            }
+        }
+
+        /**
+         * a pair of start mode \b s is done or skipped.
+         * @param s index of start mode
+         * @param skipped the pair was skipped
+         */
+        void done(int s, bool skipped) {
+            if (skipped) {
+                cut[s] = true;
+            }
+            left[s]--;
+            publish();
+        }
+
+        /**
+         * @param[out] veq minimum of n values
+         */
+        void result(int veq[]) const {
+            for (int i = 0; i < n; i++) {
+                veq[i] = minimum[i];
+            }
+        }
+
+        /**
+         * @param[out] m maximum over weight modes of start mode \b s
+         * in m[s * n + i]
+         */
+        void maximums(int m[]) const {
+            for (int i = 0; i < start_no * n; i++) {
+                m[i] = maximum[i];
+            }
+        }
+
+        /**
+         * min over start modes of maximums, folded as result(). Used
+         * when pairs of modes are evaluated by several processes and
+         * their maximums are gathered.
+         * @param m maximums, see maximums()
+         * @param start_no number of start modes
+         * @param n number of values of a pair
+         * @param[out] veq minimum of n values
+         */
+        static void fold(const int m[], int start_no, int n, int veq[]) {
+            for (int i = 0; i < n; i++) {
+                int bound = -1;
+                veq[i] = INT_MAX;
+                for (int t = 0; t < start_no; t++) {
+                    if (m[t * n + i] > bound) {
+                        bound = m[t * n + i];
+                    }
+                    if (bound < veq[i]) {
+                        veq[i] = bound;
+                    }
+                }
+            }
+        }
+    private:
+        /**
+         * fold maximums of completed start modes into the minimum.
+         * Maximums of completed start modes do not change any more, so
+         * threads may do this concurrently.
+         */
+        void publish() {
+            std::vector<int> m(n, -1);
+            for (int t = 0; t < start_no; t++) {
+                if (left[t] != 0 || cut[t]) {
+                    break;
+                }
+                for (int i = 0; i < n; i++) {
+                    int x = maximum[t * n + i];
+                    if (x > m[i]) {
+                        m[i] = x;
+                    }
+                    atomic_fetch_min(minimum[i], m[i]);
+                }
+            }
+        }
+
+        int start_no;
+        int n;
+        std::vector<std::atomic<int> > maximum;
+        std::vector<std::atomic<int> > left;
+        std::vector<std::atomic<bool> > cut;
+        std::vector<std::atomic<int> > minimum;
+    };
+
+    /**
+     * min over start modes of max over weight modes by threads.
+     * \b eval(sm, wm, e) sets n values of a pair of modes into e[],
+     * and may throw std::logic_error *, which is thrown again here
+     * after all threads end.
+     * @param eval function object
+     * @param start_modes start modes
+     * @param weight_modes weight modes
+     * @param n number of values
+     * @param threads number of threads, 0 for all cores
+     * @param[out] veq n values
+     */
+    template<typename F>
+    void parallel_mode_minmax(F& eval,
+                              const std::vector<int>& start_modes,
+                              const std::vector<int>& weight_modes,
+                              int n, int threads, int veq[])
+    {
+        using namespace std;
+        int start_no = static_cast<int>(start_modes.size());
+        int weight_no = static_cast<int>(weight_modes.size());
+        int jobs = start_no * weight_no;
+        ModeMinMax mm(start_no, weight_no, n);
+        atomic<int> next_job(0);
+        atomic<bool> stop(false);
+        atomic<logic_error *> error(NULL);
+        auto worker = [&]() {
+            vector<int> e(n);
+            for (;;) {
+                int j = next_job++;
+                if (j >= jobs) {
+                    break;
+                }
+                int s = j / weight_no;
+                int w = j % weight_no;
+                if (stop || !mm.can_lower(s)) {
+                    mm.done(s, true);
+                    continue;
+                }
+                try {
+                    eval(start_modes[s], weight_modes[w], &e[0]);
+                    mm.update(s, &e[0]);
+                    mm.done(s, false);
+                } catch (logic_error * x) {
+                    logic_error * expected = NULL;
+                    if (!error.compare_exchange_strong(expected, x)) {
+                        delete x;
+                    }
+                    stop = true;
+                    mm.done(s, true);
+                }
+            }
+        };
+        int th = mode_threads(threads, jobs);
+        if (th <= 1) {
+            worker();
+        } else {
+            vector<thread> pool;
+            for (int i = 0; i < th; i++) {
+                pool.push_back(thread(worker));
+            }
+            for (int i = 0; i < th; i++) {
+                pool[i].join();
+            }
+        }
+        if (error.load() != NULL) {
+            throw error.load();
+        }
+        mm.result(veq);
+    }
+}
+#endif // PARALLELMODES_HPP
@@ -0,0 +1,274 @@
+#pragma once
+#ifndef PARALLELSEARCH_HPP
+#define PARALLELSEARCH_HPP
+/**
+ * @file ParallelSearch.hpp
+ *
+ * @brief search of parameter sets by threads in one process
+ *
+ * Each worker thread owns its generator, its stream of randomness and
+ * its calculators of parity and annihilation, so workers share nothing
+ * but a queue of result lines. One writer pops lines from the queue
+ * and stops all workers when count lines are written. The writer
+ * sleeps while the queue is empty, and workers sleep while it is full.
+ *
+ * NTL keeps scratch space of GF2X arithmetic in thread local storage
+ * only when it is built with NTL_THREADS, otherwise it is not safe to
+ * use NTL from more than one thread, and ntl_thread_safe() returns
+ * false.
+ */
+#include "devavxprng.h"
+#include "LockFreeQueue.hpp"
+#include <NTL/GF2X.h>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <random>
+
+namespace MTToolBox {
+    /**
+     * @class ResultQueue
+     * @brief queue of result lines from workers to the writer
+     *
+     * Lines are pushed and popped through a LockFreeQueue without the
+     * mutex. Only a thread which finds the queue full or empty takes
+     * the mutex, counts itself as waiting, tries again and sleeps, and
+     * the other side takes the mutex to wake it only if some thread is
+     * waiting. Both sides put a seq_cst fence between their update and
+     * their check of the other, so either the second try succeeds or
+     * the other side sees the waiting count.
+     */
+    class ResultQueue {
+    public:
+        explicit ResultQueue(size_t capacity)
+            : queue(capacity), producers(0), push_waiting(0),
+              pop_waiting(0) {
+        }
+
+        ~ResultQueue() {
+            std::string * p;
+            while (queue.pop(p)) {
+                delete p;
+            }
+        }
+
+        /**
+         * push \b p, sleeping while the queue is full
+         * @return false if \b stop is set, \b p is deleted then
+         */
+        bool push(std::string * p, const std::atomic<bool>& stop) {
+            if (!queue.push(p)) {
+                std::unique_lock<std::mutex> lock(mutex);
+                push_waiting++;
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                while (!queue.push(p)) {
+                    if (stop) {
+                        push_waiting--;
+                        delete p;
+                        return false;
+                    }
+                    not_full.wait(lock);
+                }
+                push_waiting--;
+            }
+            notify(not_empty, pop_waiting);
+            return true;
+        }
+
+        /**
+         * pop a line, sleeping while the queue is empty and some
+         * producers are running.
+         * @return NULL if \b stop is set or all producers have ended
+         */
+        std::string * pop(const std::atomic<bool>& stop) {
+            std::string * p;
+            if (!queue.pop(p)) {
+                std::unique_lock<std::mutex> lock(mutex);
+                pop_waiting++;
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                while (!queue.pop(p)) {
+                    if (stop || producers == 0) {
+                        pop_waiting--;
+                        return NULL;
+                    }
+                    not_empty.wait(lock);
+                }
+                pop_waiting--;
+            }
+            notify(not_full, push_waiting);
+            return p;
+        }
+
+        void add_producers(int n) {
+            std::lock_guard<std::mutex> lock(mutex);
+            producers += n;
+        }
+
+        void producer_end() {
+            std::lock_guard<std::mutex> lock(mutex);
+            producers--;
+            if (producers == 0) {
+                not_empty.notify_all();
+            }
+        }
+
+        /**
+         * wake all threads waiting on this queue, called after \b stop
+         * is set.
+         */
+        void wake() {
+            std::lock_guard<std::mutex> lock(mutex);
+            not_full.notify_all();
+            not_empty.notify_all();
+        }
+    private:
+        LockFreeQueue<std::string *> queue;
+        std::mutex mutex;
+        std::condition_variable not_full;
+        std::condition_variable not_empty;
+        int producers;
+        std::atomic<int> push_waiting;
+        std::atomic<int> pop_waiting;
+
+        /*
+         * A waiting thread holds the mutex from its count to its
+         * wait, so the notification can't come in between.
+         */
+        void notify(std::condition_variable& cond,
+                    const std::atomic<int>& waiting) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (waiting > 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                cond.notify_one();
+            }
+        }
+
+        ResultQueue(const ResultQueue&);
+        ResultQueue& operator=(const ResultQueue&);
+    };
+
+    /**
+     * @return true if NTL can be used by many threads
+     */
+    inline bool ntl_thread_safe()
+    {
+#if defined(NTL_THREADS)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @param requested number of threads requested, 0 for default
+     * @param count number of jobs
+     * @return number of threads to be used, 1 if NTL is not thread safe
+     */
+    inline int search_threads(int requested, long count)
+    {
+        if (!ntl_thread_safe()) {
+            if (requested > 1) {
+                std::cerr << "NTL is built without NTL_THREADS, "
+                          << "search by one thread" << std::endl;
+            }
+            return 1;
+        }
+        long n = requested;
+        if (n < 1) {
+            n = std::thread::hardware_concurrency();
+        }
+        if (n > count) {
+            n = count;
+        }
+        return n < 1 ? 1 : static_cast<int>(n);
+    }
+
+    /**
+     * seed of the parameter generator of a worker, made from the tuple
+     * (seed, rank, worker) by std::seed_seq, which mixes an array like
+     * init_by_array of Mersenne Twister. Seeds of workers of different
+     * MPI processes don't overlap, as they could if they were made by
+     * adding to the seed.
+     * @param seed seed given by the user
+     * @param rank rank of MPI process, 0 if not MPI
+     * @param worker worker number
+     * @return seed of the worker, \b seed itself for rank 0 and worker
+     * 0, so that the first worker is same as the search by one thread
+     */
+    inline uint64_t worker_seed(uint64_t seed, int rank, int worker)
+    {
+        if (rank == 0 && worker == 0) {
+            return seed;
+        }
+        std::seed_seq seq{static_cast<uint32_t>(seed),
+                static_cast<uint32_t>(seed >> 32),
+                static_cast<uint32_t>(rank),
+                static_cast<uint32_t>(worker)};
+        uint32_t mixed[2];
+        seq.generate(mixed, mixed + 2);
+        return (static_cast<uint64_t>(mixed[1]) << 32) | mixed[0];
+    }
+
+    /**
+     * push a result line, sleeping while the queue is full.
+     * @param queue result queue
+     * @param line result line
+     * @param stop stop flag set by the writer
+     * @return false if the writer has stopped
+     */
+    inline bool push_result(ResultQueue& queue, const std::string& line,
+                            const std::atomic<bool>& stop)
+    {
+        return queue.push(new std::string(line), stop);
+    }
+
+    /**
+     * run \b threads workers and write \b count lines they found.
+     * Worker \b w is called as worker(w, queue, stop), it pushes
+     * lines by push_result() until \b stop is set, and returns false
+     * on failure. Lines are written in the order they are found.
+     * @param threads number of worker threads
+     * @param count number of lines to be written
+     * @param worker function object
+     * @param os output stream
+     * @return number of lines written, less than \b count if all
+     * workers failed
+     */
+    template<typename W>
+    long parallel_search(int threads, long count, W& worker,
+                         std::ostream& os)
+    {
+        using namespace std;
+        ResultQueue queue(256);
+        atomic<bool> stop(false);
+        queue.add_producers(threads);
+        vector<thread> pool;
+        for (int w = 0; w < threads; w++) {
+            pool.push_back(thread([w, &worker, &queue, &stop]() {
+                        worker(w, queue, stop);
+                        queue.producer_end();
+                    }));
+        }
+        long written = 0;
+        while (written < count) {
+            string * p = queue.pop(stop);
+            if (p == NULL) {
+                break;
+            }
+            os << *p << endl;
+            delete p;
+            written++;
+        }
+        stop = true;
+        queue.wake();
+        for (size_t i = 0; i < pool.size(); i++) {
+            pool[i].join();
+        }
+        return written;
+    }
+}
+#endif // PARALLELSEARCH_HPP
@@ -0,0 +1,39 @@
+#pragma once
+#ifndef PERIODCERTIFICATION_HPP
+#define PERIODCERTIFICATION_HPP
+/**
+ * @file PeriodCertification.hpp
+ *
+ * @brief period certification of generators used outside search
+ *
+ * Generators emitted by emitgen and RuntimeGenerator are initialized
+ * by seed() of the search class followed by this. Their dSFMT state
+ * has no prefix, so fix1 is not used.
+ */
+#include "SFMTAVX2search.hpp"
+#include "SFMTAVX512Fsearch.hpp"
+#include "dSFMTAVX2search.hpp"
+#include "dSFMTAVX512Fsearch.hpp"
+
+namespace MTToolBox {
+    /**
+     * @param gen generator
+     * @return 1 if the lung was not changed, 0 if a bit was flipped
+     */
+    inline int period_certification(SFMTAVX2& gen) {
+        return gen.periodCertification();
+    }
+
+    inline int period_certification(SFMTAVX512F& gen) {
+        return gen.periodCertification();
+    }
+
+    inline int period_certification(dSFMTAVX2& gen) {
+        return gen.periodCertification(true);
+    }
+
+    inline int period_certification(dSFMTAVX512F& gen) {
+        return gen.periodCertification(true);
+    }
+}
+#endif // PERIODCERTIFICATION_HPP
@@ -0,0 +1,120 @@
+#pragma once
+#ifndef POLYNOMIALCONTEXT_HPP
+#define POLYNOMIALCONTEXT_HPP
+/**
+ * @file PolynomialContext.hpp
+ *
+ * @brief polynomials of one candidate shared by the stages of search
+ *
+ * The irreducible factor found by AlgorithmReducibleRecursionSearch,
+ * the characteristic polynomial (LCM of minimal polynomials), and the
+ * quotient of them are used by calc_fixpoint(), the parity check and
+ * Annihilate. A context keeps them for one parameter set, so each of
+ * them is computed once, and counts the computations avoided by all
+ * contexts.
+ */
+#include "devavxprng.h"
+#include <NTL/GF2X.h>
+#include <ostream>
+#include <atomic>
+
+namespace MTToolBox {
+    /**
+     * @class PolynomialContext
+     * @brief cache of polynomials of a parameter set
+     */
+    class PolynomialContext {
+    public:
+        PolynomialContext() : has_irreducible(false),
+                              has_characteristic(false),
+                              has_quotient(false) {
+        }
+
+        /**
+         * @param irreducible irreducible factor of characteristic
+         * polynomial
+         */
+        explicit PolynomialContext(const NTL::GF2X& irreducible)
+            : irreducible(irreducible), has_irreducible(true),
+              has_characteristic(false), has_quotient(false) {
+        }
+
+        bool hasIrreducible() const {
+            return has_irreducible;
+        }
+
+        bool hasCharacteristic() const {
+            return has_characteristic;
+        }
+
+        void setIrreducible(const NTL::GF2X& poly) {
+            irreducible = poly;
+            has_irreducible = true;
+            has_quotient = false;
+        }
+
+        void setCharacteristic(const NTL::GF2X& poly) {
+            characteristic = poly;
+            has_characteristic = true;
+            has_quotient = false;
+        }
+
+        const NTL::GF2X& getIrreducible() const {
+            return irreducible;
+        }
+
+        const NTL::GF2X& getCharacteristic() const {
+            return characteristic;
+        }
+
+        /**
+         * quotient is computed by the first call.
+         * @return characteristic polynomial / irreducible factor
+         */
+        const NTL::GF2X& getQuotient() {
+            if (has_quotient) {
+                avoid();
+            } else {
+                quotient = characteristic / irreducible;
+                has_quotient = true;
+            }
+            return quotient;
+        }
+
+        /**
+         * count a computation avoided by a polynomial in a context
+         */
+        static void avoid() {
+            counter()++;
+        }
+
+        /**
+         * @return number of computations avoided by all contexts
+         */
+        static long avoided() {
+            return counter();
+        }
+
+        /**
+         * print number of computations avoided
+         * @param os output stream
+         */
+        static void print(std::ostream& os) {
+            os << "polynomials reused = " << std::dec << avoided()
+               << std::endl;
+        }
+    private:
+        static std::atomic<long>& counter() {
+            static std::atomic<long> count(0);
+            return count;
+        }
+
+        NTL::GF2X irreducible;
+        NTL::GF2X characteristic;
+        NTL::GF2X quotient;
+        bool has_irreducible;
+        bool has_characteristic;
+        bool has_quotient;
+    };
+}
+#endif // POLYNOMIALCONTEXT_HPP
@@ -0,0 +1,118 @@
+#pragma once
+#ifndef POLYNOMIALEVALUATION_HPP
+#define POLYNOMIALEVALUATION_HPP
+/**
+ * @file PolynomialEvaluation.hpp
+ *
+ * @brief f(A)s for a generator, A the state transition and s the state
+ *
+ * annihilate() of MTToolBox adds the state to the result for each non
+ * zero coefficient of f, so it takes about deg(f) / 2 additions of
+ * the whole state. Here f(A)s is calculated by Horner's method with
+ * sliding windows of w bits, whose first and last bits are 1. A
+ * window v is added from a table of sum of A^t s for bits t of odd
+ * v, so a window costs one addition, and the table costs 2^(w-1)
+ * additions. The window is chosen by the degree of f, so that the
+ * total number of additions is about deg(f) / (w + 1) + 2^(w-1).
+ */
+#include "devavxprng.h"
+#include <NTL/GF2X.h>
+#include <vector>
+
+namespace MTToolBox {
+    /**
+     * @param degree degree of polynomial
+     * @return window which makes the number of additions least
+     */
+    inline int horner_window(long degree)
+    {
+        int best = 1;
+        double best_cost = degree + 1;
+        for (int w = 2; w <= 10; w++) {
+            double cost = static_cast<double>(degree + 1) / (w + 1)
+                + (1 << (w - 1));
+            if (cost < best_cost) {
+                best = w;
+                best_cost = cost;
+            }
+        }
+        return best;
+    }
+
+    /**
+     * state of \b gen becomes f(A)s, f = \b poly.
+     * @param gen generator
+     * @param poly polynomial
+     * @param window bits of a window, 1 to 10
+     * @param output step by generate() if true, so the previous output
+     * is also f(A) of it, otherwise by next_state()
+     */
+    template<typename G>
+    void eval_poly_window(G& gen, const NTL::GF2X& poly, int window,
+                          bool output)
+    {
+        using namespace NTL;
+        // table[v] = sum of A^t s for bit t of odd v
+        std::vector<G *> table(1 << window, NULL);
+        G * power = new G(gen);
+        table[1] = new G(gen);
+        for (int t = 1; t < window; t++) {
+            if (output) {
+                power->generate();
+            } else {
+                power->next_state();
+            }
+            for (int v = (1 << t) + 1; v < (2 << t); v += 2) {
+                table[v] = new G(*table[v - (1 << t)]);
+                table[v]->add(power);
+            }
+        }
+        delete power;
+        G work(gen);
+        work.setZero();
+        long pos = deg(poly);
+        while (pos >= 0) {
+            long lo = pos;
+            if (!IsZero(coeff(poly, pos))) {
+                lo = pos - window + 1;
+                if (lo < 0) {
+                    lo = 0;
+                }
+                while (IsZero(coeff(poly, lo))) {
+                    lo++;
+                }
+            }
+            int v = 0;
+            for (long j = pos; j >= lo; j--) {
+                v = (v << 1) | static_cast<int>(rep(coeff(poly, j)));
+                if (output) {
+                    work.generate();
+                } else {
+                    work.next_state();
+                }
+            }
+            if (v != 0) {
+                work.add(table[v]);
+            }
+            pos = lo - 1;
+        }
+        for (size_t i = 0; i < table.size(); i++) {
+            delete table[i];
+        }
+        gen.setZero();
+        gen.add(&work);
+    }
+
+    /**
+     * same as annihilate() of MTToolBox, state of \b gen becomes
+     * f(A)s, but by Horner's method with sliding windows.
+     * @param gen generator
+     * @param poly polynomial f
+     */
+    template<typename G>
+    void window_annihilate(G * gen, const NTL::GF2X& poly)
+    {
+        eval_poly_window(*gen, poly, horner_window(NTL::deg(poly)), true);
+    }
+}
+#endif // POLYNOMIALEVALUATION_HPP
@@ -0,0 +1,166 @@
+#pragma once
+#ifndef RUNTIMEGENERATOR_HPP
+#define RUNTIMEGENERATOR_HPP
+/**
+ * @file RuntimeGenerator.hpp
+ *
+ * @brief generators of parameter sets selected at run time
+ *
+ * Interface of libdevavxprng. Many parameter sets found by dc tools
+ * are loaded into a table, and each stream creates its generator from
+ * one of them, like dcmt and MTGP. Outputs are generated by blocks;
+ * mask, permutation index and shift amounts are loaded into registers
+ * once per block, so the speed is close to generators compiled for one
+ * parameter set.
+ *
+ * This header is installed with the library, so it does not include
+ * config.h nor other headers of this package.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <istream>
+
+namespace MTToolBox {
+    /**
+     * @class runtime_param
+     * @brief parameters of one generator
+     */
+    struct runtime_param {
+        /** SFMTAVX2, SFMTAVX512F, dSFMTAVX2 or dSFMTAVX512F */
+        std::string type;
+        /** parameter string of get_string() */
+        std::string param_string;
+        /** bits of one output, 256 or 512 */
+        int bits;
+        bool dsfmt;
+        int mexp;
+        /** number of elements of state, not including lung */
+        int size;
+        int pos1;
+        int sl1;
+        int sr1;
+        int perm;
+        /** mat1 of SFMT, msk1 of dSFMT */
+        uint64_t mask[8];
+        uint64_t parity[8];
+    };
+
+    /**
+     * @param param parameters read
+     * @param type SFMTAVX2, SFMTAVX512F, dSFMTAVX2 or dSFMTAVX512F
+     * @param line a line of parameters output by dc tools
+     * @return false if \b type is unknown or \b line has no parameters
+     */
+    bool parse_runtime_param(runtime_param& param, const std::string& type,
+                             const std::string& line);
+
+    /**
+     * @class RuntimeParamTable
+     * @brief parameter sets of one type
+     */
+    class RuntimeParamTable {
+    public:
+        explicit RuntimeParamTable(const std::string& type) : type(type) {
+        }
+
+        /**
+         * read lines output by dc tools. Lines not starting with a
+         * digit are skipped.
+         * @param is input stream
+         * @return number of parameter sets read
+         */
+        int load(std::istream& is);
+
+        /**
+         * @param path file of lines output by dc tools
+         * @return number of parameter sets read
+         */
+        int load(const std::string& path);
+
+        size_t size() const {
+            return table.size();
+        }
+
+        const runtime_param& operator[](size_t i) const {
+            return table[i];
+        }
+    private:
+        std::string type;
+        std::vector<runtime_param> table;
+    };
+
+    /**
+     * @class RuntimeGenerator
+     * @brief generator of a parameter set given at run time
+     *
+     * The state is aligned to 64 bytes. Initialization is same as
+     * seed() of the search class followed by periodCertification().
+     */
+    class RuntimeGenerator {
+    public:
+        explicit RuntimeGenerator(const runtime_param& param);
+        RuntimeGenerator(const RuntimeGenerator& src);
+        ~RuntimeGenerator();
+
+        /**
+         * @param seed seed, given as the lowest word of seed array
+         */
+        void seed(uint64_t seed);
+
+        /**
+         * @param seed_array bits / 64 words, same as seed of the
+         * search class
+         */
+        void seed(const uint64_t * seed_array);
+
+        /**
+         * @return bytes of one output
+         */
+        int output_bytes() const {
+            return param.bits / 8;
+        }
+
+        /**
+         * @param out bits / 64 words of next output
+         */
+        void next(uint64_t * out);
+
+        /**
+         * \b n outputs, same as \b n calls of next().
+         * @param out array of n * output_bytes() bytes, need not be
+         * aligned
+         * @param n number of outputs
+         */
+        void fill(void * out, size_t n);
+
+        /**
+         * doubles in [1, 2), only for dSFMT. Each 64-bit lane of
+         * outputs gives one.
+         * @param out array of doubles
+         * @param n number of doubles, multiple of bits / 64
+         */
+        void fill_double(double * out, size_t n);
+
+        const runtime_param& getParam() const {
+            return param;
+        }
+
+        /**
+         * @return name of block kernel, generic, avx2 or avx512
+         */
+        const char * kernel_name() const;
+    private:
+        runtime_param param;
+        /** size + 1 elements, lung is the last */
+        uint64_t * state;
+        /** index of next output, size means empty */
+        int index;
+        int kernel;
+
+        void block(unsigned char * out, size_t n);
+        RuntimeGenerator& operator=(const RuntimeGenerator&);
+    };
+}
+#endif // RUNTIMEGENERATOR_HPP
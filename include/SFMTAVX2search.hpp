@@ -6,6 +6,9 @@
  */
 
 #include "devavxprng.h"
+#include "SIMDKernel.hpp"
+#include "StateArray.hpp"
+#include "BulkOutput.hpp"
 #include "w256.hpp"
 #include <sstream>
 #include <MTToolBox/ReducibleGenerator.hpp>
@@ -104,23 +107,33 @@ namespace MTToolBox {
         }
     };
 
-    class SFMTAVX2 : public ReducibleGenerator<w256_t> {
+    /**
+     * @class SFMTAVX2_T
+     * @brief SFMTAVX2 generator class used for dynamic creation
+     *
+     * @tparam SL1 sl1 fixed at compile time, 0 means run time
+     * @tparam SR1 sr1 fixed at compile time, 0 means run time
+     * @tparam PERM perm fixed at compile time, 0 means run time
+     * @tparam MEXP mersenne exponent fixed at compile time, the state
+     * is kept inline. 0 means run time and the state is on heap.
+     */
+    template<int SL1 = 0, int SR1 = 0, int PERM = 0, int MEXP = 0>
+    class SFMTAVX2_T : public ReducibleGenerator<w256_t> {
     public:
         /**
          * Constructor by mexp.
          * @param mexp Mersenne Exponent
          */
-        SFMTAVX2(int mexp) {
-            size = mexp / 256;
-            state = new w256_t[size];
+        SFMTAVX2_T(int mexp) : state(mexp / 256) {
             param.mexp = mexp;
             param.pos1 = 0;
             param.sl1 = 0;
             param.sr1 = 0;
             param.perm = 1;
-            fixedSL1 = 0;
-            fixedSR1 = 0;
-            fixedPerm = 0;
+            fixedSL1 = SL1;
+            fixedSR1 = SR1;
+            fixedPerm = PERM;
+            stream_id = -1;
             MTToolBox::setZero(param.mat1);
             MTToolBox::setZero(param.parity1);
             MTToolBox::setZero(lung);
@@ -131,16 +144,8 @@ namespace MTToolBox {
             MTToolBox::setZero(previous);
         }
 
-        ~SFMTAVX2() {
-            delete[] state;
-        }
-
-        SFMTAVX2(const SFMTAVX2& src) : param(src.param) {
-            size = src.size;
-            state = new w256_t[size];
-            for (int i = 0; i < size; i++) {
-                state[i] = src.state[i];
-            }
+        SFMTAVX2_T(const SFMTAVX2_T& src)
+            : state(src.state), param(src.param) {
             lung = src.lung;
             index = src.index;
             start_mode = src.start_mode;
@@ -148,52 +153,54 @@ namespace MTToolBox {
             fixedSL1 = src.fixedSL1;
             fixedSR1 = src.fixedSR1;
             fixedPerm = src.fixedPerm;
+            stream_id = src.stream_id;
             reverse_bit_flag = src.reverse_bit_flag;
             previous = src.previous;
         }
 
-        SFMTAVX2(const SFMTAVX2_param& src_param) : param(src_param) {
-            size = src_param.mexp / 256;
-            state = new w256_t[size];
-            for (int i = 0; i < size; i++) {
+        SFMTAVX2_T(const SFMTAVX2_param& src_param)
+            : state(src_param.mexp / 256), param(src_param) {
+            for (int i = 0; i < size(); i++) {
                 MTToolBox::setZero(state[i]);
             }
             MTToolBox::setZero(lung);
             index = 0;
             start_mode = 0;
-            fixedSL1 = 0;
-            fixedSR1 = 0;
-            fixedPerm = 0;
+            fixedSL1 = SL1;
+            fixedSR1 = SR1;
+            fixedPerm = PERM;
+            stream_id = -1;
             weight_mode = max_weight_mode;
             MTToolBox::setZero(previous);
             reverse_bit_flag = false;
+            check_fixed();
         }
 
         EquidistributionCalculatable<w256_t> * clone() const {
-            return new SFMTAVX2(*this);
+            return new SFMTAVX2_T(*this);
         }
 
         void seed(w256_t seed) {
             setZero();
             state[0] = seed;
-            uint32_t * pstate = new uint32_t[(size + 1) * 8];
+            uint32_t * pstate = new uint32_t[(size() + 1) * 8];
             for (int i = 0; i < 8; i++) {
                 pstate[i] = seed.u[i];
             }
-            for (int i = 8; i < (size + 1) * 8; i++) {
+            for (int i = 8; i < (size() + 1) * 8; i++) {
                 pstate[i] = 0;
             }
-            for (int i = 1; i < (size + 1) * 8; i++) {
+            for (int i = 1; i < (size() + 1) * 8; i++) {
                 pstate[i] ^= i + UINT32_C(1812433253)
                     * (pstate[i - 1] ^ (pstate[i - 1] >> 30));
             }
-            for (int i = 0; i < size; i++) {
+            for (int i = 0; i < size(); i++) {
                 for (int j = 0; j < 8; j++) {
                     state[i].u[j] = pstate[i * 8 + j];
                 }
             }
             for (int i = 0; i < 8; i++) {
-                lung.u[i] = pstate[size * 8 + i];
+                lung.u[i] = pstate[size() * 8 + i];
             }
             index = 0;
             delete[] pstate;
@@ -201,53 +208,93 @@ namespace MTToolBox {
         }
 
         void do_recursion(w256_t *r, w256_t *a, w256_t *b, w256_t *lung) {
-            *lung = permutexvar_epi32(*lung, param.perm);
-            *lung ^= *b;
-            *lung ^= SL64(*a, param.sl1);
-            w256_t t;
-            t = *lung;
-            t ^= SR64(*b & param.mat1, param.sr1);
-            t ^= *a;
-            *r = t;
+            if (SL1 > 0 && SR1 > 0 && PERM > 0) {
+                sfmt_recursion_fixed<SL1, SR1, PERM>(r, a, b, lung,
+                                                     param.mat1);
+            } else {
+                sfmt_recursion(r, a, b, lung, param.mat1, param.sl1,
+                               param.sr1, param.perm);
+            }
         }
 
         void next_state() {
-            index = (index + 1) % size;
+            index = next_index(index, size());
             do_recursion(&state[index],
                          &state[index],
-                         &state[(index + param.pos1) % size],
+                         &state[add_index(index, param.pos1, size())],
                          &lung);
         }
 
         w256_t generate() {
             next_state();
-            w256_t r;
-            index = index % size;
-            int p = (index + size - 1) % size;
-            if (start_mode == 0) {
-                r = state[index];
-            } else {
-                for (int i = 0; i < 8 - start_mode; i++) {
-                    r.u[i] = state[p].u[i + start_mode];
-                }
-                int j = 0;
-                for (int i = 8 - start_mode; i < 8; i++) {
-                    r.u[i] = state[index].u[j++];
+            return output(index);
+        }
+
+        /**
+         * Block generation. Outputs are same as \b n calls of
+         * generate(), but the state is updated in runs without
+         * wraparound, like gen_rand_all of SFMT.
+         * @param out array of \b n elements to store outputs
+         * @param n number of outputs
+         */
+        void generate_block(w256_t * out, int n) {
+            while (n > 0) {
+                int start = next_index(index, size());
+                int m = advance_run(n, NULL);
+                for (int i = 0; i < m; i++) {
+                    out[i] = output(start + i);
                 }
+                out += m;
+                n -= m;
             }
-            w256_t r2;
-            if (weight_mode == max_weight_mode) {
-                r2 = r;
-            } else {
-                for (int i = 0; i < weight_mode; i++) {
-                    r2.u[i] = r.u[i];
+        }
+
+        /**
+         * Block state transition for sequences of parity values.
+         * out[i] is getParityValue() after i + 1 calls of generate().
+         * Outputs are not calculated, so previous is not updated.
+         * @param out array of \b n elements to store parity values
+         * @param n number of state transitions
+         */
+        void parity_block(w256_t * out, int n) {
+            while (n > 0) {
+                int m = advance_run(n, out);
+                out += m;
+                n -= m;
+            }
+        }
+
+        /**
+         * Bulk output to caller's buffer. Outputs are same as \b n
+         * calls of generate(). When \b out is aligned to sizeof(w256_t),
+         * outputs are written by non temporal stores.
+         * @param out array of \b n elements
+         * @param n number of outputs
+         */
+        void fill(w256_t * out, size_t n) {
+            while (n > 0) {
+                int start = next_index(index, size());
+                int m = size();
+                if (n < static_cast<size_t>(m)) {
+                    m = static_cast<int>(n);
                 }
-                for (int i = weight_mode; i < max_weight_mode; i++) {
-                    r2.u[i] = previous.u[i];
+                m = advance_run(m, NULL);
+                for (int i = 0; i < m; i++) {
+                    stream_store(&out[i], output(start + i));
                 }
+                out += m;
+                n -= m;
             }
-            previous = r;
-            return r2;
+            stream_fence();
+        }
+
+        /**
+         * Bulk output of \b nbytes bytes to \b p.
+         * @param p buffer
+         * @param nbytes size of buffer in bytes
+         */
+        void fill_bytes(void * p, size_t nbytes) {
+            bulk_fill_bytes<w256_t>(*this, p, nbytes);
         }
 
         void setStartMode(int mode) {
@@ -279,10 +326,10 @@ namespace MTToolBox {
         }
 
         void setUpParam(ParameterGenerator& mt) {
-            if (size == 2) {
+            if (size() == 2) {
                 param.pos1 = 1;
             } else {
-                param.pos1 = mt.getUint32() % (size - 1) + 1;
+                param.pos1 = mt.getUint32() % (size() - 1) + 1;
             }
             if (fixedSL1 > 0) {
                 param.sl1 = fixedSL1;
@@ -302,10 +349,15 @@ namespace MTToolBox {
             for (int i = 0; i < 8; i++) {
                 param.mat1.u[i] = mt.getUint32() | mt.getUint32();
             }
+            if (stream_id >= 0) {
+                param.mat1.u[0] = (param.mat1.u[0] & UINT32_C(0xffff0000))
+                    | stream_id;
+            }
+            check_fixed();
         }
 
         void setZero() {
-            for (int i = 0; i < size; i++) {
+            for (int i = 0; i < size(); i++) {
                 MTToolBox::setZero(state[i]);
             }
             MTToolBox::setZero(lung);
@@ -314,7 +366,7 @@ namespace MTToolBox {
         }
 
         bool isZero() const {
-            for (int i = 0; i < size; i++) {
+            for (int i = 0; i < size(); i++) {
                 if (!MTToolBox::isZero(state[i])) {
                     return false;
                 }
@@ -347,13 +399,13 @@ namespace MTToolBox {
 
         void setOneBit(int bitPos) {
             setZero();
-            if (bitPos < size * element_size) {
+            if (bitPos < size() * element_size) {
                 int idx = bitPos / element_size;
                 int p = (bitPos / 64) % 4;
                 int r = bitPos % 64;
                 state[idx].u64[p] = UINT64_C(1) << r;
             } else {
-                bitPos = bitPos - size * element_size;
+                bitPos = bitPos - size() * element_size;
                 int p = (bitPos / 64) % 4;
                 int r = bitPos % 64;
                 lung.u64[p] = UINT64_C(1) << r;
@@ -361,7 +413,7 @@ namespace MTToolBox {
         }
 
         void add(EquidistributionCalculatable<w256_t>& other) {
-            SFMTAVX2 *that = dynamic_cast<SFMTAVX2 *>(&other);
+            SFMTAVX2_T *that = dynamic_cast<SFMTAVX2_T *>(&other);
             if (that == 0) {
                 throw std::invalid_argument(
                     "the adder should have same type as the addee.");
@@ -369,11 +421,9 @@ namespace MTToolBox {
             this->add(that);
         }
 
-        void add(const SFMTAVX2 * that) {
-            for (int i = 0; i < size; i++) {
-                state[(i + index) % size]
-                    ^= that->state[(i + that->index) % size];
-            }
+        void add(const SFMTAVX2_T * that) {
+            add_state(state.data(), index, that->state.data(), that->index,
+                      size());
             lung ^= that->lung;
             previous ^= that->previous;
         }
@@ -383,7 +433,7 @@ namespace MTToolBox {
         }
 
         int bitSize() const {
-            return (size + 1) * 256;
+            return (size() + 1) * 256;
         }
 
         const std::string getHeaderString() {
@@ -427,39 +477,150 @@ namespace MTToolBox {
 
         void d_p() {
             cout << "index = " << dec << index << endl;
-            for (int i = 0; i < size; i++) {
+            for (int i = 0; i < size(); i++) {
                 cout << state[i] << endl;
             }
             cout << lung << endl;
         }
         void setFixedSL1(int value) {
+            if (SL1 > 0 && value != SL1) {
+                throw new std::logic_error(
+                    "sl1 is fixed by template argument");
+            }
             fixedSL1 = value;
         }
         void setFixedSR1(int value) {
+            if (SR1 > 0 && value != SR1) {
+                throw new std::logic_error(
+                    "sr1 is fixed by template argument");
+            }
             fixedSR1 = value;
         }
         void setFixedPerm(int value) {
+            if (PERM > 0 && value != PERM) {
+                throw new std::logic_error(
+                    "perm is fixed by template argument");
+            }
             fixedPerm = value;
         }
 
+        /**
+         * Embed \b id in the lowest 16 bits of mat1, so that
+         * generators of different streams have different recursions.
+         * @param id stream id, from 0 to 65535, or -1 for none
+         */
+        void setStreamID(int id) {
+            if (id < -1 || id > 0xffff) {
+                throw new std::logic_error("stream id out of range");
+            }
+            stream_id = id;
+        }
+
+        int getStreamID() const {
+            return stream_id;
+        }
+
     private:
-        SFMTAVX2& operator=(const SFMTAVX2&) {
+        /**
+         * throw if the parameter set differs from the template
+         * arguments, which the recursion uses instead of it.
+         */
+        void check_fixed() const {
+            if ((SL1 > 0 && param.sl1 != SL1)
+                || (SR1 > 0 && param.sr1 != SR1)
+                || (PERM > 0 && param.perm != PERM)) {
+                throw new std::logic_error(
+                    "parameter differs from template argument");
+            }
+        }
+
+        int size() const {
+            return state.size();
+        }
+
+        /**
+         * advance state at most \b n steps until the index or the index
+         * plus pos1 wraps around.
+         * @param n maximum number of steps
+         * @param lung_out if not NULL, lung after each step is stored
+         * @return number of steps advanced
+         */
+        int advance_run(int n, w256_t * lung_out) {
+            int p = next_index(index, size());
+            int q = add_index(p, param.pos1, size());
+            int m = size() - p;
+            if (size() - q < m) {
+                m = size() - q;
+            }
+            if (n < m) {
+                m = n;
+            }
+            for (int i = 0; i < m; i++) {
+                do_recursion(&state[p + i], &state[p + i], &state[q + i],
+                             &lung);
+                if (lung_out != NULL) {
+                    lung_out[i] = lung;
+                }
+            }
+            index = p + m - 1;
+            return m;
+        }
+
+        /**
+         * output of state[idx] in the current start mode and weight mode.
+         */
+        w256_t output(int idx) {
+            w256_t r;
+            int p = prev_index(idx, size());
+            if (start_mode == 0) {
+                r = state[idx];
+            } else {
+                for (int i = 0; i < 8 - start_mode; i++) {
+                    r.u[i] = state[p].u[i + start_mode];
+                }
+                int j = 0;
+                for (int i = 8 - start_mode; i < 8; i++) {
+                    r.u[i] = state[idx].u[j++];
+                }
+            }
+            w256_t r2;
+            if (weight_mode == max_weight_mode) {
+                r2 = r;
+            } else {
+                for (int i = 0; i < weight_mode; i++) {
+                    r2.u[i] = r.u[i];
+                }
+                for (int i = weight_mode; i < max_weight_mode; i++) {
+                    r2.u[i] = previous.u[i];
+                }
+            }
+            previous = r;
+            return r2;
+        }
+
+        SFMTAVX2_T& operator=(const SFMTAVX2_T&) {
             throw std::logic_error("can't assign");
         }
         enum {element_size = 256, max_weight_mode = 8};
+        enum {fixed_size = MEXP > 0 ? MEXP / 256 : 0};
         int fixedSL1;
         int fixedSR1;
         int fixedPerm;
-        int size;
+        int stream_id;
         int index;
         int start_mode;
         int weight_mode;
-        w256_t * state;
+        state_array<w256_t, fixed_size> state;
         w256_t lung;
         SFMTAVX2_param param;
         bool reverse_bit_flag;
         w256_t previous;
     };
+
+    /**
+     * SFMTAVX2 with parameters selected at run time.
+     */
+    typedef SFMTAVX2_T<> SFMTAVX2;
 }
 
 #endif
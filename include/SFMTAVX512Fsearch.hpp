@@ -6,6 +6,9 @@
  */
 
 #include "devavxprng.h"
+#include "SIMDKernel.hpp"
+#include "StateArray.hpp"
+#include "BulkOutput.hpp"
 #include "w512.hpp"
 #include <sstream>
 #include <MTToolBox/ReducibleGenerator.hpp>
@@ -117,31 +120,37 @@ namespace MTToolBox {
     };
 
     /**
-     * @class SFMTAVX512F
+     * @class SFMTAVX512F_T
      * @brief SFMTAVX512F generator class used for dynamic creation
      *
      * This class is one of the main class of SFMTAVX512F dynamic creator.
      * This class is designed to be called from programs in MTToolBox,
      * but is not a subclass of some abstract class.
      * Instead, this class is passed to them as template parameters.
+     *
+     * @tparam SL1 sl1 fixed at compile time, 0 means run time
+     * @tparam SR1 sr1 fixed at compile time, 0 means run time
+     * @tparam PERM perm fixed at compile time, 0 means run time
+     * @tparam MEXP mersenne exponent fixed at compile time, the state
+     * is kept inline. 0 means run time and the state is on heap.
      */
-    class SFMTAVX512F : public ReducibleGenerator<w512_t> {
+    template<int SL1 = 0, int SR1 = 0, int PERM = 0, int MEXP = 0>
+    class SFMTAVX512F_T : public ReducibleGenerator<w512_t> {
     public:
         /**
          * Constructor by mexp.
          * @param mexp Mersenne Exponent
          */
-        SFMTAVX512F(int mexp) {
-            size = mexp / 512;
-            state = new w512_t[size];
+        SFMTAVX512F_T(int mexp) : state(mexp / 512) {
             param.mexp = mexp;
             param.pos1 = 0;
             param.sl1 = 0;
             param.sr1 = 0;
             param.perm = 1;
-            fixedSL1 = 0;
-            fixedSR1 = 0;
-            fixedPerm = 0;
+            fixedSL1 = SL1;
+            fixedSR1 = SR1;
+            fixedPerm = PERM;
+            stream_id = -1;
             MTToolBox::setZero(param.mat1);
             MTToolBox::setZero(param.parity1);
             MTToolBox::setZero(lung);
@@ -152,23 +161,16 @@ namespace MTToolBox {
             MTToolBox::setZero(previous);
         }
 
-        ~SFMTAVX512F() {
-            delete[] state;
-        }
-
         /**
          * The copy constructor.
          * @param src The origin of copy.
          */
-        SFMTAVX512F(const SFMTAVX512F& src) : param(src.param) {
-            size = src.size;
-            state = new w512_t[size];
-            for (int i = 0; i < size; i++) {
-                state[i] = src.state[i];
-            }
+        SFMTAVX512F_T(const SFMTAVX512F_T& src)
+            : state(src.state), param(src.param) {
             fixedSL1 = src.fixedSL1;
             fixedSR1 = src.fixedSR1;
             fixedPerm = src.fixedPerm;
+            stream_id = src.stream_id;
             lung = src.lung;
             index = src.index;
             start_mode = src.start_mode;
@@ -181,25 +183,26 @@ namespace MTToolBox {
          * Constructor by parameter.
          * @param src_param
          */
-        SFMTAVX512F(const SFMTAVX512F_param& src_param) : param(src_param) {
-            size = src_param.mexp / 512;
-            state = new w512_t[size];
-            for (int i = 0; i < size; i++) {
+        SFMTAVX512F_T(const SFMTAVX512F_param& src_param)
+            : state(src_param.mexp / 512), param(src_param) {
+            for (int i = 0; i < size(); i++) {
                 MTToolBox::setZero(state[i]);
             }
             MTToolBox::setZero(lung);
-            fixedSL1 = 0;
-            fixedSR1 = 0;
-            fixedPerm = 0;
+            fixedSL1 = SL1;
+            fixedSR1 = SR1;
+            fixedPerm = PERM;
+            stream_id = -1;
             index = 0;
             start_mode = 0;
             weight_mode = 16;
             MTToolBox::setZero(previous);
             reverse_bit_flag = false;
+            check_fixed();
         }
 
         EquidistributionCalculatable<w512_t> * clone() const {
-            return new SFMTAVX512F(*this);
+            return new SFMTAVX512F_T(*this);
         }
 
         /**
@@ -210,24 +213,24 @@ namespace MTToolBox {
         void seed(w512_t seed) {
             setZero();
             state[0] = seed;
-            uint32_t * pstate = new uint32_t[(size + 1) * 16];
+            uint32_t * pstate = new uint32_t[(size() + 1) * 16];
             for (int i = 0; i < 16; i++) {
                 pstate[i] = seed.u[i];
             }
-            for (int i = 16; i < (size + 1) * 16; i++) {
+            for (int i = 16; i < (size() + 1) * 16; i++) {
                 pstate[i] = 0;
             }
-            for (int i = 1; i < size * 16; i++) {
+            for (int i = 1; i < size() * 16; i++) {
                 pstate[i] ^= i + UINT32_C(1812433253)
                     * (pstate[i - 1] ^ (pstate[i - 1] >> 30));
             }
-            for (int i = 0; i < size; i++) {
+            for (int i = 0; i < size(); i++) {
                 for (int j = 0; j < 16; j++) {
                     state[i].u[j] = pstate[i * 16 + j];
                 }
             }
             for (int i = 0; i < 16; i++) {
-                lung.u[i] = pstate[size * 16 + i];
+                lung.u[i] = pstate[size() * 16 + i];
             }
             index = 0;
             delete[] pstate;
@@ -235,23 +238,22 @@ namespace MTToolBox {
         }
 
         void do_recursion(w512_t *r, w512_t *a, w512_t *b, w512_t *lung) {
-            *lung = permutexvar_epi32(*lung, param.perm);
-            *lung ^= *b;
-            *lung ^= SL64(*a, param.sl1);
-            w512_t t;
-            t = *lung;
-            t ^= SR64(*b & param.mat1, param.sr1);
-            t ^= *a;
-            *r = t;
+            if (SL1 > 0 && SR1 > 0 && PERM > 0) {
+                sfmt_recursion_fixed<SL1, SR1, PERM>(r, a, b, lung,
+                                                     param.mat1);
+            } else {
+                sfmt_recursion(r, a, b, lung, param.mat1, param.sl1,
+                               param.sr1, param.perm);
+            }
         }
         /**
          * Important state transition function.
          */
         void next_state() {
-            index = (index + 1) % size;
+            index = next_index(index, size());
             do_recursion(&state[index],
                          &state[index],
-                         &state[(index + param.pos1) % size],
+                         &state[add_index(index, param.pos1, size())],
                          &lung);
         }
 
@@ -261,48 +263,74 @@ namespace MTToolBox {
          */
         w512_t generate() {
             next_state();
-            w512_t r;
-            index = index % size;
-            int p = (index + size - 1) % size;
-            if (start_mode == 0) {
-                r = state[index];
-            } else {
-                for (int i = 0; i < 16 - start_mode; i++) {
-                    r.u[i] = state[p].u[i + start_mode];
-                }
-                int j = 0;
-                for (int i = 16 - start_mode; i < 16; i++) {
-                    r.u[i] = state[index].u[j++];
+            return output(index);
+        }
+
+        /**
+         * Block generation. Outputs are same as \b n calls of
+         * generate(), but the state is updated in runs without
+         * wraparound, like gen_rand_all of SFMT.
+         * @param out array of \b n elements to store outputs
+         * @param n number of outputs
+         */
+        void generate_block(w512_t * out, int n) {
+            while (n > 0) {
+                int start = next_index(index, size());
+                int m = advance_run(n, NULL);
+                for (int i = 0; i < m; i++) {
+                    out[i] = output(start + i);
                 }
+                out += m;
+                n -= m;
             }
-#if defined(DEBUG) && 0
-            if (start_mode != 0) {
-                cout << "start_mode = " << dec << start_mode
-                     << " index = " << dec << index
-                     << " p = " << dec << p << endl;
+        }
+
+        /**
+         * Block state transition for sequences of parity values.
+         * out[i] is getParityValue() after i + 1 calls of generate().
+         * Outputs are not calculated, so previous is not updated.
+         * @param out array of \b n elements to store parity values
+         * @param n number of state transitions
+         */
+        void parity_block(w512_t * out, int n) {
+            while (n > 0) {
+                int m = advance_run(n, out);
+                out += m;
+                n -= m;
             }
-#endif
-            w512_t r2;
-            if (weight_mode == max_weight_mode) {
-                r2 = r;
-            } else {
-                for (int i = 0; i < weight_mode; i++) {
-                    r2.u[i] = r.u[i];
+        }
+
+        /**
+         * Bulk output to caller's buffer. Outputs are same as \b n
+         * calls of generate(). When \b out is aligned to sizeof(w512_t),
+         * outputs are written by non temporal stores.
+         * @param out array of \b n elements
+         * @param n number of outputs
+         */
+        void fill(w512_t * out, size_t n) {
+            while (n > 0) {
+                int start = next_index(index, size());
+                int m = size();
+                if (n < static_cast<size_t>(m)) {
+                    m = static_cast<int>(n);
                 }
-                for (int i = weight_mode; i < max_weight_mode; i++) {
-                    r2.u[i] = previous.u[i];
+                m = advance_run(m, NULL);
+                for (int i = 0; i < m; i++) {
+                    stream_store(&out[i], output(start + i));
                 }
+                out += m;
+                n -= m;
             }
+            stream_fence();
+        }
 
-#if defined(DEBUG) && 0
-            cout << "w:" << dec << weight_mode
-                 << " s:" << dec << start_mode << endl;
-            cout << "r:" << hex << r << endl;
-            cout << "p:" << hex << previous << endl;
-            cout << "2:" << hex << r2 << endl;
-#endif
-            previous = r;
-            return r2;
+        /**
+         * Bulk output of \b nbytes bytes to \b p.
+         * @param p buffer
+         * @param nbytes size of buffer in bytes
+         */
+        void fill_bytes(void * p, size_t nbytes) {
+            bulk_fill_bytes<w512_t>(*this, p, nbytes);
         }
 
         void setStartMode(int mode) {
@@ -342,7 +370,7 @@ namespace MTToolBox {
             if (param.mexp == 1279) {
                 param.pos1 = 1;
             } else {
-                param.pos1 = mt.getUint32() % (size - 2) + 1;
+                param.pos1 = mt.getUint32() % (size() - 2) + 1;
             }
             if (fixedSL1 > 0) {
                 // These parameters are not best ones.
@@ -364,10 +392,15 @@ namespace MTToolBox {
             for (int i = 0; i < 16; i++) {
                 param.mat1.u[i] = mt.getUint32() | mt.getUint32();
             }
+            if (stream_id >= 0) {
+                param.mat1.u[0] = (param.mat1.u[0] & UINT32_C(0xffff0000))
+                    | stream_id;
+            }
+            check_fixed();
         }
 
         void setZero() {
-            for (int i = 0; i < size; i++) {
+            for (int i = 0; i < size(); i++) {
                 MTToolBox::setZero(state[i]);
             }
             MTToolBox::setZero(lung);
@@ -381,7 +414,7 @@ namespace MTToolBox {
          * @return true if all elements of state is zero
          */
         bool isZero() const {
-            for (int i = 0; i < size; i++) {
+            for (int i = 0; i < size(); i++) {
                 if (!MTToolBox::isZero(state[i])) {
                     return false;
                 }
@@ -414,13 +447,13 @@ namespace MTToolBox {
 
         void setOneBit(int bitPos) {
             setZero();
-            if (bitPos < size * element_size) {
+            if (bitPos < size() * element_size) {
                 int idx = bitPos / element_size;
                 int p = (bitPos / 64) % 8;
                 int r = bitPos % 64;
                 state[idx].u64[p] = UINT64_C(1) << r;
             } else {
-                bitPos = bitPos - size * element_size;
+                bitPos = bitPos - size() * element_size;
                 int p = (bitPos / 64) % 8;
                 int r = bitPos % 64;
                 lung.u64[p] = UINT64_C(1) << r;
@@ -432,10 +465,10 @@ namespace MTToolBox {
          * simple_shortest_basis.hpp addition of internal state as
          * GF(2) vector is possible when state transition function and
          * output function is GF(2)-linear.
-         * @param that SFMTAVX512F generator added to this generator
+         * @param that SFMTAVX512F_T generator added to this generator
          */
         void add(EquidistributionCalculatable<w512_t>& other) {
-            SFMTAVX512F *that = dynamic_cast<SFMTAVX512F *>(&other);
+            SFMTAVX512F_T *that = dynamic_cast<SFMTAVX512F_T *>(&other);
             if (that == 0) {
                 throw std::invalid_argument(
                     "the adder should have same type as the addee.");
@@ -443,11 +476,9 @@ namespace MTToolBox {
             this->add(that);
         }
 
-        void add(const SFMTAVX512F * that) {
-            for (int i = 0; i < size; i++) {
-                state[(i + index) % size]
-                    ^= that->state[(i + that->index) % size];
-            }
+        void add(const SFMTAVX512F_T * that) {
+            add_state(state.data(), index, that->state.data(), that->index,
+                      size());
             lung ^= that->lung;
             previous ^= that->previous;
         }
@@ -457,7 +488,7 @@ namespace MTToolBox {
         }
 
         int bitSize() const {
-            return (size + 1) * 512;
+            return (size() + 1) * 512;
         }
 
         const std::string getHeaderString() {
@@ -496,7 +527,7 @@ namespace MTToolBox {
             for (int i = 7; i >= 0; i--) {
                 uint64_t work = 1;
                 for (int j = 0; j < 64; j++) {
-                    if ((work & param.parity1.u[i]) != 0) {
+                    if ((work & param.parity1.u64[i]) != 0) {
                         lung.u64[i] ^= work;
                         return 0;
                     }
@@ -508,39 +539,165 @@ namespace MTToolBox {
 
         void d_p() {
             cout << "index = " << dec << index << endl;
-            for (int i = 0; i < size; i++) {
+            for (int i = 0; i < size(); i++) {
                 cout << state[i] << endl;
             }
             cout << lung << endl;
         }
         void setFixedSL1(int value) {
+            if (SL1 > 0 && value != SL1) {
+                throw new std::logic_error(
+                    "sl1 is fixed by template argument");
+            }
             fixedSL1 = value;
         }
         void setFixedSR1(int value) {
+            if (SR1 > 0 && value != SR1) {
+                throw new std::logic_error(
+                    "sr1 is fixed by template argument");
+            }
             fixedSR1 = value;
         }
         void setFixedPerm(int value) {
+            if (PERM > 0 && value != PERM) {
+                throw new std::logic_error(
+                    "perm is fixed by template argument");
+            }
             fixedPerm = value;
         }
 
+        /**
+         * Embed \b id in the lowest 16 bits of mat1, so that
+         * generators of different streams have different recursions.
+         * @param id stream id, from 0 to 65535, or -1 for none
+         */
+        void setStreamID(int id) {
+            if (id < -1 || id > 0xffff) {
+                throw new std::logic_error("stream id out of range");
+            }
+            stream_id = id;
+        }
+
+        int getStreamID() const {
+            return stream_id;
+        }
+
     private:
-        SFMTAVX512F& operator=(const SFMTAVX512F&) {
+        /**
+         * throw if the parameter set differs from the template
+         * arguments, which the recursion uses instead of it.
+         */
+        void check_fixed() const {
+            if ((SL1 > 0 && param.sl1 != SL1)
+                || (SR1 > 0 && param.sr1 != SR1)
+                || (PERM > 0 && param.perm != PERM)) {
+                throw new std::logic_error(
+                    "parameter differs from template argument");
+            }
+        }
+
+        int size() const {
+            return state.size();
+        }
+
+        /**
+         * advance state at most \b n steps until the index or the index
+         * plus pos1 wraps around.
+         * @param n maximum number of steps
+         * @param lung_out if not NULL, lung after each step is stored
+         * @return number of steps advanced
+         */
+        int advance_run(int n, w512_t * lung_out) {
+            int p = next_index(index, size());
+            int q = add_index(p, param.pos1, size());
+            int m = size() - p;
+            if (size() - q < m) {
+                m = size() - q;
+            }
+            if (n < m) {
+                m = n;
+            }
+            for (int i = 0; i < m; i++) {
+                do_recursion(&state[p + i], &state[p + i], &state[q + i],
+                             &lung);
+                if (lung_out != NULL) {
+                    lung_out[i] = lung;
+                }
+            }
+            index = p + m - 1;
+            return m;
+        }
+
+        /**
+         * output of state[idx] in the current start mode and weight mode.
+         */
+        w512_t output(int idx) {
+            w512_t r;
+            int p = prev_index(idx, size());
+            if (start_mode == 0) {
+                r = state[idx];
+            } else {
+                for (int i = 0; i < 16 - start_mode; i++) {
+                    r.u[i] = state[p].u[i + start_mode];
+                }
+                int j = 0;
+                for (int i = 16 - start_mode; i < 16; i++) {
+                    r.u[i] = state[idx].u[j++];
+                }
+            }
+#if defined(DEBUG) && 0
+            if (start_mode != 0) {
+                cout << "start_mode = " << dec << start_mode
+                     << " idx = " << dec << idx
+                     << " p = " << dec << p << endl;
+            }
+#endif
+            w512_t r2;
+            if (weight_mode == max_weight_mode) {
+                r2 = r;
+            } else {
+                for (int i = 0; i < weight_mode; i++) {
+                    r2.u[i] = r.u[i];
+                }
+                for (int i = weight_mode; i < max_weight_mode; i++) {
+                    r2.u[i] = previous.u[i];
+                }
+            }
+
+#if defined(DEBUG) && 0
+            cout << "w:" << dec << weight_mode
+                 << " s:" << dec << start_mode << endl;
+            cout << "r:" << hex << r << endl;
+            cout << "p:" << hex << previous << endl;
+            cout << "2:" << hex << r2 << endl;
+#endif
+            previous = r;
+            return r2;
+        }
+
+        SFMTAVX512F_T& operator=(const SFMTAVX512F_T&) {
             throw std::logic_error("can't assign");
         }
         enum {element_size = 512, max_weight_mode = 16};
+        enum {fixed_size = MEXP > 0 ? MEXP / 512 : 0};
         int fixedSL1;
         int fixedSR1;
         int fixedPerm;
-        int size;
+        int stream_id;
         int index;
         int start_mode;
         int weight_mode;
-        w512_t * state;
+        state_array<w512_t, fixed_size> state;
         w512_t lung;
         SFMTAVX512F_param param;
         bool reverse_bit_flag;
         w512_t previous;
     };
+
+    /**
+     * SFMTAVX512F with parameters selected at run time.
+     */
+    typedef SFMTAVX512F_T<> SFMTAVX512F;
 }
 
 #endif
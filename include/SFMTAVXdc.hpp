@@ -13,21 +13,19 @@
 #include "AlgorithmSIMDEquidistribution.hpp"
 #include "Annihilate.hpp"
 #include "DCOptions.hpp"
+#include "StreamSearch.hpp"
+#include "ParallelSearch.hpp"
+#include "SearchPipeline.hpp"
+#include <sstream>
 
 namespace MTToolBox {
     /**
-     * search parameters using all_in_one function in the file search_all.hpp
+     * set shift and permutation parameters fixed by command line
+     * @param g generator
      * @param opt command line options
-     * @param count number of parameters user requested
-     * @return 0 if this ends normally
      */
-    template<typename U, typename G, int bitWidth>
-    int sfmtavx_search(DCOptions& opt, int count) {
-        using namespace std;
-        using namespace NTL;
-        MersenneTwister mt(opt.seed);
-        G g(opt.mexp);
-
+    template<typename G>
+    void sfmtavx_set_fixed(G& g, const DCOptions& opt) {
         if (opt.fixedL) {
             g.setFixedSL1(opt.fixedSL1);
         }
@@ -37,80 +35,362 @@ namespace MTToolBox {
         if (opt.fixedP) {
             g.setFixedPerm(opt.fixedPerm);
         }
+    }
+
+    /**
+     * parity check vector and annihilation of the quotient of a
+     * parameter set found.
+     * @param g generator with the parameter set
+     * @param irreducible irreducible factor of characteristic polynomial
+     * @return false if the quotient can't be annihilated
+     */
+    template<typename U, typename G>
+    bool sfmtavx_prepare(G& g, const NTL::GF2X& irreducible) {
+        AlgorithmCalculateParity<U, G> cp;
+        Annihilate<G, U> annihilate;
+        PolynomialContext context(irreducible);
+        cp.searchParity(g, irreducible);
+        U seed;
+        setBitOfPos(&seed, 0, 1);
+        g.seed(seed);
+        return annihilate.anni(g, context);
+    }
+
+    /**
+     * equidistribution of a parameter set prepared. When --max-delta32
+     * or --max-delta64 is given, the computation stops as soon as the
+     * sum of defects is known to exceed the limit.
+     * @param g generator prepared by sfmtavx_prepare()
+     * @param opt command line options
+     * @param stats statistics of candidates discarded
+     * @return line of parameters and dimension defects, empty if the
+     * parameter set is discarded
+     */
+    template<typename U, typename G, int bitWidth>
+    std::string sfmtavx_check_equidistribution(G& g,
+                                               const DCOptions& opt,
+                                               DeltaBoundStats& stats) {
+        using namespace std;
+        int mexp = opt.mexp;
+        int delta32 = 0;
+        int delta64 = 0;
+        int veq32[32];
+        SIMDInfo info;
+        info.bitMode = 32;
+        info.elementNo = bitWidth / 32;
+        info.bitSize = bitWidth;
+        info.fastMode = true;
+        if (opt.max_delta32 >= 0) {
+            delta32
+                = calc_SIMD_equidistribution_bound<U, G>
+                (g, veq32, 32, info, mexp, opt.max_delta32, stats);
+            if (delta32 > opt.max_delta32) {
+                stats.add_evaluations(0, 64, 0);
+                stats.add_candidate(true);
+                return "";
+            }
+        } else {
+            delta32
+                = calc_SIMD_equidistribution<U, G>
+                (g, veq32, 32, info, mexp);
+        }
+        int veq64[64];
+        info.bitMode = 64;
+        info.elementNo = bitWidth / 64;
+        if (opt.max_delta64 >= 0) {
+            delta64
+                = calc_SIMD_equidistribution_bound<U, G>
+                (g, veq64, 64, info, mexp, opt.max_delta64, stats);
+            if (delta64 > opt.max_delta64) {
+                stats.add_candidate(true);
+                return "";
+            }
+        } else {
+            delta64
+                = calc_SIMD_equidistribution<U, G>
+                (g, veq64, 64, info, mexp);
+        }
+        stats.add_candidate(false);
+        stringstream ss;
+        ss << g.getParamString();
+        ss << dec << delta32 << "," << delta64;
+        ss << "," << dec << veq64[63];
+        return ss.str();
+    }
+
+    /**
+     * parity check vector, annihilation of the quotient and
+     * equidistribution of a parameter set found.
+     * @param g generator with the parameter set
+     * @param irreducible irreducible factor of characteristic polynomial
+     * @param opt command line options
+     * @param stats statistics of candidates discarded
+     * @param line line of parameters and dimension defects, empty if
+     * the parameter set is discarded by --max-delta32 or --max-delta64
+     * @return false if the quotient can't be annihilated
+     */
+    template<typename U, typename G, int bitWidth>
+    bool sfmtavx_found(G& g, const NTL::GF2X& irreducible,
+                       const DCOptions& opt, DeltaBoundStats& stats,
+                       std::string& line) {
+        if (!sfmtavx_prepare<U, G>(g, irreducible)) {
+            return false;
+        }
+        line = sfmtavx_check_equidistribution<U, G, bitWidth>(g, opt,
+                                                              stats);
+        return true;
+    }
+
+    /**
+     * search one parameter set for each stream id, see StreamSearch.hpp
+     * @param opt command line options
+     * @return 0 if this ends normally
+     */
+    template<typename U, typename G, int bitWidth>
+    int sfmtavx_stream_search(DCOptions& opt) {
+        using namespace std;
+        using namespace NTL;
+        StreamTable table(opt.stream_first, opt.count);
+        DeltaBoundStats stats;
+        G header(opt.mexp);
         cout << "seed = " << dec << opt.seed << endl;
         if (opt.verbose) {
             time_t t = time(NULL);
             cout << "search start at " << ctime(&t);
+            cout << "kernel = " << kernel_name<U>() << endl;
+        }
+        auto worker = [&opt, &table, &stats](long id) -> bool {
+            MersenneTwister mt(stream_seed(opt.seed, id));
+            G g(opt.mexp);
+            sfmtavx_set_fixed(g, opt);
+            g.setStreamID(id);
+            AlgorithmReducibleRecursionSearch<U> ars(g, mt);
+            for (;;) {
+                if (!ars.start(opt.mexp * 100)) {
+                    return false;
+                }
+                GF2X irreducible = ars.getIrreducibleFactor();
+                if (deg(irreducible) != opt.mexp) {
+                    return false;
+                }
+                if (!table.add_polynomial(irreducible)) {
+                    continue;
+                }
+                string line;
+                if (!sfmtavx_found<U, G, bitWidth>(g, irreducible, opt,
+                                                   stats, line)) {
+                    return false;
+                }
+                if (line.empty()) {
+                    continue;
+                }
+                table.set_line(id, line);
+                return true;
+            }
+        };
+        int threads = search_threads(opt.threads, opt.count);
+        if (!run_stream_workers(table, worker, threads)) {
+            cout << "search failed" << endl;
+            return -1;
+        }
+        table.print(cout, header.getHeaderString()
+                    + ", delta32, delta64");
+        if (opt.hasMaxDelta()) {
+            stats.print(cout);
+        }
+        if (opt.verbose) {
+            time_t t = time(NULL);
+            cout << "duplicated polynomials = " << dec
+                 << table.get_duplicates() << endl;
+            PolynomialContext::print(cout);
+            cout << "search end at " << ctime(&t) << endl;
+        }
+        return 0;
+    }
+
+    /**
+     * search parameters by \b threads threads, see ParallelSearch.hpp.
+     * Worker w uses seed worker_seed(opt.seed, opt.rank, w), so the
+     * first worker uses the same seed as the search by one thread.
+     * @param opt command line options
+     * @param count number of parameters user requested
+     * @param threads number of worker threads
+     * @return 0 if this ends normally
+     */
+    template<typename U, typename G, int bitWidth>
+    int sfmtavx_parallel_search(DCOptions& opt, long count, int threads) {
+        using namespace std;
+        using namespace NTL;
+        DeltaBoundStats stats;
+        auto worker = [&opt, &stats](int w, ResultQueue& queue,
+                                     const atomic<bool>& stop) -> bool {
+            MersenneTwister mt(worker_seed(opt.seed, opt.rank, w));
+            G g(opt.mexp);
+            sfmtavx_set_fixed(g, opt);
+            AlgorithmReducibleRecursionSearch<U> ars(g, mt);
+            while (!stop) {
+                if (!ars.start(opt.mexp * 100)) {
+                    return false;
+                }
+                GF2X irreducible = ars.getIrreducibleFactor();
+                if (deg(irreducible) != opt.mexp) {
+                    return false;
+                }
+                string line;
+                if (!sfmtavx_found<U, G, bitWidth>(g, irreducible, opt,
+                                                   stats, line)) {
+                    return false;
+                }
+                if (!line.empty() && !push_result(queue, line, stop)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        long written = parallel_search(threads, count, worker, cout);
+        if (written < count) {
+            cout << "search failed" << endl;
+            return -1;
+        }
+        if (opt.hasMaxDelta()) {
+            stats.print(cout);
+        }
+        if (opt.verbose) {
+            time_t t = time(NULL);
+            cout << "threads = " << dec << threads << endl;
+            PolynomialContext::print(cout);
+            cout << "search end at " << ctime(&t) << endl;
+        }
+        return 0;
+    }
+
+    /**
+     * search parameters by the pipeline of SearchPipeline.hpp. Worker
+     * w of the first stage uses seed worker_seed(opt.seed, opt.rank, w).
+     * @param g generator whose fixed parameters are set
+     * @param opt command line options
+     * @param count number of parameters user requested
+     * @return 0 if this ends normally
+     */
+    template<typename U, typename G, int bitWidth>
+    int sfmtavx_pipeline_search(const G& g, DCOptions& opt, long count) {
+        using namespace std;
+        typedef search_candidate<G> C;
+        typedef CandidateSearch<U, G, MersenneTwister> S;
+        DeltaBoundStats stats;
+        vector<S *> searchers;
+        for (int w = 0; w < opt.pipeline[0]; w++) {
+            searchers.push_back(new S(g,
+                                      worker_seed(opt.seed, opt.rank, w),
+                                      opt.mexp, opt.mexp * 100));
+        }
+        auto search = [&searchers](int w) -> C * {
+            return searchers[w]->next();
+        };
+        auto prepare = [](C& c) -> bool {
+            return sfmtavx_prepare<U, G>(c.g, c.irreducible);
+        };
+        auto equidistribution = [&opt, &stats](C& c) -> string {
+            return sfmtavx_check_equidistribution<U, G, bitWidth>(
+                c.g, opt, stats);
+        };
+        SearchPipeline<C> pipeline(opt.pipeline);
+        long written = pipeline.run(count, search, prepare,
+                                    equidistribution, cout);
+        for (size_t i = 0; i < searchers.size(); i++) {
+            delete searchers[i];
+        }
+        if (written < count) {
+            cout << "search failed" << endl;
+            return -1;
+        }
+        if (opt.hasMaxDelta()) {
+            stats.print(cout);
+        }
+        if (opt.verbose) {
+            time_t t = time(NULL);
+            pipeline.print_depth(cout);
+            PolynomialContext::print(cout);
+            cout << "search end at " << ctime(&t) << endl;
+        }
+        return 0;
+    }
+
+    /**
+     * search parameters using all_in_one function in the file search_all.hpp
+     * @param opt command line options
+     * @param count number of parameters user requested
+     * @return 0 if this ends normally
+     */
+    template<typename U, typename G, int bitWidth>
+    int sfmtavx_search(DCOptions& opt, int count) {
+        using namespace std;
+        using namespace NTL;
+        if (opt.stream_mode) {
+            return sfmtavx_stream_search<U, G, bitWidth>(opt);
+        }
+        MersenneTwister mt(worker_seed(opt.seed, opt.rank, 0));
+        G g(opt.mexp);
+
+        sfmtavx_set_fixed(g, opt);
+        cout << "seed = " << dec << opt.seed << endl;
+        if (opt.rank != 0) {
+            cout << "rank = " << dec << opt.rank << endl;
+        }
+        if (opt.verbose) {
+            time_t t = time(NULL);
+            cout << "search start at " << ctime(&t);
+            cout << "kernel = " << kernel_name<U>() << endl;
         }
-        AlgorithmReducibleRecursionSearch<U> ars(g, mt);
-        int i = 0;
-        AlgorithmCalculateParity<U, G> cp;
-        Annihilate<G, U> annihilate;
         cout << "# " << g.getHeaderString() << ", delta32, delta64"
              << endl;
+        if (opt.pipeline_mode) {
+            if (ntl_thread_safe()) {
+                return sfmtavx_pipeline_search<U, G, bitWidth>(g, opt,
+                                                               count);
+            }
+            cerr << "NTL is built without NTL_THREADS, "
+                 << "search without pipeline" << endl;
+        }
+        if (opt.threads > 1) {
+            int threads = search_threads(opt.threads, count);
+            if (threads > 1) {
+                return sfmtavx_parallel_search<U, G, bitWidth>(opt, count,
+                                                               threads);
+            }
+        }
+        AlgorithmReducibleRecursionSearch<U> ars(g, mt);
+        DeltaBoundStats stats;
+        int i = 0;
         while (i < count) {
             if (ars.start(opt.mexp * 100)) {
                 GF2X irreducible = ars.getIrreducibleFactor();
-                GF2X characteristic = ars.getCharacteristicPolynomial();
-                GF2X quotient = characteristic / irreducible;
                 if (deg(irreducible) != opt.mexp) {
                     cout << "error not erreducible" << endl;
                     return -1;
                 }
-#if 0
-                cout << "before parity" << endl;
-#endif
-                cp.searchParity(g, irreducible);
-                U seed;
-                setBitOfPos(&seed, 0, 1);
-                g.seed(seed);
-#if 0
-                cout << "before annihilate" << endl;
-#endif
-                if (!annihilate.anni(g)) {
+                string line;
+                if (!sfmtavx_found<U, G, bitWidth>(g, irreducible, opt,
+                                                   stats, line)) {
                     cout << "error can't annihilate" << endl;
                     return -1;
                 }
-                int delta32 = 0;
-                int delta64 = 0;
-                int veq32[32];
-                SIMDInfo info;
-                info.bitMode = 32;
-                info.elementNo = bitWidth / 32;
-                info.bitSize = bitWidth;
-                info.fastMode = true;
-#if 0
-                cout << "bitMode:" << dec << info.bitMode << endl;
-                cout << "elementNo:" << dec << info.elementNo << endl;
-                cout << "bitSize:" << dec << info.bitSize << endl;
-                cout << "fastmode:" << info.fastMode << endl;
-#endif
-                delta32
-                    = calc_SIMD_equidistribution<U, G>
-                    (g, veq32, 32, info, opt.mexp);
-                int veq64[64];
-                info.bitMode = 64;
-                info.elementNo = bitWidth / 64;
-#if 0
-                cout << "bitMode:" << dec << info.bitMode << endl;
-                cout << "elementNo:" << dec << info.elementNo << endl;
-                cout << "bitSize:" << dec << info.bitSize << endl;
-                cout << "fastmode:" << info.fastMode << endl;
-#endif
-                delta64
-                    = calc_SIMD_equidistribution<U, G>
-                    (g, veq64, 64, info, opt.mexp);
-                cout << g.getParamString();
-                cout << dec << delta32 << "," << delta64;
-                cout << "," << dec << veq64[63] << endl;
+                if (line.empty()) {
+                    continue;
+                }
+                cout << line << endl;
                 i++;
             } else {
                 cout << "search failed" << endl;
                 break;
             }
         }
+        if (opt.hasMaxDelta()) {
+            stats.print(cout);
+        }
         if (opt.verbose) {
             time_t t = time(NULL);
+            PolynomialContext::print(cout);
             cout << "search end at " << ctime(&t) << endl;
         }
         return 0;
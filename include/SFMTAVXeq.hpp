@@ -24,7 +24,7 @@ namespace MTToolBox {
         U wseed;
         wseed.u64[0] = opt.seed;
         sf.seed(wseed);
-        Annihilate<G, U> annihilate;
+        Annihilate<G, U> annihilate(opt.threads);
         if (!annihilate.anni(sf)) {
             return -1;
         }
@@ -45,15 +45,51 @@ namespace MTToolBox {
         info.bitSize = bitWidth;
         info.fastMode = false;
         sf.reset_reverse_bit();
-        info.bitMode = 64;
-        info.elementNo = bitWidth / 64;
+        int veq64[64];
+        int veq32[32];
+        if (opt.check) {
+            info.bitMode = 64;
+            info.elementNo = bitWidth / 64;
+            bool same = check_SIMD_all_equidist<U, G>(veq64, 64, sf, info,
+                                                      opt.params.mexp, lsb);
+            info.bitMode = 32;
+            info.elementNo = bitWidth / 32;
+            same = check_SIMD_all_equidist<U, G>(veq32, 32, sf, info,
+                                                 opt.params.mexp, lsb)
+                && same;
+            if (!same) {
+                cout << "k(v) by all v and by each v differ" << endl;
+                return -1;
+            }
+        } else if (opt.work_stealing) {
+            SIMDInfo modes[2] = {info, info};
+            modes[0].bitMode = 64;
+            modes[0].elementNo = bitWidth / 64;
+            modes[1].bitMode = 32;
+            modes[1].elementNo = bitWidth / 32;
+            int * veq[2] = {veq64, veq32};
+            int bit_len[2] = {64, 32};
+            calc_SIMD_scheduled_equidist<U, G>(veq, bit_len, modes, 2, sf,
+                                               opt.params.mexp, opt.threads,
+                                               opt.verbose, lsb);
+        } else {
+            info.bitMode = 64;
+            info.elementNo = bitWidth / 64;
+            calc_SIMD_all_equidist_parallel<U, G>(veq64, 64, sf, info,
+                                                  opt.params.mexp,
+                                                  opt.threads, lsb);
+            info.bitMode = 32;
+            info.elementNo = bitWidth / 32;
+            calc_SIMD_all_equidist_parallel<U, G>(veq32, 32, sf, info,
+                                                  opt.params.mexp,
+                                                  opt.threads, lsb);
+        }
         if (opt.verbose) {
             cout << "64bit dimension of equidistribution at v-bit accuracy k(v)"
                  << lsb_str << endl;
         }
         for (int v = 1; v <= 64; v++) {
-            int veq = calc_SIMD_equidist<U, G>(v, sf, info,
-                                               opt.params.mexp, lsb);
+            int veq = veq64[v - 1];
             int d = opt.params.mexp / v - veq;
             if (opt.verbose) {
                 cout << "k(" << dec << v << ") = " << dec << veq;
@@ -61,15 +97,12 @@ namespace MTToolBox {
             }
             delta64 += d;
         }
-        info.bitMode = 32;
-        info.elementNo = bitWidth / 32;
         if (opt.verbose) {
             cout << "32bit dimension of equidistribution at v-bit accuracy k(v)"
                  << lsb_str << endl;
         }
         for (int v = 1; v <= 32; v++) {
-            int veq = calc_SIMD_equidist<U, G>
-                (v, sf, info, opt.params.mexp, lsb);
+            int veq = veq32[v - 1];
             int d = opt.params.mexp / v - veq;
             if (opt.verbose) {
                 cout << "k(" << dec << v << ") = " << dec << veq;
@@ -0,0 +1,1154 @@
+#pragma once
+#ifndef SIMDKERNEL_HPP
+#define SIMDKERNEL_HPP
+/**
+ * @file SIMDKernel.hpp
+ *
+ * @brief hot kernels of w256_t and w512_t with run time selection
+ *
+ * The recursion step, state addition, bit extraction and leading
+ * one search are collected in function tables. When RUNTIME_DISPATCH
+ * is defined (configure --enable-dispatch), scalar, AVX2 and AVX-512
+ * versions are compiled with target attributes and one table is
+ * selected once, by CPUID or by select_kernel() (--kernel option).
+ * Otherwise the wrapper functions at the end of this file inline the
+ * code selected at compile time in w256.hpp and w512.hpp.
+ */
+#include "devavxprng.h"
+#include "w256.hpp"
+#include "w512.hpp"
+#include <string>
+
+#if defined(RUNTIME_DISPATCH)
+#if HAVE_IMMINTRIN_H
+#include <immintrin.h>
+#else
+#pragma GCC error "do not have immintrin.h"
+#endif
+#endif
+
+namespace MTToolBox {
+    /**
+     * @class simd_kernel
+     * @brief function table of hot operations on U
+     *
+     * @tparam U w256_t or w512_t
+     */
+    template<typename U>
+    struct simd_kernel {
+        const char * name;
+        /**
+         * SFMT recursion.
+         * lung = perm(lung) ^ b ^ (a << sl1),
+         * r = lung ^ ((b & mat1) >> sr1) ^ a
+         */
+        void (*sfmt_recursion)(U *r, const U *a, const U *b, U *lung,
+                               const U& mat1, int sl1, int sr1, int perm);
+        /**
+         * dSFMT recursion.
+         * lung = perm(lung) ^ b ^ (a << sl1),
+         * r = (lung >> sr1) ^ a ^ (lung & msk1)
+         */
+        void (*dsfmt_recursion)(U *r, const U *a, const U *b, U *lung,
+                                const U& msk1, int sl1, int sr1, int perm);
+        /**
+         * dst[(di + i) % size] ^= src[(si + i) % size] for i = 0 to size - 1
+         */
+        void (*add_state)(U *dst, int di, const U *src, int si, int size);
+        /**
+         * upper \b bit_len bits below \b top_bit of each element are
+         * packed into \b next from bit_size - 1 downward.
+         */
+        void (*extract_msb)(U *next, const U& w, int element_no,
+                            int element_bits, int top_bit, int bit_len,
+                            int bit_size);
+        int (*calc_1pos)(const U& x);
+    };
+
+    /*
+     * generic parts, used by every table
+     */
+    template<typename U>
+    inline void add_state_generic(U *dst, int di, const U *src, int si,
+                                  int size)
+    {
+        // two index ranges instead of modulo on every access
+        for (int i = 0; i < size; i++) {
+            dst[di] ^= src[si];
+            di++;
+            si++;
+            if (di == size) {
+                di = 0;
+            }
+            if (si == size) {
+                si = 0;
+            }
+        }
+    }
+
+    template<typename U>
+    inline void extract_msb_generic(U *next, const U& w, int element_no,
+                                    int element_bits, int top_bit,
+                                    int bit_len, int bit_size)
+    {
+        setZero(*next);
+        uint64_t mask = (bit_len >= 64) ? ~UINT64_C(0)
+            : (UINT64_C(1) << bit_len) - 1;
+        int k = bit_size - bit_len;
+        for (int i = 0; i < element_no; i++) {
+            uint64_t e;
+            if (element_bits == 32) {
+                e = w.u[i];
+            } else {
+                e = w.u64[i];
+            }
+            uint64_t bits = (e >> (top_bit + 1 - bit_len)) & mask;
+            int p = k / 64;
+            int r = k % 64;
+            next->u64[p] |= bits << r;
+            if (r + bit_len > 64) {
+                next->u64[p + 1] |= bits >> (64 - r);
+            }
+            k -= bit_len;
+        }
+    }
+
+    /*
+     * scalar kernels
+     */
+    template<typename U>
+    inline void sfmt_recursion_scalar(U *r, const U *a, const U *b, U *lung,
+                                      const U& mat1, int sl1, int sr1,
+                                      int perm)
+    {
+        U x = *a;
+        U l = permutexvar_epi32_scalar(*lung, perm);
+        l = xor_scalar(l, *b);
+        l = xor_scalar(l, SL64_scalar(x, sl1));
+        *lung = l;
+        U t = xor_scalar(l, SR64_scalar(and_scalar(*b, mat1), sr1));
+        *r = xor_scalar(t, x);
+    }
+
+    template<typename U>
+    inline void dsfmt_recursion_scalar(U *r, const U *a, const U *b, U *lung,
+                                       const U& msk1, int sl1, int sr1,
+                                       int perm)
+    {
+        U x = *a;
+        U l = permutexvar_epi32_scalar(*lung, perm);
+        l = xor_scalar(l, *b);
+        l = xor_scalar(l, SL64_scalar(x, sl1));
+        *lung = l;
+        U t = xor_scalar(SR64_scalar(l, sr1), x);
+        *r = xor_scalar(t, and_scalar(l, msk1));
+    }
+
+    template<typename U>
+    inline void add_state_scalar(U *dst, int di, const U *src, int si,
+                                 int size)
+    {
+        for (int i = 0; i < size; i++) {
+            dst[di] = xor_scalar(dst[di], src[si]);
+            di++;
+            si++;
+            if (di == size) {
+                di = 0;
+            }
+            if (si == size) {
+                si = 0;
+            }
+        }
+    }
+
+    template<typename U>
+    inline int calc_1pos_ref(const U& x)
+    {
+        return calc_1pos_scalar(x);
+    }
+
+#if defined(RUNTIME_DISPATCH)
+    enum kernel_type {
+        KERNEL_AUTO = -1,
+        KERNEL_SCALAR = 0,
+        KERNEL_AVX2 = 1,
+        KERNEL_AVX512 = 2
+    };
+
+#if HAVE_AVX2
+    /*
+     * AVX2 kernels
+     */
+#define DEVAVX_AVX2 __attribute__((target("avx2")))
+    DEVAVX_AVX2 static inline __m256i k_load(const uint64_t *p)
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    }
+
+    DEVAVX_AVX2 static inline void k_store(uint64_t *p, __m256i v)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+    }
+
+    DEVAVX_AVX2 static inline __m256i k_perm_idx(int perm)
+    {
+        __m256i idx = _mm256_add_epi32(_mm256_setr_epi32(0, 1, 2, 3,
+                                                         4, 5, 6, 7),
+                                       _mm256_set1_epi32(perm));
+        return _mm256_and_si256(idx, _mm256_set1_epi32(7));
+    }
+
+    DEVAVX_AVX2 static void sfmt_recursion_avx2(w256_t *r, const w256_t *a,
+                                               const w256_t *b,
+                                               w256_t *lung,
+                                               const w256_t& mat1,
+                                               int sl1, int sr1, int perm)
+    {
+        __m256i x = k_load(a->u64);
+        __m256i y = k_load(b->u64);
+        __m256i l = _mm256_permutevar8x32_epi32(k_load(lung->u64),
+                                                k_perm_idx(perm));
+        l = _mm256_xor_si256(l, y);
+        l = _mm256_xor_si256(l, _mm256_sll_epi64(x, _mm_cvtsi32_si128(sl1)));
+        k_store(lung->u64, l);
+        __m256i t = _mm256_and_si256(y, k_load(mat1.u64));
+        t = _mm256_srl_epi64(t, _mm_cvtsi32_si128(sr1));
+        t = _mm256_xor_si256(_mm256_xor_si256(t, l), x);
+        k_store(r->u64, t);
+    }
+
+    DEVAVX_AVX2 static void dsfmt_recursion_avx2(w256_t *r, const w256_t *a,
+                                                const w256_t *b,
+                                                w256_t *lung,
+                                                const w256_t& msk1,
+                                                int sl1, int sr1, int perm)
+    {
+        __m256i x = k_load(a->u64);
+        __m256i l = _mm256_permutevar8x32_epi32(k_load(lung->u64),
+                                                k_perm_idx(perm));
+        l = _mm256_xor_si256(l, k_load(b->u64));
+        l = _mm256_xor_si256(l, _mm256_sll_epi64(x, _mm_cvtsi32_si128(sl1)));
+        k_store(lung->u64, l);
+        __m256i t = _mm256_srl_epi64(l, _mm_cvtsi32_si128(sr1));
+        t = _mm256_xor_si256(t, x);
+        t = _mm256_xor_si256(t, _mm256_and_si256(l, k_load(msk1.u64)));
+        k_store(r->u64, t);
+    }
+
+    DEVAVX_AVX2 static void add_state_avx2(w256_t *dst, int di,
+                                          const w256_t *src, int si,
+                                          int size)
+    {
+        for (int i = 0; i < size; i++) {
+            k_store(dst[di].u64, _mm256_xor_si256(k_load(dst[di].u64),
+                                                  k_load(src[si].u64)));
+            di++;
+            si++;
+            if (di == size) {
+                di = 0;
+            }
+            if (si == size) {
+                si = 0;
+            }
+        }
+    }
+
+    DEVAVX_AVX2 static int calc_1pos_avx2(const w256_t& x)
+    {
+        __m256i z = _mm256_cmpeq_epi64(k_load(x.u64),
+                                       _mm256_setzero_si256());
+        int nz = ~_mm256_movemask_pd(_mm256_castsi256_pd(z)) & 0xf;
+        if (nz == 0) {
+            return -1;
+        }
+        int p = __builtin_ctz(nz);
+        return 255 - __builtin_ctzll(x.u64[p]) - p * 64;
+    }
+
+    /*
+     * w512_t on AVX2 is processed as two 256-bit halves.
+     */
+    DEVAVX_AVX2 static inline void k_perm512(__m256i *lo, __m256i *hi,
+                                             int perm)
+    {
+        __m256i idx = _mm256_add_epi32(_mm256_setr_epi32(0, 1, 2, 3,
+                                                         4, 5, 6, 7),
+                                       _mm256_set1_epi32(perm));
+        __m256i idx_lo = _mm256_and_si256(idx, _mm256_set1_epi32(15));
+        __m256i idx_hi = _mm256_and_si256(
+            _mm256_add_epi32(idx, _mm256_set1_epi32(8)),
+            _mm256_set1_epi32(15));
+        __m256i seven = _mm256_set1_epi32(7);
+        __m256i a = _mm256_permutevar8x32_epi32(*lo, idx_lo);
+        __m256i b = _mm256_permutevar8x32_epi32(*hi, idx_lo);
+        __m256i sel = _mm256_cmpgt_epi32(idx_lo, seven);
+        __m256i c = _mm256_permutevar8x32_epi32(*lo, idx_hi);
+        __m256i d = _mm256_permutevar8x32_epi32(*hi, idx_hi);
+        __m256i sel2 = _mm256_cmpgt_epi32(idx_hi, seven);
+        *lo = _mm256_blendv_epi8(a, b, sel);
+        *hi = _mm256_blendv_epi8(c, d, sel2);
+    }
+
+    DEVAVX_AVX2 static void sfmt_recursion512_avx2(w512_t *r,
+                                                  const w512_t *a,
+                                                  const w512_t *b,
+                                                  w512_t *lung,
+                                                  const w512_t& mat1,
+                                                  int sl1, int sr1, int perm)
+    {
+        __m128i csl = _mm_cvtsi32_si128(sl1);
+        __m128i csr = _mm_cvtsi32_si128(sr1);
+        __m256i l[2] = {k_load(lung->u64), k_load(lung->u64 + 4)};
+        k_perm512(&l[0], &l[1], perm);
+        __m256i t[2];
+        for (int i = 0; i < 2; i++) {
+            __m256i x = k_load(a->u64 + 4 * i);
+            __m256i y = k_load(b->u64 + 4 * i);
+            l[i] = _mm256_xor_si256(l[i], y);
+            l[i] = _mm256_xor_si256(l[i], _mm256_sll_epi64(x, csl));
+            t[i] = _mm256_and_si256(y, k_load(mat1.u64 + 4 * i));
+            t[i] = _mm256_srl_epi64(t[i], csr);
+            t[i] = _mm256_xor_si256(_mm256_xor_si256(t[i], l[i]), x);
+        }
+        for (int i = 0; i < 2; i++) {
+            k_store(lung->u64 + 4 * i, l[i]);
+            k_store(r->u64 + 4 * i, t[i]);
+        }
+    }
+
+    DEVAVX_AVX2 static void dsfmt_recursion512_avx2(w512_t *r,
+                                                   const w512_t *a,
+                                                   const w512_t *b,
+                                                   w512_t *lung,
+                                                   const w512_t& msk1,
+                                                   int sl1, int sr1, int perm)
+    {
+        __m128i csl = _mm_cvtsi32_si128(sl1);
+        __m128i csr = _mm_cvtsi32_si128(sr1);
+        __m256i l[2] = {k_load(lung->u64), k_load(lung->u64 + 4)};
+        k_perm512(&l[0], &l[1], perm);
+        __m256i t[2];
+        for (int i = 0; i < 2; i++) {
+            __m256i x = k_load(a->u64 + 4 * i);
+            l[i] = _mm256_xor_si256(l[i], k_load(b->u64 + 4 * i));
+            l[i] = _mm256_xor_si256(l[i], _mm256_sll_epi64(x, csl));
+            t[i] = _mm256_xor_si256(_mm256_srl_epi64(l[i], csr), x);
+            t[i] = _mm256_xor_si256(t[i], _mm256_and_si256(
+                                        l[i], k_load(msk1.u64 + 4 * i)));
+        }
+        for (int i = 0; i < 2; i++) {
+            k_store(lung->u64 + 4 * i, l[i]);
+            k_store(r->u64 + 4 * i, t[i]);
+        }
+    }
+
+    DEVAVX_AVX2 static void add_state512_avx2(w512_t *dst, int di,
+                                             const w512_t *src, int si,
+                                             int size)
+    {
+        for (int i = 0; i < size; i++) {
+            for (int j = 0; j < 8; j += 4) {
+                k_store(dst[di].u64 + j,
+                        _mm256_xor_si256(k_load(dst[di].u64 + j),
+                                         k_load(src[si].u64 + j)));
+            }
+            di++;
+            si++;
+            if (di == size) {
+                di = 0;
+            }
+            if (si == size) {
+                si = 0;
+            }
+        }
+    }
+
+    DEVAVX_AVX2 static int calc_1pos512_avx2(const w512_t& x)
+    {
+        __m256i zero = _mm256_setzero_si256();
+        __m256i z0 = _mm256_cmpeq_epi64(k_load(x.u64), zero);
+        __m256i z1 = _mm256_cmpeq_epi64(k_load(x.u64 + 4), zero);
+        int nz = _mm256_movemask_pd(_mm256_castsi256_pd(z0))
+            | (_mm256_movemask_pd(_mm256_castsi256_pd(z1)) << 4);
+        nz = ~nz & 0xff;
+        if (nz == 0) {
+            return -1;
+        }
+        int p = __builtin_ctz(nz);
+        return 511 - __builtin_ctzll(x.u64[p]) - p * 64;
+    }
+#undef DEVAVX_AVX2
+#endif // HAVE_AVX2
+
+#if HAVE_AVX512F
+    /*
+     * AVX-512 kernels
+     * 256-bit words use AVX-512VL for vpternlogq and vptestmq, 512-bit
+     * words need AVX-512F only.
+     */
+#define DEVAVX_AVX512 __attribute__((target("avx512f")))
+#define DEVAVX_AVX512VL __attribute__((target("avx512f,avx512vl")))
+    DEVAVX_AVX512 static inline __m512i k_load512(const uint64_t *p)
+    {
+        return _mm512_loadu_si512(p);
+    }
+
+    DEVAVX_AVX512 static inline void k_store512(uint64_t *p, __m512i v)
+    {
+        _mm512_storeu_si512(p, v);
+    }
+
+    DEVAVX_AVX512VL static void sfmt_recursion_avx512(w256_t *r,
+                                                   const w256_t *a,
+                                                   const w256_t *b,
+                                                   w256_t *lung,
+                                                   const w256_t& mat1,
+                                                   int sl1, int sr1,
+                                                   int perm)
+    {
+        const __m256i *pa = reinterpret_cast<const __m256i *>(a->u64);
+        const __m256i *pb = reinterpret_cast<const __m256i *>(b->u64);
+        const __m256i *pm = reinterpret_cast<const __m256i *>(mat1.u64);
+        __m256i *pl = reinterpret_cast<__m256i *>(lung->u64);
+        __m256i x = _mm256_loadu_si256(pa);
+        __m256i y = _mm256_loadu_si256(pb);
+        __m256i idx = _mm256_add_epi32(_mm256_setr_epi32(0, 1, 2, 3,
+                                                         4, 5, 6, 7),
+                                       _mm256_set1_epi32(perm));
+        __m256i l = _mm256_permutexvar_epi32(idx, _mm256_loadu_si256(pl));
+        l = _mm256_ternarylogic_epi64(
+            l, y, _mm256_sll_epi64(x, _mm_cvtsi32_si128(sl1)), 0x96);
+        _mm256_storeu_si256(pl, l);
+        __m256i t = _mm256_and_si256(y, _mm256_loadu_si256(pm));
+        t = _mm256_srl_epi64(t, _mm_cvtsi32_si128(sr1));
+        t = _mm256_ternarylogic_epi64(t, l, x, 0x96);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(r->u64), t);
+    }
+
+    DEVAVX_AVX512VL static void dsfmt_recursion_avx512(w256_t *r,
+                                                    const w256_t *a,
+                                                    const w256_t *b,
+                                                    w256_t *lung,
+                                                    const w256_t& msk1,
+                                                    int sl1, int sr1,
+                                                    int perm)
+    {
+        const __m256i *pa = reinterpret_cast<const __m256i *>(a->u64);
+        const __m256i *pb = reinterpret_cast<const __m256i *>(b->u64);
+        const __m256i *pm = reinterpret_cast<const __m256i *>(msk1.u64);
+        __m256i *pl = reinterpret_cast<__m256i *>(lung->u64);
+        __m256i x = _mm256_loadu_si256(pa);
+        __m256i idx = _mm256_add_epi32(_mm256_setr_epi32(0, 1, 2, 3,
+                                                         4, 5, 6, 7),
+                                       _mm256_set1_epi32(perm));
+        __m256i l = _mm256_permutexvar_epi32(idx, _mm256_loadu_si256(pl));
+        l = _mm256_ternarylogic_epi64(
+            l, _mm256_loadu_si256(pb),
+            _mm256_sll_epi64(x, _mm_cvtsi32_si128(sl1)), 0x96);
+        _mm256_storeu_si256(pl, l);
+        __m256i t = _mm256_srl_epi64(l, _mm_cvtsi32_si128(sr1));
+        t = _mm256_xor_si256(t, x);
+        t = _mm256_ternarylogic_epi64(t, l, _mm256_loadu_si256(pm), 0x78);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(r->u64), t);
+    }
+
+    DEVAVX_AVX512VL static void add_state_avx512(w256_t *dst, int di,
+                                                const w256_t *src, int si,
+                                                int size)
+    {
+        for (int i = 0; i < size; i++) {
+            __m256i *pd = reinterpret_cast<__m256i *>(dst[di].u64);
+            const __m256i *ps
+                = reinterpret_cast<const __m256i *>(src[si].u64);
+            _mm256_storeu_si256(pd, _mm256_xor_si256(_mm256_loadu_si256(pd),
+                                                     _mm256_loadu_si256(ps)));
+            di++;
+            si++;
+            if (di == size) {
+                di = 0;
+            }
+            if (si == size) {
+                si = 0;
+            }
+        }
+    }
+
+    DEVAVX_AVX512VL static int calc_1pos_avx512(const w256_t& x)
+    {
+        __m256i v = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(x.u64));
+        int nz = _mm256_test_epi64_mask(v, v);
+        if (nz == 0) {
+            return -1;
+        }
+        int p = __builtin_ctz(nz);
+        return 255 - __builtin_ctzll(x.u64[p]) - p * 64;
+    }
+
+    DEVAVX_AVX512 static void sfmt_recursion512_avx512(w512_t *r,
+                                                      const w512_t *a,
+                                                      const w512_t *b,
+                                                      w512_t *lung,
+                                                      const w512_t& mat1,
+                                                      int sl1, int sr1,
+                                                      int perm)
+    {
+        __m512i x = k_load512(a->u64);
+        __m512i y = k_load512(b->u64);
+        __m512i idx = _mm512_add_epi32(_mm512_setr_epi32(0, 1, 2, 3,
+                                                         4, 5, 6, 7,
+                                                         8, 9, 10, 11,
+                                                         12, 13, 14, 15),
+                                       _mm512_set1_epi32(perm));
+        __m512i l = _mm512_permutexvar_epi32(idx, k_load512(lung->u64));
+        l = _mm512_ternarylogic_epi64(
+            l, y, _mm512_sll_epi64(x, _mm_cvtsi32_si128(sl1)), 0x96);
+        k_store512(lung->u64, l);
+        __m512i t = _mm512_and_si512(y, k_load512(mat1.u64));
+        t = _mm512_srl_epi64(t, _mm_cvtsi32_si128(sr1));
+        k_store512(r->u64, _mm512_ternarylogic_epi64(t, l, x, 0x96));
+    }
+
+    DEVAVX_AVX512 static void dsfmt_recursion512_avx512(w512_t *r,
+                                                       const w512_t *a,
+                                                       const w512_t *b,
+                                                       w512_t *lung,
+                                                       const w512_t& msk1,
+                                                       int sl1, int sr1,
+                                                       int perm)
+    {
+        __m512i x = k_load512(a->u64);
+        __m512i idx = _mm512_add_epi32(_mm512_setr_epi32(0, 1, 2, 3,
+                                                         4, 5, 6, 7,
+                                                         8, 9, 10, 11,
+                                                         12, 13, 14, 15),
+                                       _mm512_set1_epi32(perm));
+        __m512i l = _mm512_permutexvar_epi32(idx, k_load512(lung->u64));
+        l = _mm512_ternarylogic_epi64(
+            l, k_load512(b->u64),
+            _mm512_sll_epi64(x, _mm_cvtsi32_si128(sl1)), 0x96);
+        k_store512(lung->u64, l);
+        __m512i t = _mm512_srl_epi64(l, _mm_cvtsi32_si128(sr1));
+        t = _mm512_xor_si512(t, x);
+        k_store512(r->u64, _mm512_ternarylogic_epi64(t, l,
+                                                     k_load512(msk1.u64),
+                                                     0x78));
+    }
+
+    DEVAVX_AVX512 static void add_state512_avx512(w512_t *dst, int di,
+                                                 const w512_t *src, int si,
+                                                 int size)
+    {
+        for (int i = 0; i < size; i++) {
+            k_store512(dst[di].u64, _mm512_xor_si512(k_load512(dst[di].u64),
+                                                     k_load512(src[si].u64)));
+            di++;
+            si++;
+            if (di == size) {
+                di = 0;
+            }
+            if (si == size) {
+                si = 0;
+            }
+        }
+    }
+
+    DEVAVX_AVX512 static int calc_1pos512_avx512(const w512_t& x)
+    {
+        __m512i v = k_load512(x.u64);
+        int nz = _mm512_test_epi64_mask(v, v);
+        if (nz == 0) {
+            return -1;
+        }
+        int p = __builtin_ctz(nz);
+        return 511 - __builtin_ctzll(x.u64[p]) - p * 64;
+    }
+#undef DEVAVX_AVX512VL
+#undef DEVAVX_AVX512
+#endif // HAVE_AVX512F
+
+    /**
+     * requested kernel, KERNEL_AUTO means CPUID.
+     */
+    inline int& kernel_request()
+    {
+        static int request = KERNEL_AUTO;
+        return request;
+    }
+
+    /**
+     * @tparam U w256_t or w512_t
+     * @param type kernel type
+     * @return true if this binary has the kernel and the CPU can run it
+     */
+    template<typename U>
+    inline bool kernel_supported(int type)
+    {
+        switch (type) {
+        case KERNEL_SCALAR:
+            return true;
+#if HAVE_AVX2 && HAVE_BUILTIN_CPU_SUPPORTS
+        case KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+#if HAVE_AVX512F && HAVE_BUILTIN_CPU_SUPPORTS
+        case KERNEL_AVX512:
+            if (sizeof(U) == sizeof(w512_t)) {
+                return __builtin_cpu_supports("avx512f");
+            }
+            return __builtin_cpu_supports("avx512f")
+                && __builtin_cpu_supports("avx512vl");
+#endif
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * If the requested kernel can't run on U, for example avx512 for
+     * w256_t on a CPU without AVX-512VL, the best kernel below it is
+     * used. kernel_name() tells which one.
+     * @tparam U w256_t or w512_t
+     * @return requested kernel, or the best kernel the CPU can run
+     */
+    template<typename U>
+    inline int choose_kernel()
+    {
+        int type = kernel_request();
+        if (type == KERNEL_AUTO) {
+            type = KERNEL_AVX512;
+        }
+        while (!kernel_supported<U>(type)) {
+            type--;
+        }
+        return type;
+    }
+
+    /**
+     * kernel used by this process for U, fixed at the first call.
+     * The static is initialized once even if threads call this at
+     * the same time.
+     */
+    template<typename U>
+    inline int current_kernel()
+    {
+        static const int type = choose_kernel<U>();
+        return type;
+    }
+
+    /**
+     * select kernel by name. Call this before the first use of
+     * generators.
+     * @param name one of auto, scalar, avx2, avx512
+     * @return false if unknown name or the CPU can't run it for any
+     * word type
+     */
+    inline bool select_kernel(const std::string& name)
+    {
+        int type;
+        if (name == "auto") {
+            type = KERNEL_AUTO;
+        } else if (name == "scalar") {
+            type = KERNEL_SCALAR;
+        } else if (name == "avx2") {
+            type = KERNEL_AVX2;
+        } else if (name == "avx512") {
+            type = KERNEL_AVX512;
+        } else {
+            return false;
+        }
+        if (type != KERNEL_AUTO && !kernel_supported<w256_t>(type)
+            && !kernel_supported<w512_t>(type)) {
+            return false;
+        }
+        kernel_request() = type;
+        return true;
+    }
+
+    template<typename U>
+    const simd_kernel<U>& kernel_table(int type);
+
+    template<>
+    inline const simd_kernel<w256_t>& kernel_table(int type)
+    {
+        static const simd_kernel<w256_t> scalar = {
+            "scalar",
+            sfmt_recursion_scalar<w256_t>,
+            dsfmt_recursion_scalar<w256_t>,
+            add_state_scalar<w256_t>,
+            extract_msb_generic<w256_t>,
+            calc_1pos_ref<w256_t>
+        };
+#if HAVE_AVX2
+        static const simd_kernel<w256_t> avx2 = {
+            "avx2",
+            sfmt_recursion_avx2,
+            dsfmt_recursion_avx2,
+            add_state_avx2,
+            extract_msb_generic<w256_t>,
+            calc_1pos_avx2
+        };
+#endif
+#if HAVE_AVX512F
+        static const simd_kernel<w256_t> avx512 = {
+            "avx512",
+            sfmt_recursion_avx512,
+            dsfmt_recursion_avx512,
+            add_state_avx512,
+            extract_msb_generic<w256_t>,
+            calc_1pos_avx512
+        };
+#endif
+        switch (type) {
+#if HAVE_AVX512F
+        case KERNEL_AVX512:
+            return avx512;
+#endif
+#if HAVE_AVX2
+        case KERNEL_AVX2:
+            return avx2;
+#endif
+        default:
+            return scalar;
+        }
+    }
+
+    template<>
+    inline const simd_kernel<w512_t>& kernel_table(int type)
+    {
+        static const simd_kernel<w512_t> scalar = {
+            "scalar",
+            sfmt_recursion_scalar<w512_t>,
+            dsfmt_recursion_scalar<w512_t>,
+            add_state_scalar<w512_t>,
+            extract_msb_generic<w512_t>,
+            calc_1pos_ref<w512_t>
+        };
+#if HAVE_AVX2
+        static const simd_kernel<w512_t> avx2 = {
+            "avx2",
+            sfmt_recursion512_avx2,
+            dsfmt_recursion512_avx2,
+            add_state512_avx2,
+            extract_msb_generic<w512_t>,
+            calc_1pos512_avx2
+        };
+#endif
+#if HAVE_AVX512F
+        static const simd_kernel<w512_t> avx512 = {
+            "avx512",
+            sfmt_recursion512_avx512,
+            dsfmt_recursion512_avx512,
+            add_state512_avx512,
+            extract_msb_generic<w512_t>,
+            calc_1pos512_avx512
+        };
+#endif
+        switch (type) {
+#if HAVE_AVX512F
+        case KERNEL_AVX512:
+            return avx512;
+#endif
+#if HAVE_AVX2
+        case KERNEL_AVX2:
+            return avx2;
+#endif
+        default:
+            return scalar;
+        }
+    }
+
+    /**
+     * @return kernel table selected for this process
+     */
+    template<typename U>
+    inline const simd_kernel<U>& get_kernel()
+    {
+        static const simd_kernel<U>& kernel = kernel_table<U>(current_kernel<U>());
+        return kernel;
+    }
+
+    /**
+     * Compare all kernels the CPU can run with the scalar kernel
+     * using random inputs.
+     * @param seed seed of xorshift used to make inputs
+     * @param count number of random inputs
+     * @return true if all results are bit-identical
+     */
+    template<typename U>
+    bool check_kernel_table(uint64_t seed, int count)
+    {
+        const int words = sizeof(U) / 8;
+        const int size = 5;
+        const simd_kernel<U>& ref = kernel_table<U>(KERNEL_SCALAR);
+        uint64_t s = seed * 2 + 1;
+        for (int type = KERNEL_AVX2; type <= KERNEL_AVX512; type++) {
+            if (!kernel_supported<U>(type)) {
+                continue;
+            }
+            const simd_kernel<U>& k = kernel_table<U>(type);
+            for (int c = 0; c < count; c++) {
+                U v[4 + 2 * size];
+                for (int i = 0; i < 4 + 2 * size; i++) {
+                    for (int j = 0; j < words; j++) {
+                        s ^= s << 13; s ^= s >> 7; s ^= s << 17;
+                        v[i].u64[j] = s;
+                    }
+                }
+                int sl = c % 63 + 1;
+                int sr = (c * 7) % 63 + 1;
+                int perm = c % (words * 2);
+                U r1, r2;
+                U l1 = v[2];
+                U l2 = v[2];
+                bool ok = true;
+                ref.sfmt_recursion(&r1, &v[0], &v[1], &l1, v[3],
+                                   sl, sr, perm);
+                k.sfmt_recursion(&r2, &v[0], &v[1], &l2, v[3],
+                                 sl, sr, perm);
+                ok = ok && r1 == r2 && l1 == l2;
+                l1 = v[2];
+                l2 = v[2];
+                ref.dsfmt_recursion(&r1, &v[0], &v[1], &l1, v[3],
+                                    sl, 12, perm);
+                k.dsfmt_recursion(&r2, &v[0], &v[1], &l2, v[3],
+                                  sl, 12, perm);
+                ok = ok && r1 == r2 && l1 == l2;
+                U d1[size];
+                U d2[size];
+                for (int i = 0; i < size; i++) {
+                    d1[i] = v[4 + i];
+                    d2[i] = v[4 + i];
+                }
+                ref.add_state(d1, c % size, &v[4 + size], (c / 2) % size,
+                              size);
+                k.add_state(d2, c % size, &v[4 + size], (c / 2) % size,
+                            size);
+                for (int i = 0; i < size; i++) {
+                    ok = ok && d1[i] == d2[i];
+                }
+                U x = v[0];
+                if (c % 3 == 1) {
+                    for (int j = 0; j < words - 1; j++) {
+                        x.u64[j] = 0;
+                    }
+                } else if (c % 3 == 2) {
+                    setZero(x);
+                }
+                ok = ok && ref.calc_1pos(x) == k.calc_1pos(x);
+                if (!ok) {
+                    std::cerr << "kernel " << k.name << " mismatch at "
+                              << std::dec << c << std::endl;
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+#endif // RUNTIME_DISPATCH
+
+    /*
+     * Wrappers used by generators and PIS.
+     */
+    inline void sfmt_recursion(w256_t *r, const w256_t *a, const w256_t *b,
+                               w256_t *lung, const w256_t& mat1,
+                               int sl1, int sr1, int perm)
+    {
+#if defined(RUNTIME_DISPATCH)
+        get_kernel<w256_t>().sfmt_recursion(r, a, b, lung, mat1,
+                                            sl1, sr1, perm);
+#else
+        w256_t x = *a;
+        *lung = permutexvar_epi32(*lung, perm);
+        *lung ^= *b;
+        *lung ^= SL64(x, sl1);
+        w256_t t;
+        t = *lung;
+        t ^= SR64(*b & mat1, sr1);
+        t ^= x;
+        *r = t;
+#endif
+    }
+
+    inline void dsfmt_recursion(w256_t *r, const w256_t *a, const w256_t *b,
+                                w256_t *lung, const w256_t& msk1,
+                                int sl1, int sr1, int perm)
+    {
+#if defined(RUNTIME_DISPATCH)
+        get_kernel<w256_t>().dsfmt_recursion(r, a, b, lung, msk1,
+                                             sl1, sr1, perm);
+#else
+        w256_t x = *a;
+        *lung = permutexvar_epi32(*lung, perm);
+        *lung ^= *b;
+        *lung ^= SL64(x, sl1);
+        w256_t t;
+        t = SR64(*lung, sr1);
+        t ^= x;
+        t ^= *lung & msk1;
+        *r = t;
+#endif
+    }
+
+    inline void sfmt_recursion(w512_t *r, const w512_t *a, const w512_t *b,
+                               w512_t *lung, const w512_t& mat1,
+                               int sl1, int sr1, int perm)
+    {
+#if defined(RUNTIME_DISPATCH)
+        get_kernel<w512_t>().sfmt_recursion(r, a, b, lung, mat1,
+                                            sl1, sr1, perm);
+#else
+        w512_t x = *a;
+        *lung = xor3(permutexvar_epi32(*lung, perm), *b, SL64(x, sl1));
+        *r = xor3(*lung, SR64(*b & mat1, sr1), x);
+#endif
+    }
+
+    inline void dsfmt_recursion(w512_t *r, const w512_t *a, const w512_t *b,
+                                w512_t *lung, const w512_t& msk1,
+                                int sl1, int sr1, int perm)
+    {
+#if defined(RUNTIME_DISPATCH)
+        get_kernel<w512_t>().dsfmt_recursion(r, a, b, lung, msk1,
+                                             sl1, sr1, perm);
+#else
+        w512_t x = *a;
+        *lung = xor3(permutexvar_epi32(*lung, perm), *b, SL64(x, sl1));
+        w512_t t = SR64(*lung, sr1);
+        t ^= x;
+        *r = xor_and(t, *lung, msk1);
+#endif
+    }
+
+    /*
+     * Recursion with shift and permutation parameters fixed at compile
+     * time. Shifts become immediate operands and the permutation index
+     * a constant. Generators use these when all of sl1, sr1 and perm
+     * are template arguments.
+     */
+    template<int SL1, int SR1, int PERM>
+    inline void sfmt_recursion_fixed(w256_t *r, const w256_t *a,
+                                     const w256_t *b, w256_t *lung,
+                                     const w256_t& mat1)
+    {
+#if W256_USE_AVX2
+        __m256i x = load256(*a);
+        __m256i y = load256(*b);
+        __m256i idx = _mm256_setr_epi32(PERM & 7, (1 + PERM) & 7,
+                                        (2 + PERM) & 7, (3 + PERM) & 7,
+                                        (4 + PERM) & 7, (5 + PERM) & 7,
+                                        (6 + PERM) & 7, (7 + PERM) & 7);
+        __m256i l = _mm256_permutevar8x32_epi32(load256(*lung), idx);
+        l = _mm256_xor_si256(l, y);
+        l = _mm256_xor_si256(l, _mm256_slli_epi64(x, SL1));
+        *lung = store256(l);
+        __m256i t = _mm256_srli_epi64(_mm256_and_si256(y, load256(mat1)),
+                                      SR1);
+        *r = store256(_mm256_xor_si256(_mm256_xor_si256(t, l), x));
+#else
+        sfmt_recursion(r, a, b, lung, mat1, SL1, SR1, PERM);
+#endif
+    }
+
+    template<int SL1, int SR1, int PERM>
+    inline void dsfmt_recursion_fixed(w256_t *r, const w256_t *a,
+                                      const w256_t *b, w256_t *lung,
+                                      const w256_t& msk1)
+    {
+#if W256_USE_AVX2
+        __m256i x = load256(*a);
+        __m256i idx = _mm256_setr_epi32(PERM & 7, (1 + PERM) & 7,
+                                        (2 + PERM) & 7, (3 + PERM) & 7,
+                                        (4 + PERM) & 7, (5 + PERM) & 7,
+                                        (6 + PERM) & 7, (7 + PERM) & 7);
+        __m256i l = _mm256_permutevar8x32_epi32(load256(*lung), idx);
+        l = _mm256_xor_si256(l, load256(*b));
+        l = _mm256_xor_si256(l, _mm256_slli_epi64(x, SL1));
+        *lung = store256(l);
+        __m256i t = _mm256_xor_si256(_mm256_srli_epi64(l, SR1), x);
+        t = _mm256_xor_si256(t, _mm256_and_si256(l, load256(msk1)));
+        *r = store256(t);
+#else
+        dsfmt_recursion(r, a, b, lung, msk1, SL1, SR1, PERM);
+#endif
+    }
+
+#if W512_USE_AVX512F
+    template<int PERM>
+    inline __m512i perm_index512()
+    {
+        return _mm512_setr_epi32(PERM & 15, (1 + PERM) & 15,
+                                 (2 + PERM) & 15, (3 + PERM) & 15,
+                                 (4 + PERM) & 15, (5 + PERM) & 15,
+                                 (6 + PERM) & 15, (7 + PERM) & 15,
+                                 (8 + PERM) & 15, (9 + PERM) & 15,
+                                 (10 + PERM) & 15, (11 + PERM) & 15,
+                                 (12 + PERM) & 15, (13 + PERM) & 15,
+                                 (14 + PERM) & 15, (15 + PERM) & 15);
+    }
+#endif
+
+    template<int SL1, int SR1, int PERM>
+    inline void sfmt_recursion_fixed(w512_t *r, const w512_t *a,
+                                     const w512_t *b, w512_t *lung,
+                                     const w512_t& mat1)
+    {
+#if W512_USE_AVX512F
+        __m512i x = load512(*a);
+        __m512i y = load512(*b);
+        __m512i l = _mm512_permutexvar_epi32(perm_index512<PERM>(),
+                                             load512(*lung));
+        l = _mm512_ternarylogic_epi64(l, y, _mm512_slli_epi64(x, SL1), 0x96);
+        *lung = store512(l);
+        __m512i t = _mm512_srli_epi64(_mm512_and_si512(y, load512(mat1)),
+                                      SR1);
+        *r = store512(_mm512_ternarylogic_epi64(t, l, x, 0x96));
+#else
+        sfmt_recursion(r, a, b, lung, mat1, SL1, SR1, PERM);
+#endif
+    }
+
+    template<int SL1, int SR1, int PERM>
+    inline void dsfmt_recursion_fixed(w512_t *r, const w512_t *a,
+                                      const w512_t *b, w512_t *lung,
+                                      const w512_t& msk1)
+    {
+#if W512_USE_AVX512F
+        __m512i x = load512(*a);
+        __m512i l = _mm512_permutexvar_epi32(perm_index512<PERM>(),
+                                             load512(*lung));
+        l = _mm512_ternarylogic_epi64(l, load512(*b),
+                                      _mm512_slli_epi64(x, SL1), 0x96);
+        *lung = store512(l);
+        __m512i t = _mm512_xor_si512(_mm512_srli_epi64(l, SR1), x);
+        *r = store512(_mm512_ternarylogic_epi64(t, l, load512(msk1), 0x78));
+#else
+        dsfmt_recursion(r, a, b, lung, msk1, SL1, SR1, PERM);
+#endif
+    }
+
+    /*
+     * Store of outputs to caller's buffers. Non temporal store is used
+     * when the destination is aligned to the vector size, so that large
+     * buffers do not evict the state from cache. stream_fence() must
+     * follow a sequence of stream_store().
+     */
+    inline void stream_store(w256_t *p, const w256_t& x)
+    {
+#if W256_USE_AVX2
+        if ((reinterpret_cast<uintptr_t>(p) & 31) == 0) {
+            _mm256_stream_si256(reinterpret_cast<__m256i *>(p->u64),
+                                load256(x));
+            return;
+        }
+#endif
+        *p = x;
+    }
+
+    inline void stream_store(w512_t *p, const w512_t& x)
+    {
+#if W512_USE_AVX512F
+        if ((reinterpret_cast<uintptr_t>(p) & 63) == 0) {
+            _mm512_stream_si512(reinterpret_cast<__m512i *>(p->u64),
+                                load512(x));
+            return;
+        }
+#endif
+        *p = x;
+    }
+
+    inline void stream_fence()
+    {
+#if W256_USE_AVX2 || W512_USE_AVX512F
+        _mm_sfence();
+#endif
+    }
+
+    template<typename U>
+    inline void add_state(U *dst, int di, const U *src, int si, int size)
+    {
+#if defined(RUNTIME_DISPATCH)
+        get_kernel<U>().add_state(dst, di, src, si, size);
+#else
+        add_state_generic(dst, di, src, si, size);
+#endif
+    }
+
+    template<typename U>
+    inline void extract_msb(U *next, const U& w, int element_no,
+                            int element_bits, int top_bit, int bit_len,
+                            int bit_size)
+    {
+#if defined(RUNTIME_DISPATCH)
+        get_kernel<U>().extract_msb(next, w, element_no, element_bits,
+                                    top_bit, bit_len, bit_size);
+#else
+        extract_msb_generic(next, w, element_no, element_bits, top_bit,
+                            bit_len, bit_size);
+#endif
+    }
+
+    /**
+     * change \b next packed by extract_msb() with \b bit_len bits of
+     * each element into that with bit_len - 1 bits, dropping the lowest
+     * bit of each element.
+     */
+    template<typename U>
+    inline void shrink_msb(U *next, int element_no, int bit_len,
+                           int bit_size)
+    {
+        U src = *next;
+        setZero(*next);
+        uint64_t mask = (bit_len >= 64) ? ~UINT64_C(0)
+            : (UINT64_C(1) << bit_len) - 1;
+        int k = bit_size - bit_len;
+        int n = bit_size - (bit_len - 1);
+        for (int i = 0; i < element_no; i++) {
+            int p = k / 64;
+            int r = k % 64;
+            uint64_t bits = src.u64[p] >> r;
+            if (r + bit_len > 64) {
+                bits |= src.u64[p + 1] << (64 - r);
+            }
+            bits = (bits & mask) >> 1;
+            p = n / 64;
+            r = n % 64;
+            next->u64[p] |= bits << r;
+            if (r + bit_len - 1 > 64) {
+                next->u64[p + 1] |= bits >> (64 - r);
+            }
+            k -= bit_len;
+            n -= bit_len - 1;
+        }
+    }
+
+    template<typename U>
+    inline int leading_one(const U& x)
+    {
+#if defined(RUNTIME_DISPATCH)
+        return get_kernel<U>().calc_1pos(x);
+#else
+        return calc_1pos(x);
+#endif
+    }
+
+    /**
+     * @tparam U w256_t or w512_t
+     * @return name of kernel used in this process for U
+     */
+    template<typename U>
+    inline const char * kernel_name()
+    {
+#if defined(RUNTIME_DISPATCH)
+        return get_kernel<U>().name;
+#else
+        if (sizeof(U) == sizeof(w512_t)) {
+            return W512_USE_AVX512F ? "avx512 (compile time)"
+                : "scalar (compile time)";
+        }
+        return W256_USE_AVX2 ? "avx2 (compile time)"
+            : "scalar (compile time)";
+#endif
+    }
+}
+#endif // SIMDKERNEL_HPP
@@ -0,0 +1,336 @@
+#pragma once
+#ifndef SEARCHPIPELINE_HPP
+#define SEARCHPIPELINE_HPP
+/**
+ * @file SearchPipeline.hpp
+ *
+ * @brief search of parameter sets by a pipeline of stages
+ *
+ * A candidate goes through three stages, reducible recursion search,
+ * preparation (fix point, parity check vector and annihilation) and
+ * equidistribution, whose costs are very different. Each stage has its
+ * own pool of worker threads, and stages are connected by bounded
+ * queues, so candidates pile up ahead of the expensive stage and the
+ * threads of cheap stages wait only when the queue is full. Waiting
+ * threads sleep on condition variables, so idle pools of a busy
+ * pipeline do not take cores from the other stages.
+ *
+ * Depth of each queue is sampled when a worker of the next stage takes
+ * a candidate, and can be printed after the run to size the pools.
+ */
+#include "devavxprng.h"
+#include <MTToolBox/AlgorithmReducibleRecursionSearch.hpp>
+#include <NTL/GF2X.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <ostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace MTToolBox {
+    /**
+     * @class search_candidate
+     * @brief generator found by the first stage and its irreducible
+     * factor
+     */
+    template<typename G>
+    struct search_candidate {
+        search_candidate(const G& g, const NTL::GF2X& irreducible)
+            : g(g), irreducible(irreducible) {
+        }
+        G g;
+        NTL::GF2X irreducible;
+    };
+
+    /**
+     * @class CandidateSearch
+     * @brief state of one worker of the first stage
+     * @tparam R MersenneTwister or MersenneTwister64
+     */
+    template<typename U, typename G, typename R>
+    class CandidateSearch {
+    public:
+        /**
+         * @param g generator whose fixed parameters are set
+         * @param seed seed of this worker
+         * @param mexp Mersenne exponent
+         * @param tries argument of AlgorithmReducibleRecursionSearch::start
+         */
+        CandidateSearch(const G& g, uint64_t seed, int mexp, int tries)
+            : mt(seed), g(g), ars(this->g, mt), mexp(mexp), tries(tries) {
+        }
+
+        /**
+         * @return new candidate, NULL if the search failed
+         */
+        search_candidate<G> * next() {
+            if (!ars.start(tries)) {
+                return NULL;
+            }
+            NTL::GF2X irreducible = ars.getIrreducibleFactor();
+            if (NTL::deg(irreducible) != mexp) {
+                return NULL;
+            }
+            return new search_candidate<G>(g, irreducible);
+        }
+    private:
+        R mt;
+        G g;
+        AlgorithmReducibleRecursionSearch<U> ars;
+        int mexp;
+        int tries;
+
+        CandidateSearch(const CandidateSearch&);
+        CandidateSearch& operator=(const CandidateSearch&);
+    };
+
+    /**
+     * @class PipelineQueue
+     * @brief bounded queue between stages with depth statistics
+     * @tparam T element, owned by the queue while it is in the queue
+     */
+    template<typename T>
+    class PipelineQueue {
+    public:
+        PipelineQueue(const std::string& name, size_t capacity)
+            : name(name), capacity(capacity), max_depth(0),
+              depth_sum(0), samples(0), producers(0) {
+        }
+
+        ~PipelineQueue() {
+            for (size_t i = 0; i < queue.size(); i++) {
+                delete queue[i];
+            }
+        }
+
+        /**
+         * push \b p, sleeping while the queue is full
+         * @return false if \b stop is set, \b p is deleted then
+         */
+        bool push(T * p, const std::atomic<bool>& stop) {
+            std::unique_lock<std::mutex> lock(mutex);
+            not_full.wait(lock, [this, &stop]() {
+                    return stop || queue.size() < capacity;
+                });
+            if (stop) {
+                delete p;
+                return false;
+            }
+            queue.push_back(p);
+            not_empty.notify_one();
+            return true;
+        }
+
+        /**
+         * pop an element, sleeping while the queue is empty and some
+         * producers are running.
+         * @return NULL if \b stop is set or all producers have ended
+         */
+        T * pop(const std::atomic<bool>& stop) {
+            std::unique_lock<std::mutex> lock(mutex);
+            not_empty.wait(lock, [this, &stop]() {
+                    return stop || !queue.empty() || producers == 0;
+                });
+            if (stop || queue.empty()) {
+                return NULL;
+            }
+            sample(queue.size());
+            T * p = queue.front();
+            queue.pop_front();
+            not_full.notify_one();
+            return p;
+        }
+
+        void add_producers(int n) {
+            std::lock_guard<std::mutex> lock(mutex);
+            producers += n;
+        }
+
+        void producer_end() {
+            std::lock_guard<std::mutex> lock(mutex);
+            producers--;
+            if (producers == 0) {
+                not_empty.notify_all();
+            }
+        }
+
+        /**
+         * wake all threads waiting on this queue, called after \b stop
+         * is set.
+         */
+        void wake() {
+            // taking the lock makes sure that a thread which has seen
+            // stop unset is already waiting
+            std::lock_guard<std::mutex> lock(mutex);
+            not_full.notify_all();
+            not_empty.notify_all();
+        }
+
+        void print_depth(std::ostream& os) const {
+            using namespace std;
+            lock_guard<std::mutex> lock(mutex);
+            os << "queue " << name << ": max depth = " << dec << max_depth
+               << ", mean depth = ";
+            if (samples == 0) {
+                os << 0;
+            } else {
+                os << static_cast<double>(depth_sum) / samples;
+            }
+            os << endl;
+        }
+    private:
+        std::string name;
+        size_t capacity;
+        std::deque<T *> queue;
+        mutable std::mutex mutex;
+        std::condition_variable not_full;
+        std::condition_variable not_empty;
+        long max_depth;
+        long depth_sum;
+        long samples;
+        int producers;
+
+        void sample(long d) {
+            depth_sum += d;
+            samples++;
+            if (d > max_depth) {
+                max_depth = d;
+            }
+        }
+    };
+
+    /**
+     * @class SearchPipeline
+     * @brief three stages of search and one writer
+     * @tparam C candidate, a generator and its irreducible factor
+     */
+    template<typename C>
+    class SearchPipeline {
+    public:
+        /**
+         * @param workers number of threads of search, preparation and
+         * equidistribution stages
+         */
+        explicit SearchPipeline(const int workers[3])
+            : found("search-prepare", 64),
+              prepared("prepare-equidistribution", 64),
+              lines("equidistribution-writer", 64),
+              stop(false) {
+            for (int i = 0; i < 3; i++) {
+                this->workers[i] = workers[i];
+            }
+        }
+
+        /**
+         * run the pipeline until \b count lines are written.
+         * - search(w) returns a new candidate found by worker \b w of
+         *   the first stage, or NULL on failure.
+         * - prepare(c) returns false on failure.
+         * - equidistribution(c) returns a line of output, empty if the
+         *   candidate is discarded.
+         * @param count number of lines to be written
+         * @param os output stream
+         * @return number of lines written, less than \b count on failure
+         */
+        template<typename S, typename P, typename E>
+        long run(long count, S& search, P& prepare, E& equidistribution,
+                 std::ostream& os) {
+            using namespace std;
+            vector<thread> pool;
+            found.add_producers(workers[0]);
+            prepared.add_producers(workers[1]);
+            lines.add_producers(workers[2]);
+            for (int w = 0; w < workers[0]; w++) {
+                pool.push_back(thread([this, w, &search]() {
+                            while (!stop) {
+                                C * c = search(w);
+                                if (c == NULL) {
+                                    halt();
+                                    break;
+                                }
+                                if (!found.push(c, stop)) {
+                                    break;
+                                }
+                            }
+                            found.producer_end();
+                        }));
+            }
+            for (int w = 0; w < workers[1]; w++) {
+                pool.push_back(thread([this, &prepare]() {
+                            C * c;
+                            while ((c = found.pop(stop)) != NULL) {
+                                if (!prepare(*c)) {
+                                    delete c;
+                                    halt();
+                                    break;
+                                }
+                                if (!prepared.push(c, stop)) {
+                                    break;
+                                }
+                            }
+                            prepared.producer_end();
+                        }));
+            }
+            for (int w = 0; w < workers[2]; w++) {
+                pool.push_back(thread([this, &equidistribution]() {
+                            C * c;
+                            while ((c = prepared.pop(stop)) != NULL) {
+                                string * line
+                                    = new string(equidistribution(*c));
+                                delete c;
+                                if (line->empty()) {
+                                    delete line;
+                                    continue;
+                                }
+                                if (!lines.push(line, stop)) {
+                                    break;
+                                }
+                            }
+                            lines.producer_end();
+                        }));
+            }
+            long written = 0;
+            string * line;
+            while (written < count && (line = lines.pop(stop)) != NULL) {
+                os << *line << endl;
+                delete line;
+                written++;
+            }
+            halt();
+            for (size_t i = 0; i < pool.size(); i++) {
+                pool[i].join();
+            }
+            return written;
+        }
+
+        /**
+         * print depth statistics of all queues
+         * @param os output stream
+         */
+        void print_depth(std::ostream& os) const {
+            found.print_depth(os);
+            prepared.print_depth(os);
+            lines.print_depth(os);
+        }
+    private:
+        int workers[3];
+        PipelineQueue<C> found;
+        PipelineQueue<C> prepared;
+        PipelineQueue<std::string> lines;
+        std::atomic<bool> stop;
+
+        /**
+         * stop all stages and wake threads waiting on the queues
+         */
+        void halt() {
+            stop = true;
+            found.wake();
+            prepared.wake();
+            lines.wake();
+        }
+    };
+}
+#endif // SEARCHPIPELINE_HPP
@@ -0,0 +1,126 @@
+#pragma once
+#ifndef STATEARRAY_HPP
+#define STATEARRAY_HPP
+/**
+ * @file StateArray.hpp
+ *
+ * @brief internal state storage of generators
+ *
+ * Generators templated on mexp keep their state inline, and the number
+ * of elements is a compile time constant. Generators with mexp given at
+ * run time keep it on heap.
+ */
+#include "devavxprng.h"
+#include <stdexcept>
+
+namespace MTToolBox {
+    /**
+     * @class state_array
+     * @brief fixed size array of N elements kept inline
+     *
+     * @tparam U element type
+     * @tparam N number of elements, 0 means run time size
+     */
+    template<typename U, int N>
+    class state_array {
+    public:
+        explicit state_array(int n) {
+            if (n != N) {
+                throw new std::logic_error("state size mismatch");
+            }
+        }
+
+        int size() const {
+            return N;
+        }
+
+        U& operator[](int i) {
+            return data_[i];
+        }
+
+        const U& operator[](int i) const {
+            return data_[i];
+        }
+
+        U * data() {
+            return data_;
+        }
+
+        const U * data() const {
+            return data_;
+        }
+    private:
+        U data_[N];
+    };
+
+    /**
+     * @class state_array
+     * @brief array of elements allocated on heap, size given at run time
+     */
+    template<typename U>
+    class state_array<U, 0> {
+    public:
+        explicit state_array(int n) : n(n) {
+            data_ = new U[n];
+        }
+
+        state_array(const state_array& src) : n(src.n) {
+            data_ = new U[n];
+            for (int i = 0; i < n; i++) {
+                data_[i] = src.data_[i];
+            }
+        }
+
+        ~state_array() {
+            delete[] data_;
+        }
+
+        int size() const {
+            return n;
+        }
+
+        U& operator[](int i) {
+            return data_[i];
+        }
+
+        const U& operator[](int i) const {
+            return data_[i];
+        }
+
+        U * data() {
+            return data_;
+        }
+
+        const U * data() const {
+            return data_;
+        }
+    private:
+        state_array& operator=(const state_array&) {
+            throw std::logic_error("can't assign");
+        }
+        int n;
+        U * data_;
+    };
+
+    /*
+     * index arithmetic of circular state without modulo.
+     * 0 <= i < size and 0 <= d < size
+     */
+    inline int next_index(int i, int size)
+    {
+        i++;
+        return (i == size) ? 0 : i;
+    }
+
+    inline int prev_index(int i, int size)
+    {
+        return (i == 0) ? size - 1 : i - 1;
+    }
+
+    inline int add_index(int i, int d, int size)
+    {
+        i += d;
+        return (i >= size) ? i - size : i;
+    }
+}
+#endif // STATEARRAY_HPP
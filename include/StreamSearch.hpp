@@ -0,0 +1,151 @@
+#pragma once
+#ifndef STREAMSEARCH_HPP
+#define STREAMSEARCH_HPP
+/**
+ * @file StreamSearch.hpp
+ *
+ * @brief search of many streams in one run
+ *
+ * Each stream id is embedded in the parameters by setStreamID() of the
+ * generator and searched by one of the worker threads. Irreducible
+ * factors of characteristic polynomials are registered as they are
+ * found, and a parameter set whose factor is already registered is
+ * discarded, so all streams have pairwise distinct polynomials.
+ */
+#include "devavxprng.h"
+#include "ParallelSearch.hpp"
+#include <NTL/GF2X.h>
+#include <string>
+#include <vector>
+#include <set>
+#include <ostream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+namespace MTToolBox {
+    /**
+     * @class StreamTable
+     * @brief ids to be searched, polynomials found and result lines
+     */
+    class StreamTable {
+    public:
+        /**
+         * @param first first stream id
+         * @param count number of streams
+         */
+        StreamTable(long first, long count)
+            : first(first), lines(count), next(0), duplicates(0) {
+        }
+
+        /**
+         * @return next stream id to be searched, or -1 if all are taken
+         */
+        long next_id() {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (next >= static_cast<long>(lines.size())) {
+                return -1;
+            }
+            return first + next++;
+        }
+
+        /**
+         * register irreducible factor of a parameter set found.
+         * @param irreducible irreducible factor
+         * @return false if the factor is already registered
+         */
+        bool add_polynomial(const NTL::GF2X& irreducible) {
+            std::string key(NTL::NumBytes(irreducible), '\0');
+            if (!key.empty()) {
+                NTL::BytesFromGF2X(reinterpret_cast<unsigned char *>(&key[0]),
+                                   irreducible, key.size());
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!polynomials.insert(key).second) {
+                duplicates++;
+                return false;
+            }
+            return true;
+        }
+
+        void set_line(long id, const std::string& line) {
+            std::lock_guard<std::mutex> lock(mutex);
+            lines[id - first] = line;
+        }
+
+        /**
+         * @return number of parameter sets discarded as duplicated
+         */
+        long get_duplicates() const {
+            return duplicates;
+        }
+
+        /**
+         * output lines in the order of stream id. Line k of the table
+         * is stream first + k.
+         * @param os output stream
+         * @param header header string of the generator
+         */
+        void print(std::ostream& os, const std::string& header) const {
+            using namespace std;
+            os << "# streams " << dec << first << " to "
+               << (first + lines.size() - 1) << ", line k is stream "
+               << first << " + k" << endl;
+            os << "# " << header << endl;
+            for (size_t i = 0; i < lines.size(); i++) {
+                os << lines[i] << endl;
+            }
+        }
+    private:
+        long first;
+        std::vector<std::string> lines;
+        long next;
+        long duplicates;
+        std::set<std::string> polynomials;
+        std::mutex mutex;
+    };
+
+    /**
+     * run \b worker for every stream id of \b table on \b threads
+     * threads. When the worker fails, no more ids are taken. Workers
+     * use NTL, so one thread is used if NTL is not thread safe.
+     * @param table stream table
+     * @param worker function object, bool worker(long id)
+     * @param threads number of threads
+     * @return false if the worker failed
+     */
+    template<typename W>
+    bool run_stream_workers(StreamTable& table, W& worker, int threads)
+    {
+        if (!ntl_thread_safe()) {
+            threads = 1;
+        }
+        std::atomic<bool> ok(true);
+        std::vector<std::thread> pool;
+        for (int i = 0; i < threads; i++) {
+            pool.push_back(std::thread([&table, &worker, &ok]() {
+                        long id;
+                        while (ok && (id = table.next_id()) >= 0) {
+                            if (!worker(id)) {
+                                ok = false;
+                            }
+                        }
+                    }));
+        }
+        for (size_t i = 0; i < pool.size(); i++) {
+            pool[i].join();
+        }
+        return ok;
+    }
+
+    /**
+     * @param seed seed of the run
+     * @param id stream id
+     * @return seed of parameter generator of stream \b id
+     */
+    inline uint64_t stream_seed(uint64_t seed, long id)
+    {
+        return seed + id * 127;
+    }
+}
+#endif // STREAMSEARCH_HPP
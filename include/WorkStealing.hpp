@@ -0,0 +1,298 @@
+#pragma once
+#ifndef WORKSTEALING_HPP
+#define WORKSTEALING_HPP
+/**
+ * @file WorkStealing.hpp
+ *
+ * @brief work stealing scheduler of equidistribution tasks
+ *
+ * A task is k(v) of v = 1 to a maximum v of one pair of start mode
+ * and weight mode for one bit mode. The cost of a task grows with the
+ * size of the basis, v * elementNo, so tasks are sorted by cost and
+ * dealt to the deques of threads in round robin, largest first. A
+ * thread takes tasks from the front of its own deque, largest first,
+ * and when its deque is empty it steals from the back of another
+ * deque, where the smallest tasks are, so the threads end at nearly
+ * the same time.
+ *
+ * Tasks are not split by v. The lattice is reduced once at the maximum
+ * v, and k(v) of smaller v are taken from it in descending order by
+ * get_all_equidist(); a task for each v would reduce a lattice from
+ * scratch for each v again. So largest first is by the size of the
+ * basis at the maximum v, not by v.
+ *
+ * Tasks are not added while running, so a thread ends when all deques
+ * are empty. The time of each task and the thread which ran it are
+ * recorded in the task.
+ */
+#include "devavxprng.h"
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <ostream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+
+namespace MTToolBox {
+    /**
+     * @class eq_task
+     * @brief k(v) of v = 1 to \b v of a pair of start mode and weight
+     * mode
+     */
+    struct eq_task {
+        eq_task(int mode, int bitMode, int v, int sm, int wm,
+                int start_index, long cost)
+            : mode(mode), bitMode(bitMode), v(v), sm(sm), wm(wm),
+              start_index(start_index), cost(cost), k(-1),
+              skipped(false), thread(-1), nanos(0) {
+        }
+        /** index of bit mode given by the caller */
+        int mode;
+        /** bit length of output, 64, 52 or 32 */
+        int bitMode;
+        /** maximum v */
+        int v;
+        int sm;
+        int wm;
+        /** index of \b sm in start modes */
+        int start_index;
+        /** estimated cost, size of the basis */
+        long cost;
+        /** result */
+        int k;
+        /** not evaluated because the start mode can not lower k(v) */
+        bool skipped;
+        /** thread which ran the task */
+        int thread;
+        /** time to run the task */
+        long nanos;
+    };
+
+    /**
+     * @class WorkStealing
+     * @brief per thread deques of tasks and stealing between them
+     */
+    class WorkStealing {
+    public:
+        /**
+         * @param threads number of threads
+         */
+        explicit WorkStealing(int threads)
+            : threads(threads < 1 ? 1 : threads), deques(this->threads),
+              steal_count(0) {
+        }
+
+        /**
+         * run all tasks. \b exec(task) evaluates a task and may throw
+         * std::logic_error *, which is thrown again here after all
+         * threads end. Remaining tasks are dropped after an error.
+         * @param tasks tasks, time and thread are recorded in them
+         * @param exec function object
+         */
+        template<typename F>
+        void run(std::vector<eq_task>& tasks, F& exec) {
+            using namespace std;
+            vector<size_t> order(tasks.size());
+            for (size_t i = 0; i < order.size(); i++) {
+                order[i] = i;
+            }
+            stable_sort(order.begin(), order.end(),
+                        [&tasks](size_t a, size_t b) {
+                            return tasks[a].cost > tasks[b].cost;
+                        });
+            for (size_t i = 0; i < order.size(); i++) {
+                deques[i % threads].tasks.push_back(order[i]);
+            }
+            atomic<bool> stop(false);
+            atomic<logic_error *> error(NULL);
+            auto worker = [&](int w) {
+                size_t t;
+                while (!stop && take(w, t)) {
+                    chrono::steady_clock::time_point start
+                        = chrono::steady_clock::now();
+                    try {
+                        exec(tasks[t]);
+                    } catch (logic_error * x) {
+                        logic_error * expected = NULL;
+                        if (!error.compare_exchange_strong(expected, x)) {
+                            delete x;
+                        }
+                        stop = true;
+                    }
+                    tasks[t].thread = w;
+                    tasks[t].nanos = chrono::duration_cast<
+                        chrono::nanoseconds>(chrono::steady_clock::now()
+                                             - start).count();
+                }
+            };
+            if (threads == 1) {
+                worker(0);
+            } else {
+                vector<thread> pool;
+                for (int w = 0; w < threads; w++) {
+                    pool.push_back(thread(worker, w));
+                }
+                for (int w = 0; w < threads; w++) {
+                    pool[w].join();
+                }
+            }
+            for (int w = 0; w < threads; w++) {
+                deques[w].tasks.clear();
+            }
+            if (error.load() != NULL) {
+                throw error.load();
+            }
+        }
+
+        /**
+         * @return number of tasks stolen
+         */
+        long steals() const {
+            return steal_count;
+        }
+    private:
+        struct task_deque {
+            std::mutex lock;
+            std::deque<size_t> tasks;
+        };
+
+        /**
+         * take a task from the own deque or steal one.
+         * @param w thread
+         * @param[out] t index of task
+         * @return false if all deques are empty
+         */
+        bool take(int w, size_t& t) {
+            {
+                std::lock_guard<std::mutex> guard(deques[w].lock);
+                if (!deques[w].tasks.empty()) {
+                    t = deques[w].tasks.front();
+                    deques[w].tasks.pop_front();
+                    return true;
+                }
+            }
+            for (int i = 1; i < threads; i++) {
+                task_deque& victim = deques[(w + i) % threads];
+                std::lock_guard<std::mutex> guard(victim.lock);
+                if (!victim.tasks.empty()) {
+                    t = victim.tasks.back();
+                    victim.tasks.pop_back();
+                    steal_count++;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        int threads;
+        std::vector<task_deque> deques;
+        std::atomic<long> steal_count;
+    };
+
+    /**
+     * assign jobs to processes, largest cost first to the process of
+     * the least total cost. Every process gets same assignment.
+     * @param cost cost of jobs
+     * @param num_process number of processes
+     * @return process of each job
+     */
+    inline std::vector<int> assign_processes(const std::vector<long>& cost,
+                                             int num_process)
+    {
+        using namespace std;
+        vector<size_t> order(cost.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+        stable_sort(order.begin(), order.end(),
+                    [&cost](size_t a, size_t b) {
+                        return cost[a] > cost[b];
+                    });
+        vector<long> load(num_process, 0);
+        vector<int> owner(cost.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            int p = static_cast<int>(min_element(load.begin(), load.end())
+                                     - load.begin());
+            owner[order[i]] = p;
+            load[p] += cost[order[i]];
+        }
+        return owner;
+    }
+
+    /**
+     * throw after the error flags of all processes are merged, so that
+     * all processes throw when a task of any process has thrown.
+     * @param error error of this process, NULL if none
+     * @param any_error maximum of error flags of all processes
+     * @throws std::logic_error * \b error, or a new error if only
+     * another process failed
+     */
+    inline void throw_process_error(std::logic_error * error, int any_error)
+    {
+        if (error != NULL) {
+            throw error;
+        }
+        if (any_error) {
+            throw new std::logic_error("equidistribution failed in "
+                                       "another process");
+        }
+    }
+
+    /**
+     * print time of tasks for each bit mode and maximum v, and time of
+     * each thread.
+     * @param os output stream
+     * @param tasks tasks run by WorkStealing
+     * @param threads number of threads
+     * @param steals number of tasks stolen
+     */
+    inline void print_task_times(std::ostream& os,
+                                 const std::vector<eq_task>& tasks,
+                                 int threads, long steals)
+    {
+        using namespace std;
+        vector<eq_task> sorted(tasks);
+        stable_sort(sorted.begin(), sorted.end(),
+                    [](const eq_task& a, const eq_task& b) {
+                        if (a.bitMode != b.bitMode) {
+                            return a.bitMode > b.bitMode;
+                        }
+                        return a.v < b.v;
+                    });
+        for (size_t i = 0; i < sorted.size();) {
+            size_t j = i;
+            long nanos = 0;
+            int run = 0;
+            int skipped = 0;
+            for (; j < sorted.size() && sorted[j].bitMode == sorted[i].bitMode
+                     && sorted[j].v == sorted[i].v; j++) {
+                nanos += sorted[j].nanos;
+                if (sorted[j].skipped) {
+                    skipped++;
+                } else {
+                    run++;
+                }
+            }
+            os << dec << sorted[i].bitMode << "bit v <= " << sorted[i].v
+               << ": tasks = " << run << ", skipped = " << skipped
+               << ", time = " << static_cast<double>(nanos) / 1.0e9
+               << "s" << endl;
+            i = j;
+        }
+        vector<long> busy(threads < 1 ? 1 : threads, 0);
+        for (size_t i = 0; i < tasks.size(); i++) {
+            if (tasks[i].thread >= 0) {
+                busy[tasks[i].thread] += tasks[i].nanos;
+            }
+        }
+        for (size_t w = 0; w < busy.size(); w++) {
+            os << "thread " << dec << w << ": time = "
+               << static_cast<double>(busy[w]) / 1.0e9 << "s" << endl;
+        }
+        os << "stolen tasks = " << dec << steals << endl;
+    }
+}
+#endif // WORKSTEALING_HPP
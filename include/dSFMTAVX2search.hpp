@@ -9,6 +9,9 @@
  */
 
 #include "devavxprng.h"
+#include "SIMDKernel.hpp"
+#include "StateArray.hpp"
+#include "BulkOutput.hpp"
 #include <sstream>
 #include <MTToolBox/ReducibleGenerator.hpp>
 #include <MTToolBox/MersenneTwister64.hpp>
@@ -137,24 +140,29 @@ namespace MTToolBox {
     };
 
     /**
-     * @class dSFMTAVX2
+     * @class dSFMTAVX2_T
      * @brief DSFMTAVX2 generator class used for dynamic creation
      *
      * This class is one of the main class of DSFMTAVX2 dynamic creator.
      * This class is designed to be called from programs in MTToolBox.
+     *
+     * @tparam SL1 sl1 fixed at compile time, 0 means run time
+     * @tparam PERM perm fixed at compile time, 0 means run time
+     * @tparam MEXP mersenne exponent fixed at compile time, the state
+     * is kept inline. 0 means run time and the state is on heap.
      */
-    class dSFMTAVX2 : public ReducibleGenerator<w256_t> {
+    template<int SL1 = 0, int PERM = 0, int MEXP = 0>
+    class dSFMTAVX2_T : public ReducibleGenerator<w256_t> {
     public:
         /**
          * Constructor by mexp.
          * @param mexp Mersenne Exponent
          */
-        dSFMTAVX2(int mexp) {
+        dSFMTAVX2_T(int mexp)
+            : state((mexp - lung_size) / element_size + 1) {
 #if defined(DEBUG)
             cout << "dSFMTAVX2 constructor start" << endl;
 #endif
-            size = (mexp - lung_size) / element_size + 1;
-            state = new w256_t[size];
             param.mexp = mexp;
             param.pos1 = 0;
             param.sl1 = 0;
@@ -167,27 +175,20 @@ namespace MTToolBox {
             MTToolBox::setZero(previous);
             MTToolBox::setZero(lung);
             prefix = 0;
-            fixedSL1 = 0;
-            fixedPerm = 0;
-        }
-
-        ~dSFMTAVX2() {
-            delete[] state;
+            fixedSL1 = SL1;
+            fixedPerm = PERM;
+            stream_id = -1;
         }
 
         /**
          * The copy constructor.
          * @param src The origin of copy.
          */
-        dSFMTAVX2(const dSFMTAVX2& src) : param(src.param) {
+        dSFMTAVX2_T(const dSFMTAVX2_T& src)
+            : state(src.state), param(src.param) {
 #if defined(DEBUG)
             cout << "dSFMTAVX2 constructor start" << endl;
 #endif
-            size = src.size;
-            state = new w256_t[size];
-            for (int i = 0; i < size; i++) {
-                state[i] = src.state[i];
-            }
             lung = src.lung;
             index = src.index;
             start_mode = src.start_mode;
@@ -196,19 +197,20 @@ namespace MTToolBox {
             prefix = src.prefix;
             fixedSL1 = src.fixedSL1;
             fixedPerm = src.fixedPerm;
+            stream_id = src.stream_id;
         }
 
         /**
          * Constructor by parameter.
          * @param src_param
          */
-        dSFMTAVX2(const dSFMTAVX2_param& src_param) : param(src_param) {
+        dSFMTAVX2_T(const dSFMTAVX2_param& src_param)
+            : state((src_param.mexp - lung_size) / element_size + 1),
+              param(src_param) {
 #if defined(DEBUG)
             cout << "dSFMTAVX2 constructor start" << endl;
 #endif
-            size = (src_param.mexp - lung_size) / element_size + 1;
-            state = new w256_t[size];
-            for (int i = 0; i < size; i++) {
+            for (int i = 0; i < size(); i++) {
                 MTToolBox::setZero(state[i]);
             }
             index = 0;
@@ -217,12 +219,14 @@ namespace MTToolBox {
             MTToolBox::setZero(previous);
             MTToolBox::setZero(lung);
             prefix = 0;
-            fixedSL1 = 0;
-            fixedPerm = 0;
+            fixedSL1 = SL1;
+            fixedPerm = PERM;
+            stream_id = -1;
+            check_fixed();
         }
 
         EquidistributionCalculatable<w256_t> * clone() const {
-            return new dSFMTAVX2(*this);
+            return new dSFMTAVX2_T(*this);
         }
 
         /**
@@ -231,24 +235,24 @@ namespace MTToolBox {
          * @param seed seed for initialization
          */
         void seed(w256_t seed) {
-            uint64_t * pstate = new uint64_t[(size + 1) * 4];
-            for (int i = 0; i < (size + 1) * 4; i++) {
+            uint64_t * pstate = new uint64_t[(size() + 1) * 4];
+            for (int i = 0; i < (size() + 1) * 4; i++) {
                 pstate[i] = 0;
             }
             for (int i = 0; i < 4; i++) {
                 pstate[i] = seed.u64[i];
             }
-            for (int i = 1; i < (size + 1) * 4; i++) {
+            for (int i = 1; i < (size() + 1) * 4; i++) {
                 pstate[i] ^= i + UINT64_C(6364136223846793005)
                     * (pstate[i - 1] ^ (pstate[i - 1] >> 62));
             }
-            for (int i = 0; i < size; i++) {
+            for (int i = 0; i < size(); i++) {
                 for (int j = 0; j < 4; j++) {
                     state[i].u64[j] = pstate[i * 4 + j];
                 }
             }
             for (int i = 0; i < 4; i++) {
-                lung.u64[i] = pstate[size * 4 + i];
+                lung.u64[i] = pstate[size() * 4 + i];
             }
             delete[] pstate;
             index = 0;
@@ -257,24 +261,23 @@ namespace MTToolBox {
         }
 
         void do_recursion(w256_t *r, w256_t *a, w256_t *b, w256_t *lung) {
-            *lung = permutexvar_epi32(*lung, param.perm);
-            *lung ^= *b;
-            *lung ^= SL64(*a, param.sl1);
-            w256_t t;
-            t = SR64(*lung, sr1);
-            t ^= *a;
-            t ^= *lung & param.msk1;
-            *r = t;
+            if (SL1 > 0 && PERM > 0) {
+                dsfmt_recursion_fixed<SL1, sr1, PERM>(r, a, b, lung,
+                                                      param.msk1);
+            } else {
+                dsfmt_recursion(r, a, b, lung, param.msk1, param.sl1,
+                                sr1, param.perm);
+            }
         }
 
         /**
          * Important state transition function.
          */
         void next_state() {
-            index = (index + 1) % size;
+            index = next_index(index, size());
             do_recursion(&state[index],
                          &state[index],
-                         &state[(index + param.pos1) % size],
+                         &state[add_index(index, param.pos1, size())],
                          &lung);
         }
 
@@ -284,47 +287,102 @@ namespace MTToolBox {
          */
         w256_t generate() {
             next_state();
-            w256_t r;
-            index = index % size;
-            int p = (index + size - 1) % size;
-            if (start_mode == 0) {
-                r = state[index];
-            } else {
-                for (int i = 0; i < 4 - start_mode; i++) {
-                    r.u64[i] = state[p].u64[i + start_mode];
-                }
-                int j = 0;
-                for (int i = 4 - start_mode; i < 4; i++) {
-                    r.u64[i] = state[index].u64[j++];
+            return output(index);
+        }
+
+        /**
+         * Block generation. Outputs are same as \b n calls of
+         * generate(), but the state is updated in runs without
+         * wraparound, like gen_rand_all of SFMT.
+         * @param out array of \b n elements to store outputs
+         * @param n number of outputs
+         */
+        void generate_block(w256_t * out, int n) {
+            while (n > 0) {
+                int start = next_index(index, size());
+                int m = advance_run(n, NULL);
+                for (int i = 0; i < m; i++) {
+                    out[i] = output(start + i);
                 }
+                out += m;
+                n -= m;
             }
-#if defined(DEBUG) && 0
-            if (start_mode != 0) {
-                cout << "start_mode = " << dec << start_mode
-                     << " index = " << dec << index
-                     << " p = " << dec << p << endl;
+        }
+
+        /**
+         * Block state transition for sequences of parity values.
+         * out[i] is getParityValue() after i + 1 calls of generate().
+         * Outputs are not calculated, so previous is not updated.
+         * @param out array of \b n elements to store parity values
+         * @param n number of state transitions
+         */
+        void parity_block(w256_t * out, int n) {
+            while (n > 0) {
+                int m = advance_run(n, out);
+                out += m;
+                n -= m;
             }
-#endif
-            w256_t r2;
-            if (weight_mode == max_weight_mode) {
-                r2 = r;
-            } else {
-                for (int i = 0; i < weight_mode; i++) {
-                    r2.u64[i] = r.u64[i];
+        }
+
+        /**
+         * Bulk output to caller's buffer. Outputs are same as \b n
+         * calls of generate(). When \b out is aligned to sizeof(w256_t),
+         * outputs are written by non temporal stores.
+         * @param out array of \b n elements
+         * @param n number of outputs
+         */
+        void fill(w256_t * out, size_t n) {
+            while (n > 0) {
+                int start = next_index(index, size());
+                int m = size();
+                if (n < static_cast<size_t>(m)) {
+                    m = static_cast<int>(n);
                 }
-                for (int i = weight_mode; i < max_weight_mode; i++) {
-                    r2.u64[i] = previous.u64[i];
+                m = advance_run(m, NULL);
+                for (int i = 0; i < m; i++) {
+                    stream_store(&out[i], output(start + i));
                 }
+                out += m;
+                n -= m;
             }
-#if defined(DEBUG) && 0
-            cout << "w:" << dec << weight_mode
-                 << " s:" << dec << start_mode << endl;
-            cout << "r:" << hex << r << endl;
-            cout << "p:" << hex << previous << endl;
-            cout << "2:" << hex << r2 << endl;
-#endif
-            previous = r;
-            return r2;
+            stream_fence();
+        }
+
+        /**
+         * Bulk output of \b nbytes bytes to \b p.
+         * @param p buffer
+         * @param nbytes size of buffer in bytes
+         */
+        void fill_bytes(void * p, size_t nbytes) {
+            bulk_fill_bytes<w256_t>(*this, p, nbytes);
+        }
+
+        /**
+         * lower 32 bits of 64-bit lanes of outputs.
+         * @param out array of \b n elements
+         * @param n number of elements
+         */
+        void fill_uint32(uint32_t * out, size_t n) {
+            bulk_fill_lanes<w256_t>(*this, out, n, dsfmt_lane_uint32);
+        }
+
+        /**
+         * 64-bit lanes of outputs.
+         * @param out array of \b n elements
+         * @param n number of elements
+         */
+        void fill_uint64(uint64_t * out, size_t n) {
+            bulk_fill_lanes<w256_t>(*this, out, n, dsfmt_lane_uint64);
+        }
+
+        /**
+         * 64-bit lanes of outputs as double precision floating point
+         * numbers in the range [1, 2).
+         * @param out array of \b n elements
+         * @param n number of elements
+         */
+        void fill_double(double * out, size_t n) {
+            bulk_fill_lanes<w256_t>(*this, out, n, dsfmt_lane_double);
         }
 
         void setStartMode(int mode) {
@@ -371,10 +429,10 @@ namespace MTToolBox {
 #if defined(DEBUG)
             cout << "dSFMTAVX2 setUpParam start" << endl;
 #endif
-            if (size == 2) {
+            if (size() == 2) {
                 param.pos1 = 1;
             } else {
-                param.pos1 = mt.getUint64() % (size - 2) + 1;
+                param.pos1 = mt.getUint64() % (size() - 2) + 1;
             }
             if (fixedSL1 > 0) {
                 param.sl1 = fixedSL1;
@@ -390,13 +448,18 @@ namespace MTToolBox {
                 param.msk1.u64[i] = mt.getUint64() | mt.getUint64();
                 param.msk1.u64[i] &= UINT64_C(0x000fffffffffffff);
             }
+            if (stream_id >= 0) {
+                param.msk1.u64[0] = (param.msk1.u64[0] & ~UINT64_C(0xffff))
+                    | stream_id;
+            }
+            check_fixed();
 #if defined(DEBUG)
             cout << "dSFMTAVX2 setUpParam end" << endl;
 #endif
         }
 
         void setZero() {
-            for (int i = 0; i < size; i++) {
+            for (int i = 0; i < size(); i++) {
                 MTToolBox::setZero(state[i]);
             }
             MTToolBox::setZero(lung);
@@ -410,7 +473,7 @@ namespace MTToolBox {
          * @return true if all elements of state is zero
          */
         bool isZero() const {
-            for (int i = 0; i < size; i++) {
+            for (int i = 0; i < size(); i++) {
                 if (!MTToolBox::isZero(state[i])) {
                     return false;
                 }
@@ -443,24 +506,44 @@ namespace MTToolBox {
 
         void setOneBit(int bitPos) {
             setZero();
-            if (bitPos < size * element_size) {
+            if (bitPos < size() * element_size) {
                 int idx = bitPos / element_size;
                 int p = (bitPos / 52) % 4;
                 int r = bitPos % 52;
                 state[idx].u64[p] = UINT64_C(1) << r;
             } else {
-                bitPos = bitPos - size * element_size;
+                bitPos = bitPos - size() * element_size;
                 int p = (bitPos / 64) % 4;
                 int r = bitPos % 64;
                 lung.u64[p] = UINT64_C(1) << r;
             }
         }
 
+        /**
+         * @param bitPos position of bit numbered as setOneBit(),
+         * elements are counted from index, like add()
+         * @return bit of state
+         */
+        int getOneBit(int bitPos) const {
+            uint64_t w;
+            int r;
+            if (bitPos < size() * element_size) {
+                int idx = add_index(index, bitPos / element_size, size());
+                w = state[idx].u64[(bitPos / 52) % 4];
+                r = bitPos % 52;
+            } else {
+                bitPos = bitPos - size() * element_size;
+                w = lung.u64[(bitPos / 64) % 4];
+                r = bitPos % 64;
+            }
+            return static_cast<int>((w >> r) & 1);
+        }
+
         /**
          * @param that DSFMTAVX2 generator added to this generator
          */
         void add(EquidistributionCalculatable<w256_t>& other) {
-            dSFMTAVX2 *that = dynamic_cast<dSFMTAVX2 *>(&other);
+            dSFMTAVX2_T *that = dynamic_cast<dSFMTAVX2_T *>(&other);
             if (that == 0) {
                 throw std::invalid_argument(
                     "the adder should have same type as the addee.");
@@ -468,11 +551,9 @@ namespace MTToolBox {
             this->add(that);
         }
 
-        void add(const dSFMTAVX2 * that) {
-            for (int i = 0; i < size; i++) {
-                state[(i + index) % size]
-                    ^= that->state[(i + that->index) % size];
-            }
+        void add(const dSFMTAVX2_T * that) {
+            add_state(state.data(), index, that->state.data(), that->index,
+                      size());
             lung ^= that->lung;
             previous ^= that->previous;
         }
@@ -482,7 +563,7 @@ namespace MTToolBox {
         }
 
         int bitSize() const {
-            return size * element_size + lung_size;
+            return size() * element_size + lung_size;
         }
 
         const std::string getHeaderString() {
@@ -507,7 +588,7 @@ namespace MTToolBox {
 
         void setConst() {
             const uint64_t high = UINT64_C(0x3ff0000000000000);
-            dSFMTAVX2 tmp(*this);
+            dSFMTAVX2_T tmp(*this);
             tmp.setZero();
             tmp.setPrefix(high);
             tmp.setup_prefix();
@@ -519,13 +600,13 @@ namespace MTToolBox {
             setPrefix(0);
         }
 
-        bool equals(const dSFMTAVX2& that) {
+        bool equals(const dSFMTAVX2_T& that) {
             if (lung != that.lung) {
                 return false;
             }
-            for (int i = 0; i < size; i++) {
-                if (state[(index + i) % size]
-                    != that.state[(that.index + i) % size]) {
+            for (int i = 0; i < size(); i++) {
+                if (state[add_index(index, i, size())]
+                    != that.state[add_index(that.index, i, size())]) {
                     return false;
                 }
             }
@@ -538,7 +619,7 @@ namespace MTToolBox {
 
         void d_p() {
             cout << "index = " << dec << index << endl;
-            for (int i = 0; i < size; i++) {
+            for (int i = 0; i < size(); i++) {
                 cout << state[i] << endl;
             }
             cout << lung << endl;
@@ -578,24 +659,138 @@ namespace MTToolBox {
             return 0;
         }
         void setFixedSL1(int value) {
+            if (SL1 > 0 && value != SL1) {
+                throw new std::logic_error(
+                    "sl1 is fixed by template argument");
+            }
             fixedSL1 = value;
         }
         void setFixedPerm(int value) {
+            if (PERM > 0 && value != PERM) {
+                throw new std::logic_error(
+                    "perm is fixed by template argument");
+            }
             fixedPerm = value;
         }
+
+        /**
+         * Embed \b id in the lowest 16 bits of msk1, so that
+         * generators of different streams have different recursions.
+         * @param id stream id, from 0 to 65535, or -1 for none
+         */
+        void setStreamID(int id) {
+            if (id < -1 || id > 0xffff) {
+                throw new std::logic_error("stream id out of range");
+            }
+            stream_id = id;
+        }
+
+        int getStreamID() const {
+            return stream_id;
+        }
     private:
-        dSFMTAVX2& operator=(const dSFMTAVX2&) {
+        /**
+         * throw if the parameter set differs from the template
+         * arguments, which the recursion uses instead of it.
+         */
+        void check_fixed() const {
+            if ((SL1 > 0 && param.sl1 != SL1)
+                || (PERM > 0 && param.perm != PERM)) {
+                throw new std::logic_error(
+                    "parameter differs from template argument");
+            }
+        }
+
+        int size() const {
+            return state.size();
+        }
+
+        /**
+         * advance state at most \b n steps until the index or the index
+         * plus pos1 wraps around.
+         * @param n maximum number of steps
+         * @param lung_out if not NULL, lung after each step is stored
+         * @return number of steps advanced
+         */
+        int advance_run(int n, w256_t * lung_out) {
+            int p = next_index(index, size());
+            int q = add_index(p, param.pos1, size());
+            int m = size() - p;
+            if (size() - q < m) {
+                m = size() - q;
+            }
+            if (n < m) {
+                m = n;
+            }
+            for (int i = 0; i < m; i++) {
+                do_recursion(&state[p + i], &state[p + i], &state[q + i],
+                             &lung);
+                if (lung_out != NULL) {
+                    lung_out[i] = lung;
+                }
+            }
+            index = p + m - 1;
+            return m;
+        }
+
+        /**
+         * output of state[idx] in the current start mode and weight mode.
+         */
+        w256_t output(int idx) {
+            w256_t r;
+            int p = prev_index(idx, size());
+            if (start_mode == 0) {
+                r = state[idx];
+            } else {
+                for (int i = 0; i < 4 - start_mode; i++) {
+                    r.u64[i] = state[p].u64[i + start_mode];
+                }
+                int j = 0;
+                for (int i = 4 - start_mode; i < 4; i++) {
+                    r.u64[i] = state[idx].u64[j++];
+                }
+            }
+#if defined(DEBUG) && 0
+            if (start_mode != 0) {
+                cout << "start_mode = " << dec << start_mode
+                     << " idx = " << dec << idx
+                     << " p = " << dec << p << endl;
+            }
+#endif
+            w256_t r2;
+            if (weight_mode == max_weight_mode) {
+                r2 = r;
+            } else {
+                for (int i = 0; i < weight_mode; i++) {
+                    r2.u64[i] = r.u64[i];
+                }
+                for (int i = weight_mode; i < max_weight_mode; i++) {
+                    r2.u64[i] = previous.u64[i];
+                }
+            }
+#if defined(DEBUG) && 0
+            cout << "w:" << dec << weight_mode
+                 << " s:" << dec << start_mode << endl;
+            cout << "r:" << hex << r << endl;
+            cout << "p:" << hex << previous << endl;
+            cout << "2:" << hex << r2 << endl;
+#endif
+            previous = r;
+            return r2;
+        }
+
+        dSFMTAVX2_T& operator=(const dSFMTAVX2_T&) {
             throw std::logic_error("can't assign");
         }
         void setup_prefix() {
             const uint64_t clear = UINT64_C(0x000fffffffffffff);
-            for (int i = 0; i < size; i++) {
+            for (int i = 0; i < size(); i++) {
                 for (int j = 0; j < 4; j++) {
                     state[i].u64[j] &= clear;
                 }
             }
             if (prefix != 0) {
-                for (int i = 0; i < size; i++) {
+                for (int i = 0; i < size(); i++) {
                     for (int j = 0; j < 4; j++) {
                         state[i].u64[j] |= prefix;
                     }
@@ -604,18 +799,25 @@ namespace MTToolBox {
         }
         enum {sr1 = 12, lung_size = 256, element_size = 208,
               max_weight_mode = 4};
+        enum {fixed_size = MEXP > 0
+              ? (MEXP - lung_size) / element_size + 1 : 0};
         int fixedSL1;
         int fixedPerm;
-        int size;
+        int stream_id;
         int index;
         int start_mode;
         int weight_mode;
-        w256_t * state;
+        state_array<w256_t, fixed_size> state;
         w256_t lung;
         dSFMTAVX2_param param;
         w256_t previous;
         uint64_t prefix;
     };
+
+    /**
+     * dSFMTAVX2 with parameters selected at run time.
+     */
+    typedef dSFMTAVX2_T<> dSFMTAVX2;
 }
 
 #endif
@@ -14,9 +14,301 @@
 #include "AlgorithmDSFMTEquidistribution.hpp"
 #include "Annihilate.hpp"
 #include "AlgorithmCalcFixPoint.hpp"
+#include "StreamSearch.hpp"
+#include "ParallelSearch.hpp"
+#include "SearchPipeline.hpp"
+#include <sstream>
 #include "DCOptions.hpp"
 
 namespace MTToolBox {
+    /**
+     * set shift and permutation parameters fixed by command line
+     * @param g generator
+     * @param opt command line options
+     */
+    template<typename G>
+    void dsfmtavx_set_fixed(G& g, const DCOptions& opt) {
+        if (opt.fixedL) {
+            g.setFixedSL1(opt.fixedSL1);
+        }
+        if (opt.fixedP) {
+            g.setFixedPerm(opt.fixedPerm);
+        }
+    }
+
+    /**
+     * fix point, parity check vector and annihilation of the quotient
+     * of a parameter set found.
+     * @param g generator with the parameter set
+     * @param irreducible irreducible factor of characteristic polynomial
+     * @param fixpoint method of fix point, see select_fixpoint()
+     * @return false if the quotient can't be annihilated, or fix points
+     * by two methods differ
+     */
+    template<typename U, typename G>
+    bool dsfmtavx_prepare(G& g, const NTL::GF2X& irreducible,
+                          const std::string& fixpoint) {
+        using namespace NTL;
+        AlgorithmCalculateParity<U, G> cp;
+        Annihilate<G, U> annihilate;
+        PolynomialContext context(irreducible);
+        annihilate.characteristic(context, g);
+        U fix;
+        U other;
+        bool both = select_fixpoint<G, U>(g, context, fixpoint, fix, other);
+        g.setFixPoint(fix);
+        cp.searchParity(g, irreducible);
+        if (both && !same_fixpoint(g, fix, other)) {
+            std::cout << "fix points by polynomial and linear equation "
+                      << "differ" << std::endl;
+            std::cout << g.getParamString() << std::endl;
+            return false;
+        }
+        U seed;
+        setBitOfPos(&seed, 0, 1);
+        g.seed(seed);
+        return annihilate.anni(g, context);
+    }
+
+    /**
+     * equidistribution of a parameter set prepared. When --max-delta52
+     * is given, the computation stops as soon as the sum of defects is
+     * known to exceed the limit.
+     * @param g generator prepared by dsfmtavx_prepare()
+     * @param opt command line options
+     * @param stats statistics of candidates discarded
+     * @return line of parameters and dimension defect, empty if the
+     * parameter set is discarded
+     */
+    template<typename U, typename G, int bitWidth>
+    std::string dsfmtavx_check_equidistribution(G& g,
+                                                const DCOptions& opt,
+                                                DeltaBoundStats& stats) {
+        using namespace std;
+        int mexp = opt.mexp;
+        int veq52[52];
+        DSFMTInfo info;
+        info.bitSize = bitWidth;
+        info.elementNo = bitWidth / 64;
+        int delta52;
+        if (opt.max_delta52 >= 0) {
+            delta52
+                = calc_dSFMT_equidistribution_bound<U, G>
+                (g, veq52, 52, info, mexp, opt.max_delta52, stats);
+            if (delta52 > opt.max_delta52) {
+                stats.add_candidate(true);
+                return "";
+            }
+        } else {
+            delta52
+                = calc_dSFMT_equidistribution<U, G>
+                (g, veq52, 52, info, mexp);
+        }
+        stats.add_candidate(false);
+        stringstream ss;
+        ss << g.getParamString();
+        ss << dec << delta52;
+        ss << "," << veq52[51];
+        return ss.str();
+    }
+
+    /**
+     * fix point, parity check vector, annihilation of the quotient and
+     * equidistribution of a parameter set found.
+     * @param g generator with the parameter set
+     * @param irreducible irreducible factor of characteristic polynomial
+     * @param opt command line options
+     * @param stats statistics of candidates discarded
+     * @param line line of parameters and dimension defect, empty if
+     * the parameter set is discarded by --max-delta52
+     * @return false if the quotient can't be annihilated
+     */
+    template<typename U, typename G, int bitWidth>
+    bool dsfmtavx_found(G& g, const NTL::GF2X& irreducible,
+                        const DCOptions& opt, DeltaBoundStats& stats,
+                        std::string& line) {
+        if (!dsfmtavx_prepare<U, G>(g, irreducible, opt.fixpoint)) {
+            return false;
+        }
+        line = dsfmtavx_check_equidistribution<U, G, bitWidth>(g, opt,
+                                                               stats);
+        return true;
+    }
+
+    /**
+     * search one parameter set for each stream id, see StreamSearch.hpp
+     * @param opt command line options
+     * @return 0 if this ends normally
+     */
+    template<typename U, typename G, int bitWidth>
+    int dsfmtavx_stream_search(DCOptions& opt) {
+        using namespace std;
+        using namespace NTL;
+        StreamTable table(opt.stream_first, opt.count);
+        DeltaBoundStats stats;
+        G header(opt.mexp);
+        cout << "#seed = " << dec << opt.seed << endl;
+        if (opt.verbose) {
+            time_t t = time(NULL);
+            cout << "search start at " << ctime(&t);
+            cout << "kernel = " << kernel_name<U>() << endl;
+        }
+        auto worker = [&opt, &table, &stats](long id) -> bool {
+            MersenneTwister64 mt(stream_seed(opt.seed, id));
+            G g(opt.mexp);
+            dsfmtavx_set_fixed(g, opt);
+            g.setStreamID(id);
+            AlgorithmReducibleRecursionSearch<U> ars(g, mt);
+            for (;;) {
+                if (!ars.start(opt.mexp * 1000)) {
+                    return false;
+                }
+                GF2X irreducible = ars.getIrreducibleFactor();
+                if (deg(irreducible) != opt.mexp) {
+                    return false;
+                }
+                if (!table.add_polynomial(irreducible)) {
+                    continue;
+                }
+                string line;
+                if (!dsfmtavx_found<U, G, bitWidth>(g, irreducible, opt,
+                                                    stats, line)) {
+                    return false;
+                }
+                if (line.empty()) {
+                    continue;
+                }
+                table.set_line(id, line);
+                return true;
+            }
+        };
+        int threads = search_threads(opt.threads, opt.count);
+        if (!run_stream_workers(table, worker, threads)) {
+            cout << "search failed" << endl;
+            return -1;
+        }
+        table.print(cout, header.getHeaderString() + ", delta52");
+        if (opt.hasMaxDelta()) {
+            stats.print(cout);
+        }
+        if (opt.verbose) {
+            time_t t = time(NULL);
+            cout << "duplicated polynomials = " << dec
+                 << table.get_duplicates() << endl;
+            PolynomialContext::print(cout);
+            cout << "search end at " << ctime(&t) << endl;
+        }
+        return 0;
+    }
+
+    /**
+     * search parameters by \b threads threads, see ParallelSearch.hpp.
+     * Worker w uses seed worker_seed(opt.seed, opt.rank, w), so the
+     * first worker uses the same seed as the search by one thread.
+     * @param opt command line options
+     * @param count number of parameters user requested
+     * @param threads number of worker threads
+     * @return 0 if this ends normally
+     */
+    template<typename U, typename G, int bitWidth>
+    int dsfmtavx_parallel_search(DCOptions& opt, long count, int threads) {
+        using namespace std;
+        using namespace NTL;
+        DeltaBoundStats stats;
+        auto worker = [&opt, &stats](int w, ResultQueue& queue,
+                                     const atomic<bool>& stop) -> bool {
+            MersenneTwister64 mt(worker_seed(opt.seed, opt.rank, w));
+            G g(opt.mexp);
+            dsfmtavx_set_fixed(g, opt);
+            AlgorithmReducibleRecursionSearch<U> ars(g, mt);
+            while (!stop) {
+                if (!ars.start(opt.mexp * 1000)) {
+                    return false;
+                }
+                GF2X irreducible = ars.getIrreducibleFactor();
+                if (deg(irreducible) != opt.mexp) {
+                    return false;
+                }
+                string line;
+                if (!dsfmtavx_found<U, G, bitWidth>(g, irreducible, opt,
+                                                    stats, line)) {
+                    return false;
+                }
+                if (!line.empty() && !push_result(queue, line, stop)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        long written = parallel_search(threads, count, worker, cout);
+        if (written < count) {
+            cout << "search failed" << endl;
+            return -1;
+        }
+        if (opt.hasMaxDelta()) {
+            stats.print(cout);
+        }
+        if (opt.verbose) {
+            time_t t = time(NULL);
+            cout << "threads = " << dec << threads << endl;
+            PolynomialContext::print(cout);
+            cout << "search end at " << ctime(&t) << endl;
+        }
+        return 0;
+    }
+
+    /**
+     * search parameters by the pipeline of SearchPipeline.hpp. Worker
+     * w of the first stage uses seed worker_seed(opt.seed, opt.rank, w).
+     * @param g generator whose fixed parameters are set
+     * @param opt command line options
+     * @param count number of parameters user requested
+     * @return 0 if this ends normally
+     */
+    template<typename U, typename G, int bitWidth>
+    int dsfmtavx_pipeline_search(const G& g, DCOptions& opt, long count) {
+        using namespace std;
+        typedef search_candidate<G> C;
+        typedef CandidateSearch<U, G, MersenneTwister64> S;
+        DeltaBoundStats stats;
+        vector<S *> searchers;
+        for (int w = 0; w < opt.pipeline[0]; w++) {
+            searchers.push_back(new S(g,
+                                      worker_seed(opt.seed, opt.rank, w),
+                                      opt.mexp, opt.mexp * 1000));
+        }
+        auto search = [&searchers](int w) -> C * {
+            return searchers[w]->next();
+        };
+        auto prepare = [&opt](C& c) -> bool {
+            return dsfmtavx_prepare<U, G>(c.g, c.irreducible, opt.fixpoint);
+        };
+        auto equidistribution = [&opt, &stats](C& c) -> string {
+            return dsfmtavx_check_equidistribution<U, G, bitWidth>(
+                c.g, opt, stats);
+        };
+        SearchPipeline<C> pipeline(opt.pipeline);
+        long written = pipeline.run(count, search, prepare,
+                                    equidistribution, cout);
+        for (size_t i = 0; i < searchers.size(); i++) {
+            delete searchers[i];
+        }
+        if (written < count) {
+            cout << "search failed" << endl;
+            return -1;
+        }
+        if (opt.hasMaxDelta()) {
+            stats.print(cout);
+        }
+        if (opt.verbose) {
+            time_t t = time(NULL);
+            pipeline.print_depth(cout);
+            PolynomialContext::print(cout);
+            cout << "search end at " << ctime(&t) << endl;
+        }
+        return 0;
+    }
+
     /**
      * search parameters using all_in_one function in the file search_all.hpp
      * @param opt command line options
@@ -28,66 +320,80 @@ namespace MTToolBox {
         using namespace std;
         using namespace NTL;
 
-        MersenneTwister64 mt(opt.seed);
+        if ((opt.fixpoint == "direct" || opt.fixpoint == "check")
+            && !fixpoint_matrix_fits(G(opt.mexp).bitSize())) {
+            cerr << "--fixpoint " << opt.fixpoint << " needs a matrix "
+                 << "larger than " << dec
+                 << static_cast<long>(fixpoint_matrix_limit)
+                 << " bytes at mexp " << opt.mexp
+                 << ", use poly" << endl;
+            return -1;
+        }
+        if (opt.stream_mode) {
+            return dsfmtavx_stream_search<U, G, bitWidth>(opt);
+        }
+        MersenneTwister64 mt(worker_seed(opt.seed, opt.rank, 0));
         G g(opt.mexp);
 
         cout << "#seed = " << dec << opt.seed << endl;
+        if (opt.rank != 0) {
+            cout << "#rank = " << dec << opt.rank << endl;
+        }
         if (opt.verbose) {
             time_t t = time(NULL);
             cout << "search start at " << ctime(&t);
+            cout << "kernel = " << kernel_name<U>() << endl;
         }
-        if (opt.fixedL) {
-            g.setFixedSL1(opt.fixedSL1);
+        dsfmtavx_set_fixed(g, opt);
+        cout << "# " << g.getHeaderString() << ", delta52"
+             << endl;
+        if (opt.pipeline_mode) {
+            if (ntl_thread_safe()) {
+                return dsfmtavx_pipeline_search<U, G, bitWidth>(g, opt,
+                                                                count);
+            }
+            cerr << "NTL is built without NTL_THREADS, "
+                 << "search without pipeline" << endl;
         }
-        if (opt.fixedP) {
-            g.setFixedPerm(opt.fixedPerm);
+        if (opt.threads > 1) {
+            int threads = search_threads(opt.threads, count);
+            if (threads > 1) {
+                return dsfmtavx_parallel_search<U, G, bitWidth>(opt, count,
+                                                                threads);
+            }
         }
         AlgorithmReducibleRecursionSearch<U> ars(g, mt);
+        DeltaBoundStats stats;
         int i = 0;
-        AlgorithmCalculateParity<U, G> cp;
-        Annihilate<G, U> annihilate;
-        cout << "# " << g.getHeaderString() << ", delta52"
-             << endl;
         while (i < count) {
             if (ars.start(opt.mexp * 1000)) {
                 GF2X irreducible = ars.getIrreducibleFactor();
-                GF2X characteristic = ars.getCharacteristicPolynomial();
                 if (deg(irreducible) != opt.mexp) {
                     cout << "error mexp = " << dec << opt.mexp << " deg = "
                          << dec << deg(irreducible) << endl;
                     return -1;
                 }
-                annihilate.getLCMPoly(characteristic, g);
-                GF2X quotient = characteristic / irreducible;
-                U fixpoint
-                    = calc_fixpoint<G, U>(g, irreducible, quotient);
-                g.setFixPoint(fixpoint);
-                cp.searchParity(g, irreducible);
-                U seed;
-                setBitOfPos(&seed, 0, 1);
-                g.seed(seed);
-                if (!annihilate.anni(g)) {
+                string line;
+                if (!dsfmtavx_found<U, G, bitWidth>(g, irreducible, opt,
+                                                    stats, line)) {
                     return -1;
                 }
-                int veq52[52];
-                DSFMTInfo info;
-                info.bitSize = bitWidth;
-                info.elementNo = bitWidth / 64;
-                int delta52
-                    = calc_dSFMT_equidistribution<U, G>
-                    (g, veq52, 52, info, opt.mexp);
-                cout << g.getParamString();
-                cout << dec << delta52;
-                cout << "," << veq52[51] << endl;
-                //cout << endl;
+                if (line.empty()) {
+                    continue;
+                }
+                cout << line << endl;
                 i++;
             } else {
                 cout << "search failed" << endl;
                 break;
             }
         }
+        if (opt.hasMaxDelta()) {
+            stats.print(cout);
+        }
         if (opt.verbose) {
             time_t t = time(NULL);
+            PolynomialContext::print(cout);
             cout << "search end at " << ctime(&t) << endl;
         }
         return 0;
@@ -24,7 +24,7 @@ namespace MTToolBox {
         U wseed;
         wseed.u64[0] = opt.seed;
         sf.seed(wseed);
-        Annihilate<G, U> annihilate;
+        Annihilate<G, U> annihilate(opt.threads);
         if (!annihilate.anni(sf)) {
             return -1;
         }
@@ -33,8 +33,24 @@ namespace MTToolBox {
         DSFMTInfo info;
         info.bitSize = bitWidth; // IMPORTANT
         info.elementNo = bitWidth / 64;
-        delta52 = calc_dSFMT_equidistribution<U, G>
-            (sf, veq52, 52, info, opt.params.mexp);
+        if (opt.check) {
+            if (!check_dSFMT_all_equidist<U, G>(veq52, 52, sf, info,
+                                                opt.params.mexp)) {
+                cout << "k(v) by all v and by each v differ" << endl;
+                return -1;
+            }
+        } else if (opt.work_stealing) {
+            calc_dSFMT_scheduled_equidist<U, G>(veq52, 52, sf, info,
+                                                opt.params.mexp, opt.threads,
+                                                opt.verbose);
+        } else {
+            calc_dSFMT_all_equidist_parallel<U, G>(veq52, 52, sf, info,
+                                                   opt.params.mexp,
+                                                   opt.threads);
+        }
+        for (int j = 0; j < 52; j++) {
+            delta52 += opt.params.mexp / (j + 1) - veq52[j];
+        }
         cout << sf.getParamString();
         cout << dec << delta52 << endl;
         if (opt.verbose) {
@@ -10,6 +10,17 @@
 
 #include "devavxprng.h"
 
+/*
+ * AVX2 kernels are used when configure found -mavx2 and the compiler
+ * really targets AVX2. Define NO_SIMD to force the scalar code.
+ */
+#if HAVE_AVX2 && defined(__AVX2__) && !defined(NO_SIMD)
+#define W256_USE_AVX2 1
+#include <immintrin.h>
+#else
+#define W256_USE_AVX2 0
+#endif
+
 namespace MTToolBox {
     using namespace NTL;
     using namespace std;
@@ -19,7 +30,12 @@ namespace MTToolBox {
         uint64_t u64[4];
     };
 
-    static inline w256_t permutexvar_epi32(w256_t x, int perm)
+    /*
+     * scalar reference implementation.
+     * These are always compiled, the SIMD versions below must give
+     * bit-identical results. (see check_w256_kernels())
+     */
+    static inline w256_t permutexvar_epi32_scalar(w256_t x, int perm)
     {
         w256_t r;
         for (int i = 0; i < 8; i++) {
@@ -28,7 +44,7 @@ namespace MTToolBox {
         return r;
     }
 
-    static inline w256_t SR64(w256_t x, int s)
+    static inline w256_t SR64_scalar(w256_t x, int s)
     {
         w256_t w;
         for (int i = 0; i < 4; i++) {
@@ -37,7 +53,7 @@ namespace MTToolBox {
         return w;
     }
 
-    static inline w256_t SL64(w256_t x, int s)
+    static inline w256_t SL64_scalar(w256_t x, int s)
     {
         w256_t w;
         for (int i = 0; i < 4; i++) {
@@ -46,13 +62,45 @@ namespace MTToolBox {
         return w;
     }
 
-    /**
-     * n = 1 to 256
-     * upper n bit is on
-     *
-     */
-    template<>
-    inline w256_t make_msb_mask(int n)
+    static inline w256_t and_scalar(w256_t x, w256_t y)
+    {
+        w256_t r;
+        for (int i = 0; i < 4; i++) {
+            r.u64[i] = x.u64[i] & y.u64[i];
+        }
+        return r;
+    }
+
+    static inline w256_t xor_scalar(w256_t x, w256_t y)
+    {
+        w256_t r;
+        for (int i = 0; i < 4; i++) {
+            r.u64[i] = x.u64[i] ^ y.u64[i];
+        }
+        return r;
+    }
+
+    static inline bool equal_scalar(w256_t x, w256_t y)
+    {
+        for (int i = 0; i < 4; i++) {
+            if (x.u64[i] != y.u64[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static inline bool isZero_scalar(w256_t x)
+    {
+        for (int i = 0; i < 4; i++) {
+            if (x.u64[i] != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static inline w256_t make_msb_mask256_scalar(int n)
     {
         w256_t w;
         uint64_t mask = ~UINT64_C(0);
@@ -69,6 +117,103 @@ namespace MTToolBox {
         return w;
     }
 
+    static inline int calc_1pos_scalar(w256_t x)
+    {
+        if (isZero_scalar(x)) {
+            return -1;
+        }
+        int p = 0;
+        for (int i = 0; i < 4; i++) {
+            if (x.u64[i] != 0) {
+                p = i;
+                break;
+            }
+        }
+        int64_t y = (int64_t)x.u64[p];
+        y = count_bit((uint64_t)(y & -y) - 1);
+        return 255 - y - p * 64;
+    }
+
+#if W256_USE_AVX2
+    /*
+     * w256_t keeps its union layout, so that arrays allocated by new
+     * need not be 32 byte aligned; unaligned load/store disappear
+     * when these functions are inlined.
+     */
+    static inline __m256i load256(const w256_t& x)
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(x.u64));
+    }
+
+    static inline w256_t store256(__m256i v)
+    {
+        w256_t w;
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(w.u64), v);
+        return w;
+    }
+
+    static inline w256_t permutexvar_epi32(w256_t x, int perm)
+    {
+        __m256i idx = _mm256_add_epi32(_mm256_setr_epi32(0, 1, 2, 3,
+                                                         4, 5, 6, 7),
+                                       _mm256_set1_epi32(perm));
+        idx = _mm256_and_si256(idx, _mm256_set1_epi32(7));
+        return store256(_mm256_permutevar8x32_epi32(load256(x), idx));
+    }
+
+    static inline w256_t SR64(w256_t x, int s)
+    {
+        return store256(_mm256_srl_epi64(load256(x), _mm_cvtsi32_si128(s)));
+    }
+
+    static inline w256_t SL64(w256_t x, int s)
+    {
+        return store256(_mm256_sll_epi64(load256(x), _mm_cvtsi32_si128(s)));
+    }
+
+    /**
+     * n = 1 to 256
+     * upper n bit is on
+     *
+     */
+    template<>
+    inline w256_t make_msb_mask(int n)
+    {
+        // shift count of each lane is 256 - n - 64 * lane, clipped to 0
+        __m256i cnt = _mm256_sub_epi64(_mm256_set1_epi64x(256 - n),
+                                       _mm256_setr_epi64x(0, 64, 128, 192));
+        __m256i neg = _mm256_cmpgt_epi64(_mm256_setzero_si256(), cnt);
+        cnt = _mm256_andnot_si256(neg, cnt);
+        return store256(_mm256_sllv_epi64(_mm256_set1_epi64x(-1), cnt));
+    }
+#else
+    static inline w256_t permutexvar_epi32(w256_t x, int perm)
+    {
+        return permutexvar_epi32_scalar(x, perm);
+    }
+
+    static inline w256_t SR64(w256_t x, int s)
+    {
+        return SR64_scalar(x, s);
+    }
+
+    static inline w256_t SL64(w256_t x, int s)
+    {
+        return SL64_scalar(x, s);
+    }
+
+    /**
+     * n = 1 to 256
+     * upper n bit is on
+     *
+     */
+    template<>
+    inline w256_t make_msb_mask(int n)
+    {
+        return make_msb_mask256_scalar(n);
+    }
+#endif
+
     template<>
     inline w256_t getOne() {
         w256_t one;
@@ -112,12 +257,12 @@ namespace MTToolBox {
 
     template<>
     inline bool isZero(w256_t x) {
-        for (int i = 0; i < 4; i++) {
-            if (x.u64[i] != 0) {
-                return false;
-            }
-        }
-        return true;
+#if W256_USE_AVX2
+        __m256i v = load256(x);
+        return _mm256_testz_si256(v, v) != 0;
+#else
+        return isZero_scalar(x);
+#endif
     }
 
     template<>
@@ -138,47 +283,53 @@ namespace MTToolBox {
 
     inline const w256_t operator&(w256_t x, w256_t y)
     {
-        w256_t r;
-        for (int i = 0; i < 4; i++) {
-            r.u64[i] = x.u64[i] & y.u64[i];
-        }
-        return r;
+#if W256_USE_AVX2
+        return store256(_mm256_and_si256(load256(x), load256(y)));
+#else
+        return and_scalar(x, y);
+#endif
     }
 
     inline w256_t& operator|=(w256_t& x, w256_t y)
     {
+#if W256_USE_AVX2
+        x = store256(_mm256_or_si256(load256(x), load256(y)));
+#else
         for (int i = 0; i < 4; i++) {
             x.u64[i] |= y.u64[i];
         }
+#endif
         return x;
     }
 
     inline w256_t& operator^=(w256_t& x, w256_t y)
     {
-        for (int i = 0; i < 4; i++) {
-            x.u64[i] ^= y.u64[i];
-        }
+#if W256_USE_AVX2
+        x = store256(_mm256_xor_si256(load256(x), load256(y)));
+#else
+        x = xor_scalar(x, y);
+#endif
         return x;
     }
 
     inline bool operator==(const w256_t& x, const w256_t y)
     {
+#if W256_USE_AVX2
+        __m256i d = _mm256_xor_si256(load256(x), load256(y));
+        return _mm256_testz_si256(d, d) != 0;
+#else
         for (int i = 0; i < 4; i++) {
             if (x.u64[i] != y.u64[i]) {
                 return false;
             }
         }
         return true;
+#endif
     }
 
     inline bool operator!=(const w256_t& x, const w256_t y)
     {
-        for (int i = 0; i < 4; i++) {
-            if (x.u64[i] != y.u64[i]) {
-                return true;
-            }
-        }
-        return false;
+        return !(x == y);
     }
 
     inline ostream& operator<<(ostream& os, w256_t x)
@@ -197,19 +348,17 @@ namespace MTToolBox {
 
     static inline int calc_1pos(w256_t x)
     {
-        if (isZero(x)) {
+#if W256_USE_AVX2
+        __m256i z = _mm256_cmpeq_epi64(load256(x), _mm256_setzero_si256());
+        int nz = ~_mm256_movemask_pd(_mm256_castsi256_pd(z)) & 0xf;
+        if (nz == 0) {
             return -1;
         }
-        int p = 0;
-        for (int i = 0; i < 4; i++) {
-            if (x.u64[i] != 0) {
-                p = i;
-                break;
-            }
-        }
-        int64_t y = (int64_t)x.u64[p];
-        y = count_bit((uint64_t)(y & -y) - 1);
-        return 255 - y - p * 64;
+        int p = __builtin_ctz(nz);
+        return 255 - __builtin_ctzll(x.u64[p]) - p * 64;
+#else
+        return calc_1pos_scalar(x);
+#endif
     }
 
     template<>
@@ -242,5 +391,62 @@ namespace MTToolBox {
         }
         return w;
     }
+
+    /**
+     * Compare SIMD kernels with the scalar reference implementation
+     * using random inputs. When SIMD is not used, this trivially
+     * succeeds.
+     * @param seed seed of xorshift used to make inputs
+     * @param count number of random inputs
+     * @return true if all results are bit-identical
+     */
+    inline bool check_w256_kernels(uint64_t seed, int count)
+    {
+        uint64_t s = seed * 2 + 1;
+        bool ok = true;
+        for (int k = 0; k < count; k++) {
+            w256_t x;
+            w256_t y;
+            for (int i = 0; i < 4; i++) {
+                s ^= s << 13; s ^= s >> 7; s ^= s << 17;
+                x.u64[i] = s;
+                s ^= s << 13; s ^= s >> 7; s ^= s << 17;
+                y.u64[i] = s;
+            }
+            // sparse inputs exercise isZero and calc_1pos
+            if (k % 4 == 1) {
+                for (int i = 0; i < 4; i++) {
+                    if ((s >> i) & 1) {
+                        x.u64[i] = 0;
+                    }
+                }
+            } else if (k % 4 == 2) {
+                setZero(x);
+            }
+            int sh = k % 64;
+            int perm = k % 8;
+            int n = k % 256 + 1;
+            w256_t t = x;
+            t ^= y;
+            ok = ok && equal_scalar(permutexvar_epi32(x, perm),
+                                    permutexvar_epi32_scalar(x, perm));
+            ok = ok && equal_scalar(SR64(x, sh), SR64_scalar(x, sh));
+            ok = ok && equal_scalar(SL64(x, sh), SL64_scalar(x, sh));
+            ok = ok && equal_scalar(x & y, and_scalar(x, y));
+            ok = ok && equal_scalar(t, xor_scalar(x, y));
+            ok = ok && (x == y) == equal_scalar(x, y);
+            ok = ok && (x == x);
+            ok = ok && isZero(x) == isZero_scalar(x);
+            ok = ok && calc_1pos(x) == calc_1pos_scalar(x);
+            ok = ok && equal_scalar(make_msb_mask<w256_t>(n),
+                                    make_msb_mask256_scalar(n));
+            if (!ok) {
+                cerr << "w256 kernel mismatch at " << dec << k
+                     << " x = " << x << " y = " << y << endl;
+                return false;
+            }
+        }
+        return true;
+    }
 }
 #endif
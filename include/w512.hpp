@@ -11,6 +11,18 @@
 #include "devavxprng.h"
 #include <MTToolBox/util.hpp>
 
+/*
+ * AVX-512F kernels are used when configure found -mavx512f and the
+ * compiler really targets AVX-512F. Define NO_SIMD to force the
+ * scalar code.
+ */
+#if HAVE_AVX512F && defined(__AVX512F__) && !defined(NO_SIMD)
+#define W512_USE_AVX512F 1
+#include <immintrin.h>
+#else
+#define W512_USE_AVX512F 0
+#endif
+
 namespace MTToolBox {
     using namespace NTL;
     using namespace std;
@@ -20,8 +32,13 @@ namespace MTToolBox {
         uint64_t u64[8];
     };
 
+    /*
+     * scalar reference implementation.
+     * The AVX-512F versions below must give bit-identical results.
+     * (see check_w512_kernels())
+     */
     // original is 15
-    static inline w512_t permutexvar_epi32(w512_t x, int perm)
+    static inline w512_t permutexvar_epi32_scalar(w512_t x, int perm)
     {
         w512_t r;
         for (int i = 0; i < 16; i++) {
@@ -30,7 +47,7 @@ namespace MTToolBox {
         return r;
     }
 
-    static inline w512_t SR64(w512_t x, int s)
+    static inline w512_t SR64_scalar(w512_t x, int s)
     {
         w512_t w;
         for (int i = 0; i < 8; i++) {
@@ -39,7 +56,7 @@ namespace MTToolBox {
         return w;
     }
 
-    static inline w512_t SL64(w512_t x, int s)
+    static inline w512_t SL64_scalar(w512_t x, int s)
     {
         w512_t w;
         for (int i = 0; i < 8; i++) {
@@ -47,13 +64,42 @@ namespace MTToolBox {
         }
         return w;
     }
-    /**
-     * n = 1 to 512
-     * upper n bit is on
-     *
-     */
-    template<>
-    inline w512_t make_msb_mask(int n)
+
+    static inline w512_t and_scalar(w512_t x, w512_t y) {
+        w512_t r;
+        for (int i = 0; i < 8; i++) {
+            r.u64[i] = x.u64[i] & y.u64[i];
+        }
+        return r;
+    }
+
+    static inline w512_t xor_scalar(w512_t x, w512_t y) {
+        w512_t r;
+        for (int i = 0; i < 8; i++) {
+            r.u64[i] = x.u64[i] ^ y.u64[i];
+        }
+        return r;
+    }
+
+    static inline bool equal_scalar(w512_t x, w512_t y) {
+        for (int i = 0; i < 8; i++) {
+            if (x.u64[i] != y.u64[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static inline bool isZero_scalar(w512_t x) {
+        for (int i = 0; i < 8; i++) {
+            if (x.u64[i] != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static inline w512_t make_msb_mask512_scalar(int n)
     {
         w512_t w;
         uint64_t mask = ~UINT64_C(0);
@@ -70,6 +116,139 @@ namespace MTToolBox {
         return w;
     }
 
+    static inline int calc_1pos_scalar(w512_t x)
+    {
+        if (isZero_scalar(x)) {
+            return -1;
+        }
+        int p = 0;
+        for (int i = 0; i < 8; i++) {
+            if (x.u64[i] != 0) {
+                p = i;
+                break;
+            }
+        }
+        int64_t y = (int64_t)x.u64[p];
+        y = count_bit((uint64_t)(y & -y) - 1);
+        return 511 - y - p * 64;
+    }
+
+#if W512_USE_AVX512F
+    /*
+     * w512_t keeps its union layout, so that arrays allocated by new
+     * need not be 64 byte aligned; unaligned load/store disappear
+     * when these functions are inlined.
+     */
+    static inline __m512i load512(const w512_t& x)
+    {
+        return _mm512_loadu_si512(x.u64);
+    }
+
+    static inline w512_t store512(__m512i v)
+    {
+        w512_t w;
+        _mm512_storeu_si512(w.u64, v);
+        return w;
+    }
+
+    static inline w512_t permutexvar_epi32(w512_t x, int perm)
+    {
+        __m512i idx = _mm512_add_epi32(_mm512_setr_epi32(0, 1, 2, 3,
+                                                         4, 5, 6, 7,
+                                                         8, 9, 10, 11,
+                                                         12, 13, 14, 15),
+                                       _mm512_set1_epi32(perm));
+        // vpermd uses only the lower 4 bits of the index
+        return store512(_mm512_permutexvar_epi32(idx, load512(x)));
+    }
+
+    static inline w512_t SR64(w512_t x, int s)
+    {
+        return store512(_mm512_srl_epi64(load512(x), _mm_cvtsi32_si128(s)));
+    }
+
+    static inline w512_t SL64(w512_t x, int s)
+    {
+        return store512(_mm512_sll_epi64(load512(x), _mm_cvtsi32_si128(s)));
+    }
+
+    /**
+     * x ^ y ^ z
+     */
+    static inline w512_t xor3(w512_t x, w512_t y, w512_t z)
+    {
+        return store512(_mm512_ternarylogic_epi64(load512(x), load512(y),
+                                                  load512(z), 0x96));
+    }
+
+    /**
+     * x ^ (y & z)
+     */
+    static inline w512_t xor_and(w512_t x, w512_t y, w512_t z)
+    {
+        return store512(_mm512_ternarylogic_epi64(load512(x), load512(y),
+                                                  load512(z), 0x78));
+    }
+
+    /**
+     * n = 1 to 512
+     * upper n bit is on
+     *
+     */
+    template<>
+    inline w512_t make_msb_mask(int n)
+    {
+        // shift count of each lane is 512 - n - 64 * lane, clipped to 0
+        __m512i cnt = _mm512_sub_epi64(_mm512_set1_epi64(512 - n),
+                                       _mm512_setr_epi64(0, 64, 128, 192,
+                                                         256, 320, 384, 448));
+        cnt = _mm512_max_epi64(cnt, _mm512_setzero_si512());
+        return store512(_mm512_sllv_epi64(_mm512_set1_epi64(-1), cnt));
+    }
+#else
+    static inline w512_t permutexvar_epi32(w512_t x, int perm)
+    {
+        return permutexvar_epi32_scalar(x, perm);
+    }
+
+    static inline w512_t SR64(w512_t x, int s)
+    {
+        return SR64_scalar(x, s);
+    }
+
+    static inline w512_t SL64(w512_t x, int s)
+    {
+        return SL64_scalar(x, s);
+    }
+
+    /**
+     * x ^ y ^ z
+     */
+    static inline w512_t xor3(w512_t x, w512_t y, w512_t z)
+    {
+        return xor_scalar(xor_scalar(x, y), z);
+    }
+
+    /**
+     * x ^ (y & z)
+     */
+    static inline w512_t xor_and(w512_t x, w512_t y, w512_t z)
+    {
+        return xor_scalar(x, and_scalar(y, z));
+    }
+
+    /**
+     * n = 1 to 512
+     * upper n bit is on
+     *
+     */
+    template<>
+    inline w512_t make_msb_mask(int n)
+    {
+        return make_msb_mask512_scalar(n);
+    }
+#endif
+
     template<>
     inline w512_t getOne() {
         w512_t one;
@@ -113,12 +292,12 @@ namespace MTToolBox {
 
     template<>
     inline bool isZero(w512_t x) {
-        for (int i = 0; i < 8; i++) {
-            if (x.u64[i] != 0) {
-                return false;
-            }
-        }
-        return true;
+#if W512_USE_AVX512F
+        __m512i v = load512(x);
+        return _mm512_test_epi64_mask(v, v) == 0;
+#else
+        return isZero_scalar(x);
+#endif
     }
 
     template<>
@@ -139,43 +318,43 @@ namespace MTToolBox {
 
 
     inline const w512_t operator&(w512_t x, w512_t y) {
-        w512_t r;
-        for (int i = 0; i < 8; i++) {
-            r.u64[i] = x.u64[i] & y.u64[i];
-        }
-        return r;
+#if W512_USE_AVX512F
+        return store512(_mm512_and_si512(load512(x), load512(y)));
+#else
+        return and_scalar(x, y);
+#endif
     }
 
     inline w512_t& operator|=(w512_t& x, w512_t y) {
+#if W512_USE_AVX512F
+        x = store512(_mm512_or_si512(load512(x), load512(y)));
+#else
         for (int i = 0; i < 8; i++) {
             x.u64[i] |= y.u64[i];
         }
+#endif
         return x;
     }
 
     inline w512_t& operator^=(w512_t& x, w512_t y) {
-        for (int i = 0; i < 8; i++) {
-            x.u64[i] ^= y.u64[i];
-        }
+#if W512_USE_AVX512F
+        x = store512(_mm512_xor_si512(load512(x), load512(y)));
+#else
+        x = xor_scalar(x, y);
+#endif
         return x;
     }
 
     inline bool operator==(const w512_t& x, const w512_t y) {
-        for (int i = 0; i < 8; i++) {
-            if (x.u64[i] != y.u64[i]) {
-                return false;
-            }
-        }
-        return true;
+#if W512_USE_AVX512F
+        return _mm512_cmpneq_epi64_mask(load512(x), load512(y)) == 0;
+#else
+        return equal_scalar(x, y);
+#endif
     }
 
     inline bool operator!=(const w512_t& x, const w512_t y) {
-        for (int i = 0; i < 8; i++) {
-            if (x.u64[i] != y.u64[i]) {
-                return true;
-            }
-        }
-        return false;
+        return !(x == y);
     }
 
     inline ostream& operator<<(ostream& os, w512_t x) {
@@ -207,19 +386,17 @@ namespace MTToolBox {
 
     static inline int calc_1pos(w512_t x)
     {
-        if (isZero(x)) {
+#if W512_USE_AVX512F
+        __m512i v = load512(x);
+        int nz = _mm512_test_epi64_mask(v, v);
+        if (nz == 0) {
             return -1;
         }
-        int p = 0;
-        for (int i = 0; i < 8; i++) {
-            if (x.u64[i] != 0) {
-                p = i;
-                break;
-            }
-        }
-        int64_t y = (int64_t)x.u64[p];
-        y = count_bit((uint64_t)(y & -y) - 1);
-        return 511 - y - p * 64;
+        int p = __builtin_ctz(nz);
+        return 511 - __builtin_ctzll(x.u64[p]) - p * 64;
+#else
+        return calc_1pos_scalar(x);
+#endif
     }
 
     template<>
@@ -249,5 +426,68 @@ namespace MTToolBox {
         }
         return w;
     }
+
+    /**
+     * Compare AVX-512F kernels with the scalar reference
+     * implementation using random inputs. When AVX-512F is not used,
+     * this trivially succeeds.
+     * @param seed seed of xorshift used to make inputs
+     * @param count number of random inputs
+     * @return true if all results are bit-identical
+     */
+    inline bool check_w512_kernels(uint64_t seed, int count) {
+        uint64_t s = seed * 2 + 1;
+        bool ok = true;
+        for (int k = 0; k < count; k++) {
+            w512_t x;
+            w512_t y;
+            w512_t z;
+            for (int i = 0; i < 8; i++) {
+                s ^= s << 13; s ^= s >> 7; s ^= s << 17;
+                x.u64[i] = s;
+                s ^= s << 13; s ^= s >> 7; s ^= s << 17;
+                y.u64[i] = s;
+                s ^= s << 13; s ^= s >> 7; s ^= s << 17;
+                z.u64[i] = s;
+            }
+            // sparse inputs exercise isZero and calc_1pos
+            if (k % 4 == 1) {
+                for (int i = 0; i < 8; i++) {
+                    if ((s >> i) & 1) {
+                        x.u64[i] = 0;
+                    }
+                }
+            } else if (k % 4 == 2) {
+                setZero(x);
+            }
+            int sh = k % 64;
+            int perm = k % 16;
+            int n = k % 512 + 1;
+            w512_t t = x;
+            t ^= y;
+            ok = ok && equal_scalar(permutexvar_epi32(x, perm),
+                                    permutexvar_epi32_scalar(x, perm));
+            ok = ok && equal_scalar(SR64(x, sh), SR64_scalar(x, sh));
+            ok = ok && equal_scalar(SL64(x, sh), SL64_scalar(x, sh));
+            ok = ok && equal_scalar(x & y, and_scalar(x, y));
+            ok = ok && equal_scalar(t, xor_scalar(x, y));
+            ok = ok && equal_scalar(xor3(x, y, z),
+                                    xor_scalar(xor_scalar(x, y), z));
+            ok = ok && equal_scalar(xor_and(x, y, z),
+                                    xor_scalar(x, and_scalar(y, z)));
+            ok = ok && (x == y) == equal_scalar(x, y);
+            ok = ok && (x == x);
+            ok = ok && isZero(x) == isZero_scalar(x);
+            ok = ok && calc_1pos(x) == calc_1pos_scalar(x);
+            ok = ok && equal_scalar(make_msb_mask<w512_t>(n),
+                                    make_msb_mask512_scalar(n));
+            if (!ok) {
+                cerr << "w512 kernel mismatch at " << dec << k
+                     << " x = " << x << " y = " << y << endl;
+                return false;
+            }
+        }
+        return true;
+    }
 }
 #endif
@@ -0,0 +1,38 @@
+#pragma once
+#ifndef MPIUTIL_HPP
+#define MPIUTIL_HPP
+/**
+ * @file MPIUtil.hpp
+ *
+ * @brief helpers of the MPI eq tools
+ */
+#include "devavxprng.h"
+#include <mpi.h>
+#include <thread>
+
+namespace MTToolBox {
+    /**
+     * threads of a process. When \b requested is 0, cores of the node
+     * are divided by the processes on the node, so that processes on
+     * one node don't run more threads than cores. This is a collective
+     * call of MPI_COMM_WORLD.
+     * @param requested number of threads requested, 0 for default
+     * @return number of threads
+     */
+    inline int mpi_threads(int requested)
+    {
+        MPI_Comm node;
+        int node_process;
+        MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0,
+                            MPI_INFO_NULL, &node);
+        MPI_Comm_size(node, &node_process);
+        MPI_Comm_free(&node);
+        if (requested > 0) {
+            return requested;
+        }
+        int n = static_cast<int>(std::thread::hardware_concurrency())
+            / node_process;
+        return n < 1 ? 1 : n;
+    }
+}
+#endif // MPIUTIL_HPP
@@ -21,16 +21,24 @@ int main(int argc, char *argv[]) {
     MPI_Init(&argc, &argv);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &num_process);
+    enum {fixed_sl1 = 19, fixed_sr1 = 7, fixed_perm = 1};
     DCOptions opt(1279);
     opt.useSR1 = true;
-    opt.fixedSL1 = 19;
-    opt.fixedSR1 = 7;
-    opt.fixedPerm = 1;
+    opt.fixedSL1 = fixed_sl1;
+    opt.fixedSR1 = fixed_sr1;
+    opt.fixedPerm = fixed_perm;
     bool parse = opt.parse(argc, argv);
     if (!parse) {
         MPI_Finalize();
         return -1;
     }
+    if (opt.stream_mode && num_process > 1) {
+        // the table of polynomials of streams is not shared by processes
+        cerr << "--stream-id can't be used with more than one process"
+             << endl;
+        MPI_Finalize();
+        return -1;
+    }
     char * pgm = argv[0];
     char fname[500];
     sprintf(fname, "%s-%d-%04d.txt", pgm, opt.mexp, rank);
@@ -49,8 +57,13 @@ int main(int argc, char *argv[]) {
         MPI_Finalize();
         return 1;
     }
-    opt.seed = opt.seed + rank * 127;
-    sfmtavx_search<w512_t, SFMTAVX512F, 512>(opt, opt.count);
+    opt.rank = rank;
+    typedef SFMTAVX512F_T<fixed_sl1, fixed_sr1, fixed_perm> SFMTAVX512F_fixed;
+    if (opt.allFixed(fixed_sl1, fixed_sr1, fixed_perm)) {
+        sfmtavx_search<w512_t, SFMTAVX512F_fixed, 512>(opt, opt.count);
+    } else {
+        sfmtavx_search<w512_t, SFMTAVX512F, 512>(opt, opt.count);
+    }
     close(fd);
     MPI_Abort(MPI_COMM_WORLD, 0);
     MPI_Finalize();
@@ -5,6 +5,7 @@
  * @file SFMTAVXeqmpi.hpp
  */
 #include "devavxprng.h"
+#include <mpi.h>
 #include "AlgorithmSIMDEquidistribution.hpp"
 //#include <MTToolBox/AlgorithmEquidistribution.hpp>
 //#include <MTToolBox/AlgorithmReducibleRecursionSearch.hpp>
@@ -12,6 +13,7 @@
 //#include <NTL/GF2X.h>
 #include "Annihilate.hpp"
 #include "EQOptions.hpp"
+#include "MPIUtil.hpp"
 
 namespace MTToolBox {
 
@@ -23,48 +25,58 @@ namespace MTToolBox {
         U wseed;
         wseed.u64[0] = opt.seed;
         sf.seed(wseed);
-        Annihilate<G, U, uint32_t> annihilate;
+        Annihilate<G, U> annihilate;
         if (!annihilate.anni(sf)) {
             return -1;
         }
 
-        SIMDInfo info;
-        info.bitSize = bitWidth;
-        info.fastMode = false;
+        SIMDInfo info[2];
+        info[0].bitSize = bitWidth;
+        info[0].fastMode = false;
+        info[0].bitMode = 64;
+        info[0].elementNo = bitWidth / 64;
+        info[1] = info[0];
+        info[1].bitMode = 32;
+        info[1].elementNo = bitWidth / 32;
         sf.reset_reverse_bit();
-        info.bitMode = 64;
-        info.elementNo = bitWidth / 64;
-        if (opt.verbose) {
-            cout << "64bit dimension of equidistribution at v-bit accuracy k(v)"
-                 << endl;
+        // pairs of modes of both bit modes are balanced over processes
+        int veq64[64];
+        int veq32[32];
+        int * veq[2] = {veq64, veq32};
+        int bit_len[2] = {64, 32};
+        int threads = mpi_threads(opt.threads);
+        auto reduce_max = [](int * data, int n) {
+            MPI_Allreduce(MPI_IN_PLACE, data, n, MPI_INT, MPI_MAX,
+                          MPI_COMM_WORLD);
+        };
+        // every process throws when a task of any process fails, and
+        // returns to MPI_Finalize
+        try {
+            calc_SIMD_scheduled_equidist<U, G>(veq, bit_len, info, 2, sf,
+                                               opt.params.mexp, threads,
+                                               opt.verbose, rank, num_process,
+                                               reduce_max);
+        } catch (std::logic_error * e) {
+            cerr << "rank " << dec << rank << ": " << e->what() << endl;
+            delete e;
+            return -1;
         }
-        for (int v = 1; v <= 64; v++) {
-            if (v % num_process == rank) {
-                int veq = calc_SIMD_equidist<U, G>(v, sf, info,
-                                                   opt.params.mexp);
-                int d = opt.params.mexp / v - veq;
-                if (opt.verbose) {
-                    cout << "k(" << dec << v << ") = " << dec << veq;
-                    cout << "\td(" << dec << v << ") = " << dec << d << endl;
-                }
-            }
+        if (rank != 0 || !opt.verbose) {
+            return 0;
         }
-        info.bitMode = 32;
-        info.elementNo = bitWidth / 32;
-        if (opt.verbose) {
-            cout << "32bit dimension of equidistribution at v-bit accuracy k(v)"
-                 << endl;
+        cout << "64bit dimension of equidistribution at v-bit accuracy k(v)"
+             << endl;
+        for (int v = 1; v <= 64; v++) {
+            int d = opt.params.mexp / v - veq64[v - 1];
+            cout << "k(" << dec << v << ") = " << dec << veq64[v - 1];
+            cout << "\td(" << dec << v << ") = " << dec << d << endl;
         }
+        cout << "32bit dimension of equidistribution at v-bit accuracy k(v)"
+             << endl;
         for (int v = 1; v <= 32; v++) {
-            if (v % num_process == rank) {
-                int veq = calc_SIMD_equidist<U, G>
-                    (v, sf, info, opt.params.mexp);
-                int d = opt.params.mexp / v - veq;
-                if (opt.verbose) {
-                    cout << "k(" << dec << v << ") = " << dec << veq;
-                    cout << "\td(" << dec << v << ") = " << dec << d << endl;
-                }
-            }
+            int d = opt.params.mexp / v - veq32[v - 1];
+            cout << "k(" << dec << v << ") = " << dec << veq32[v - 1];
+            cout << "\td(" << dec << v << ") = " << dec << d << endl;
         }
         return 0;
     }
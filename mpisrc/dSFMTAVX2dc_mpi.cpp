@@ -20,15 +20,23 @@ int main(int argc, char *argv[]) {
     MPI_Init(&argc, &argv);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &num_process);
+    enum {fixed_sl1 = 19, fixed_perm = 1};
     DCOptions opt(607);
     opt.useSR1 = false;
-    opt.fixedSL1 = 19;
-    opt.fixedPerm = 1;
+    opt.fixedSL1 = fixed_sl1;
+    opt.fixedPerm = fixed_perm;
     bool parse = opt.parse(argc, argv);
     if (!parse) {
         MPI_Finalize();
         return -1;
     }
+    if (opt.stream_mode && num_process > 1) {
+        // the table of polynomials of streams is not shared by processes
+        cerr << "--stream-id can't be used with more than one process"
+             << endl;
+        MPI_Finalize();
+        return -1;
+    }
     char * pgm = argv[0];
     char fname[500];
     sprintf(fname, "%s-%d-%04d.txt", pgm, opt.mexp, rank);
@@ -47,8 +55,13 @@ int main(int argc, char *argv[]) {
         MPI_Finalize();
         return 1;
     }
-    opt.seed = opt.seed + rank * 127;
-    dsfmtavx_search<w256_t, dSFMTAVX2, 256>(opt, opt.count);
+    opt.rank = rank;
+    typedef dSFMTAVX2_T<fixed_sl1, fixed_perm> dSFMTAVX2_fixed;
+    if (opt.allFixed(fixed_sl1, 0, fixed_perm)) {
+        dsfmtavx_search<w256_t, dSFMTAVX2_fixed, 256>(opt, opt.count);
+    } else {
+        dsfmtavx_search<w256_t, dSFMTAVX2, 256>(opt, opt.count);
+    }
     close(fd);
     MPI_Abort(MPI_COMM_WORLD, 0);
     MPI_Finalize();
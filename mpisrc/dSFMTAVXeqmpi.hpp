@@ -6,6 +6,7 @@
  */
 
 #include "devavxprng.h"
+#include <mpi.h>
 #include "AlgorithmDSFMTEquidistribution.hpp"
 //#include <MTToolBox/AlgorithmEquidistribution.hpp>
 //#include <MTToolBox/AlgorithmReducibleRecursionSearch.hpp>
@@ -13,6 +14,7 @@
 //#include <NTL/GF2X.h>
 #include "Annihilate.hpp"
 #include "EQOptions.hpp"
+#include "MPIUtil.hpp"
 
 namespace MTToolBox {
 
@@ -25,7 +27,7 @@ namespace MTToolBox {
         U wseed;
         wseed.u64[0] = opt.seed;
         sf.seed(wseed);
-        Annihilate<G, U, uint64_t> annihilate;
+        Annihilate<G, U> annihilate;
         if (!annihilate.anni(sf)) {
             return -1;
         }
@@ -33,14 +35,32 @@ namespace MTToolBox {
         DSFMTInfo info;
         info.bitSize = bitWidth; // IMPORTANT
         info.elementNo = bitWidth / 64;
+        // pairs of modes are balanced over processes
+        int veq[64];
+        int threads = mpi_threads(opt.threads);
+        auto reduce_max = [](int * data, int n) {
+            MPI_Allreduce(MPI_IN_PLACE, data, n, MPI_INT, MPI_MAX,
+                          MPI_COMM_WORLD);
+        };
+        // every process throws when a task of any process fails, and
+        // returns to MPI_Finalize
+        try {
+            calc_dSFMT_scheduled_equidist<U, G>(veq, 64, sf, info,
+                                                opt.params.mexp, threads,
+                                                opt.verbose, rank,
+                                                num_process, reduce_max);
+        } catch (std::logic_error * e) {
+            cerr << "rank " << dec << rank << ": " << e->what() << endl;
+            delete e;
+            return -1;
+        }
+        if (rank != 0) {
+            return 0;
+        }
         for (int v = 1; v <= 64; v++) {
-            if (v % num_process == rank) {
-                int veq = calc_dSFMT_equidist<U, G>(v, sf, info,
-                                                    opt.params.mexp);
-                int d = opt.params.mexp / v - veq;
-                cout << "k(" << dec << v << ") = " << dec << veq;
-                cout << "\td(" << dec << v << ") = " << dec << d << endl;
-            }
+            int d = opt.params.mexp / v - veq[v - 1];
+            cout << "k(" << dec << v << ") = " << dec << veq[v - 1];
+            cout << "\td(" << dec << v << ") = " << dec << d << endl;
         }
         return 0;
     }
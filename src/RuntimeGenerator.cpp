@@ -0,0 +1,523 @@
+/**
+ * @file RuntimeGenerator.cpp
+ *
+ * @brief block kernels and initialization of RuntimeGenerator
+ *
+ * Kernels are compiled with target attributes and selected by CPUID
+ * when the generator is made, so the library works with and without
+ * configure --enable-dispatch.
+ */
+
+#include "devavxprng.h"
+#include "RuntimeGenerator.hpp"
+#include "SFMTAVX2search.hpp"
+#include "SFMTAVX512Fsearch.hpp"
+#include "dSFMTAVX2search.hpp"
+#include "dSFMTAVX512Fsearch.hpp"
+#include "SIMDKernel.hpp"
+#include "PeriodCertification.hpp"
+#include <fstream>
+#include <stdexcept>
+#if HAVE_IMMINTRIN_H
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace MTToolBox {
+    namespace {
+        enum {kernel_generic, kernel_avx2, kernel_avx512};
+        enum {dsfmt_sr1 = 12};
+        const char * const kernel_names[] = {"generic", "avx2", "avx512"};
+
+        /*
+         * out[i] = recursion of elements i and i + pos1 for i = 0 to
+         * n - 1, where element j is state[j] for j < size and
+         * out[j - size] for j >= size. Last size outputs become the
+         * new state. out may be state itself when n == size.
+         */
+        template<typename U, bool DSFMT>
+        void block_generic(const runtime_param& p, uint64_t * st,
+                           unsigned char * out, size_t n)
+        {
+            const size_t b = sizeof(U);
+            const size_t sz = p.size;
+            U * state = reinterpret_cast<U *>(st);
+            U mask;
+            memcpy(mask.u64, p.mask, b);
+            U l = state[sz];
+            U x;
+            U y;
+            U r;
+            for (size_t i = 0; i < n; i++) {
+                size_t j = i + p.pos1;
+                const void * px = (i < sz) ? static_cast<void *>(&state[i])
+                    : out + (i - sz) * b;
+                const void * py = (j < sz) ? static_cast<void *>(&state[j])
+                    : out + (j - sz) * b;
+                memcpy(&x, px, b);
+                memcpy(&y, py, b);
+                if (DSFMT) {
+                    dsfmt_recursion(&r, &x, &y, &l, mask, p.sl1, dsfmt_sr1,
+                                    p.perm);
+                } else {
+                    sfmt_recursion(&r, &x, &y, &l, mask, p.sl1, p.sr1,
+                                   p.perm);
+                }
+                memcpy(out + i * b, &r, b);
+            }
+            if (out != reinterpret_cast<unsigned char *>(st)) {
+                memcpy(st, out + (n - sz) * b, sz * b);
+            }
+            state[sz] = l;
+        }
+
+#if HAVE_AVX2
+#define DEVAVX_AVX2 __attribute__((target("avx2")))
+        /*
+         * variable shifts by vectors of counts take one uop, like
+         * shifts by immediates.
+         */
+        template<bool DSFMT>
+        DEVAVX_AVX2 inline __m256i rec256(__m256i x, __m256i y, __m256i *l,
+                                          __m256i idx, __m256i mask,
+                                          __m256i sl, __m256i sr)
+        {
+            __m256i t = _mm256_permutevar8x32_epi32(*l, idx);
+            t = _mm256_xor_si256(t, y);
+            t = _mm256_xor_si256(t, _mm256_sllv_epi64(x, sl));
+            *l = t;
+            if (DSFMT) {
+                __m256i r = _mm256_xor_si256(_mm256_srli_epi64(t, dsfmt_sr1),
+                                             x);
+                return _mm256_xor_si256(r, _mm256_and_si256(t, mask));
+            } else {
+                __m256i r = _mm256_srlv_epi64(_mm256_and_si256(y, mask), sr);
+                return _mm256_xor_si256(_mm256_xor_si256(r, t), x);
+            }
+        }
+
+        template<bool DSFMT>
+        DEVAVX_AVX2 void block_avx2(const runtime_param& p, uint64_t * st,
+                                    unsigned char * out, size_t n)
+        {
+            const size_t b = 32;
+            const size_t sz = p.size;
+            const size_t pos1 = p.pos1;
+            __m256i * state = reinterpret_cast<__m256i *>(st);
+            const __m256i idx = _mm256_and_si256(
+                _mm256_add_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                 _mm256_set1_epi32(p.perm)),
+                _mm256_set1_epi32(7));
+            const __m256i mask = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(p.mask));
+            const __m256i sl = _mm256_set1_epi64x(p.sl1);
+            const __m256i sr = _mm256_set1_epi64x(p.sr1);
+            __m256i l = state[sz];
+            size_t i;
+#define RT_LOAD(q) _mm256_loadu_si256(reinterpret_cast<const __m256i *>(q))
+#define RT_STORE(q, v) _mm256_storeu_si256(reinterpret_cast<__m256i *>(q), v)
+            for (i = 0; i < sz - pos1; i++) {
+                RT_STORE(out + i * b,
+                         rec256<DSFMT>(state[i], state[i + pos1], &l,
+                                       idx, mask, sl, sr));
+            }
+            for (; i < sz && i < n; i++) {
+                RT_STORE(out + i * b,
+                         rec256<DSFMT>(state[i],
+                                       RT_LOAD(out + (i + pos1 - sz) * b),
+                                       &l, idx, mask, sl, sr));
+            }
+            for (; i < n; i++) {
+                RT_STORE(out + i * b,
+                         rec256<DSFMT>(RT_LOAD(out + (i - sz) * b),
+                                       RT_LOAD(out + (i - sz + pos1) * b),
+                                       &l, idx, mask, sl, sr));
+            }
+            if (out != reinterpret_cast<unsigned char *>(st)) {
+                for (i = 0; i < sz; i++) {
+                    state[i] = RT_LOAD(out + (n - sz + i) * b);
+                }
+            }
+#undef RT_LOAD
+#undef RT_STORE
+            state[sz] = l;
+        }
+#undef DEVAVX_AVX2
+#endif // HAVE_AVX2
+
+#if HAVE_AVX512F
+#define DEVAVX_AVX512 __attribute__((target("avx512f")))
+        template<bool DSFMT>
+        DEVAVX_AVX512 inline __m512i rec512(__m512i x, __m512i y,
+                                            __m512i *l, __m512i idx,
+                                            __m512i mask, __m512i sl,
+                                            __m512i sr)
+        {
+            __m512i t = _mm512_permutexvar_epi32(idx, *l);
+            t = _mm512_ternarylogic_epi64(t, y, _mm512_sllv_epi64(x, sl),
+                                          0x96);
+            *l = t;
+            if (DSFMT) {
+                __m512i r = _mm512_xor_si512(_mm512_srli_epi64(t, dsfmt_sr1),
+                                             x);
+                return _mm512_ternarylogic_epi64(r, t, mask, 0x78);
+            } else {
+                __m512i r = _mm512_srlv_epi64(_mm512_and_si512(y, mask), sr);
+                return _mm512_ternarylogic_epi64(r, t, x, 0x96);
+            }
+        }
+
+        template<bool DSFMT>
+        DEVAVX_AVX512 void block_avx512(const runtime_param& p, uint64_t * st,
+                                        unsigned char * out, size_t n)
+        {
+            const size_t b = 64;
+            const size_t sz = p.size;
+            const size_t pos1 = p.pos1;
+            __m512i * state = reinterpret_cast<__m512i *>(st);
+            const __m512i idx = _mm512_and_si512(
+                _mm512_add_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7,
+                                                   8, 9, 10, 11, 12, 13, 14,
+                                                   15),
+                                 _mm512_set1_epi32(p.perm)),
+                _mm512_set1_epi32(15));
+            const __m512i mask = _mm512_loadu_si512(p.mask);
+            const __m512i sl = _mm512_set1_epi64(p.sl1);
+            const __m512i sr = _mm512_set1_epi64(p.sr1);
+            __m512i l = state[sz];
+            size_t i;
+            for (i = 0; i < sz - pos1; i++) {
+                _mm512_storeu_si512(out + i * b,
+                                    rec512<DSFMT>(state[i], state[i + pos1],
+                                                  &l, idx, mask, sl, sr));
+            }
+            for (; i < sz && i < n; i++) {
+                _mm512_storeu_si512(
+                    out + i * b,
+                    rec512<DSFMT>(state[i],
+                                  _mm512_loadu_si512(out
+                                                     + (i + pos1 - sz) * b),
+                                  &l, idx, mask, sl, sr));
+            }
+            for (; i < n; i++) {
+                _mm512_storeu_si512(
+                    out + i * b,
+                    rec512<DSFMT>(_mm512_loadu_si512(out + (i - sz) * b),
+                                  _mm512_loadu_si512(out
+                                                     + (i - sz + pos1) * b),
+                                  &l, idx, mask, sl, sr));
+            }
+            if (out != reinterpret_cast<unsigned char *>(st)) {
+                for (i = 0; i < sz; i++) {
+                    state[i] = _mm512_loadu_si512(out + (n - sz + i) * b);
+                }
+            }
+            state[sz] = l;
+        }
+#undef DEVAVX_AVX512
+#endif // HAVE_AVX512F
+
+        int select_block_kernel(int bits)
+        {
+#if HAVE_AVX512F
+            if (bits == 512) {
+#if HAVE_BUILTIN_CPU_SUPPORTS
+                if (__builtin_cpu_supports("avx512f")) {
+                    return kernel_avx512;
+                }
+#elif defined(__AVX512F__)
+                return kernel_avx512;
+#endif
+            }
+#endif
+#if HAVE_AVX2
+            if (bits == 256) {
+#if HAVE_BUILTIN_CPU_SUPPORTS
+                if (__builtin_cpu_supports("avx2")) {
+                    return kernel_avx2;
+                }
+#elif defined(__AVX2__)
+                return kernel_avx2;
+#endif
+            }
+#endif
+            return kernel_generic;
+        }
+
+        template<typename U>
+        void copy_words(uint64_t * dst, const U& src) {
+            memcpy(dst, src.u64, sizeof(U));
+        }
+
+        void set_mask(runtime_param& rp, const SFMTAVX2_param& p) {
+            rp.sr1 = p.sr1;
+            copy_words(rp.mask, p.mat1);
+        }
+
+        void set_mask(runtime_param& rp, const SFMTAVX512F_param& p) {
+            rp.sr1 = p.sr1;
+            copy_words(rp.mask, p.mat1);
+        }
+
+        void set_mask(runtime_param& rp, const dSFMTAVX2_param& p) {
+            rp.sr1 = dsfmt_sr1;
+            copy_words(rp.mask, p.msk1);
+        }
+
+        void set_mask(runtime_param& rp, const dSFMTAVX512F_param& p) {
+            rp.sr1 = dsfmt_sr1;
+            copy_words(rp.mask, p.msk1);
+        }
+
+        template<typename G, typename U, typename P>
+        void seed_by_search(const runtime_param& rp,
+                            const uint64_t * seed_array, uint64_t * st)
+        {
+            P param;
+            vector<char> buf(rp.param_string.begin(),
+                             rp.param_string.end());
+            buf.push_back(0);
+            param.readFromString(&buf[0]);
+            G gen(param);
+            U seed;
+            memcpy(seed.u64, seed_array, sizeof(U));
+            gen.seed(seed);
+            period_certification(gen);
+            gen.generate_block(reinterpret_cast<U *>(st), rp.size);
+            U lung = gen.getParityValue();
+            memcpy(st + rp.size * (sizeof(U) / 8), lung.u64, sizeof(U));
+        }
+
+        template<typename G, typename U, typename P>
+        void set_param(runtime_param& rp, const std::string& line)
+        {
+            P param;
+            vector<char> buf(line.begin(), line.end());
+            buf.push_back(0);
+            param.readFromString(&buf[0]);
+            G gen(param);
+            rp.bits = sizeof(U) * 8;
+            rp.param_string = gen.getParamString();
+            rp.mexp = param.mexp;
+            rp.pos1 = param.pos1;
+            rp.sl1 = param.sl1;
+            rp.perm = param.perm;
+            memset(rp.mask, 0, sizeof(rp.mask));
+            memset(rp.parity, 0, sizeof(rp.parity));
+            set_mask(rp, param);
+            copy_words(rp.parity, param.parity1);
+            if (rp.dsfmt) {
+                rp.size = (gen.bitSize() - rp.bits) / (rp.bits / 16 * 13);
+            } else {
+                rp.size = gen.bitSize() / rp.bits - 1;
+            }
+        }
+    }
+
+    bool parse_runtime_param(runtime_param& param, const std::string& type,
+                             const std::string& line)
+    {
+        if (line.empty() || line[0] < '0' || line[0] > '9') {
+            return false;
+        }
+        param.type = type;
+        param.dsfmt = type[0] == 'd';
+        if (type == "SFMTAVX2") {
+            set_param<SFMTAVX2, w256_t, SFMTAVX2_param>(param, line);
+        } else if (type == "SFMTAVX512F") {
+            set_param<SFMTAVX512F, w512_t, SFMTAVX512F_param>(param, line);
+        } else if (type == "dSFMTAVX2") {
+            set_param<dSFMTAVX2, w256_t, dSFMTAVX2_param>(param, line);
+        } else if (type == "dSFMTAVX512F") {
+            set_param<dSFMTAVX512F, w512_t, dSFMTAVX512F_param>(param,
+                                                                 line);
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    int RuntimeParamTable::load(std::istream& is)
+    {
+        string line;
+        int count = 0;
+        while (getline(is, line)) {
+            runtime_param param;
+            if (parse_runtime_param(param, type, line)) {
+                table.push_back(param);
+                count++;
+            }
+        }
+        return count;
+    }
+
+    int RuntimeParamTable::load(const std::string& path)
+    {
+        ifstream ifs(path.c_str());
+        if (!ifs) {
+            throw new std::runtime_error("can't open " + path);
+        }
+        return load(ifs);
+    }
+
+    RuntimeGenerator::RuntimeGenerator(const runtime_param& param)
+        : param(param), index(param.size)
+    {
+        if (param.size < 2 || param.pos1 < 1 || param.pos1 >= param.size) {
+            throw new std::logic_error("bad parameter of RuntimeGenerator");
+        }
+        void * p = NULL;
+        size_t bytes = static_cast<size_t>(param.size + 1) * param.bits / 8;
+        if (posix_memalign(&p, 64, bytes) != 0) {
+            throw new std::runtime_error("can't allocate state");
+        }
+        state = static_cast<uint64_t *>(p);
+        memset(state, 0, bytes);
+        kernel = select_block_kernel(param.bits);
+    }
+
+    RuntimeGenerator::RuntimeGenerator(const RuntimeGenerator& src)
+        : param(src.param), index(src.index), kernel(src.kernel)
+    {
+        void * p = NULL;
+        size_t bytes = static_cast<size_t>(param.size + 1) * param.bits / 8;
+        if (posix_memalign(&p, 64, bytes) != 0) {
+            throw new std::runtime_error("can't allocate state");
+        }
+        state = static_cast<uint64_t *>(p);
+        memcpy(state, src.state, bytes);
+    }
+
+    RuntimeGenerator::~RuntimeGenerator()
+    {
+        free(state);
+    }
+
+    const char * RuntimeGenerator::kernel_name() const
+    {
+        return kernel_names[kernel];
+    }
+
+    void RuntimeGenerator::seed(uint64_t seed)
+    {
+        uint64_t seed_array[8] = {seed, 0, 0, 0, 0, 0, 0, 0};
+        this->seed(seed_array);
+    }
+
+    /*
+     * seed() and periodCertification() of the search class. The next
+     * size outputs of the search class are the state of the block
+     * kernels, so they are taken with the lung after them, and the
+     * state is full.
+     */
+    void RuntimeGenerator::seed(const uint64_t * seed_array)
+    {
+        if (param.type == "SFMTAVX2") {
+            seed_by_search<SFMTAVX2, w256_t, SFMTAVX2_param>(
+                param, seed_array, state);
+        } else if (param.type == "SFMTAVX512F") {
+            seed_by_search<SFMTAVX512F, w512_t, SFMTAVX512F_param>(
+                param, seed_array, state);
+        } else if (param.type == "dSFMTAVX2") {
+            seed_by_search<dSFMTAVX2, w256_t, dSFMTAVX2_param>(
+                param, seed_array, state);
+        } else if (param.type == "dSFMTAVX512F") {
+            seed_by_search<dSFMTAVX512F, w512_t, dSFMTAVX512F_param>(
+                param, seed_array, state);
+        } else {
+            throw new std::logic_error("bad type of RuntimeGenerator");
+        }
+        index = 0;
+    }
+
+    void RuntimeGenerator::block(unsigned char * out, size_t n)
+    {
+        switch (kernel) {
+#if HAVE_AVX2
+        case kernel_avx2:
+            if (param.dsfmt) {
+                block_avx2<true>(param, state, out, n);
+            } else {
+                block_avx2<false>(param, state, out, n);
+            }
+            return;
+#endif
+#if HAVE_AVX512F
+        case kernel_avx512:
+            if (param.dsfmt) {
+                block_avx512<true>(param, state, out, n);
+            } else {
+                block_avx512<false>(param, state, out, n);
+            }
+            return;
+#endif
+        default:
+            break;
+        }
+        if (param.bits == 256) {
+            if (param.dsfmt) {
+                block_generic<w256_t, true>(param, state, out, n);
+            } else {
+                block_generic<w256_t, false>(param, state, out, n);
+            }
+        } else {
+            if (param.dsfmt) {
+                block_generic<w512_t, true>(param, state, out, n);
+            } else {
+                block_generic<w512_t, false>(param, state, out, n);
+            }
+        }
+    }
+
+    void RuntimeGenerator::next(uint64_t * out)
+    {
+        const int lanes = param.bits / 64;
+        if (index >= param.size) {
+            block(reinterpret_cast<unsigned char *>(state), param.size);
+            index = 0;
+        }
+        memcpy(out, state + index * lanes, lanes * 8);
+        index++;
+    }
+
+    void RuntimeGenerator::fill(void * out, size_t n)
+    {
+        const size_t b = param.bits / 8;
+        const size_t sz = param.size;
+        unsigned char * p = static_cast<unsigned char *>(out);
+        while (n > 0 && index < param.size) {
+            memcpy(p, state + index * (b / 8), b);
+            index++;
+            p += b;
+            n--;
+        }
+        if (n >= sz) {
+            // straight into out, state becomes the last size outputs
+            block(p, n);
+            return;
+        }
+        while (n > 0) {
+            next(reinterpret_cast<uint64_t *>(p));
+            p += b;
+            n--;
+        }
+    }
+
+    void RuntimeGenerator::fill_double(double * out, size_t n)
+    {
+        const size_t lanes = param.bits / 64;
+        if (!param.dsfmt || n % lanes != 0) {
+            throw new std::logic_error("fill_double needs dSFMT and"
+                                       " multiple of lanes");
+        }
+        fill(out, n / lanes);
+        uint64_t * p = reinterpret_cast<uint64_t *>(out);
+        for (size_t i = 0; i < n; i++) {
+            uint64_t x;
+            memcpy(&x, p + i, 8);
+            x |= UINT64_C(0x3ff0000000000000);
+            memcpy(p + i, &x, 8);
+        }
+    }
+}
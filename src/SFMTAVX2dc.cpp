@@ -5,18 +5,50 @@
 
 #include "devavxprng.h"
 #include "SFMTAVX2search.hpp"
+#include "DCOptions.hpp"
+#include "MexpDispatch.hpp"
 #include "SFMTAVXdc.hpp"
 
+using namespace MTToolBox;
+
+namespace {
+    enum {fixed_sl1 = 19, fixed_sr1 = 7, fixed_perm = 1};
+
+    /**
+     * search by the generator specialized for mexp, and for shift and
+     * permutation parameters if they are fixed to the default values.
+     */
+    class dc_search {
+    public:
+        dc_search(DCOptions& opt, bool fixed) : opt(opt), fixed(fixed) {
+        }
+
+        template<int MEXP>
+        int run() {
+            typedef SFMTAVX2_T<fixed_sl1, fixed_sr1, fixed_perm, MEXP>
+                fixed_gen;
+            typedef SFMTAVX2_T<0, 0, 0, MEXP> gen;
+            if (fixed) {
+                return sfmtavx_search<w256_t, fixed_gen, 256>(opt, opt.count);
+            }
+            return sfmtavx_search<w256_t, gen, 256>(opt, opt.count);
+        }
+    private:
+        DCOptions& opt;
+        bool fixed;
+    };
+}
+
 int main(int argc, char** argv) {
-    using namespace MTToolBox;
     DCOptions opt(607);
     opt.useSR1 = true;
-    opt.fixedSL1 = 19;
-    opt.fixedSR1 = 7;
-    opt.fixedPerm = 1;
+    opt.fixedSL1 = fixed_sl1;
+    opt.fixedSR1 = fixed_sr1;
+    opt.fixedPerm = fixed_perm;
     bool parse = opt.parse(argc, argv);
     if (!parse) {
         return -1;
     }
-    return sfmtavx_search<w256_t, SFMTAVX2, 256>(opt, opt.count);
+    dc_search s(opt, opt.allFixed(fixed_sl1, fixed_sr1, fixed_perm));
+    return dispatch_mexp<607>(opt.mexp, s);
 }
@@ -1,17 +1,37 @@
 #include "devavxprng.h"
 #include "SFMTAVX2search.hpp"
 #include "EQOptions.hpp"
+#include "MexpDispatch.hpp"
 #include "SFMTAVXeq.hpp"
 
 using namespace MTToolBox;
 
+namespace {
+    /**
+     * calculate equidistribution by the generator specialized for mexp.
+     */
+    class equidistribution {
+    public:
+        equidistribution(EQOptions<SFMTAVX2_param>& opt) : opt(opt) {
+        }
+
+        template<int MEXP>
+        int run() {
+            typedef SFMTAVX2_T<0, 0, 0, MEXP> gen;
+            return sfmtavx_equidistribution<w256_t, gen, SFMTAVX2_param,
+                                            256>(opt);
+        }
+    private:
+        EQOptions<SFMTAVX2_param>& opt;
+    };
+}
+
 int main(int argc, char * argv[])
 {
     EQOptions<SFMTAVX2_param> opt;
     if (!opt.parse(argc, argv)) {
         return -1;
     }
-    int r
-        = sfmtavx_equidistribution<w256_t, SFMTAVX2, SFMTAVX2_param, 256>(opt);
-    return r;
+    equidistribution eq(opt);
+    return dispatch_mexp<607>(opt.params.mexp, eq);
 }
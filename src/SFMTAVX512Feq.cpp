@@ -1,18 +1,37 @@
 #include "devavxprng.h"
 #include "SFMTAVX512Fsearch.hpp"
 #include "EQOptions.hpp"
+#include "MexpDispatch.hpp"
 #include "SFMTAVXeq.hpp"
 
 using namespace MTToolBox;
 
+namespace {
+    /**
+     * calculate equidistribution by the generator specialized for mexp.
+     */
+    class equidistribution {
+    public:
+        equidistribution(EQOptions<SFMTAVX512F_param>& opt) : opt(opt) {
+        }
+
+        template<int MEXP>
+        int run() {
+            typedef SFMTAVX512F_T<0, 0, 0, MEXP> gen;
+            return sfmtavx_equidistribution<w512_t, gen, SFMTAVX512F_param,
+                                            512>(opt);
+        }
+    private:
+        EQOptions<SFMTAVX512F_param>& opt;
+    };
+}
+
 int main(int argc, char * argv[])
 {
     EQOptions<SFMTAVX512F_param> opt;
     if (!opt.parse(argc, argv)) {
         return -1;
     }
-    int r
-        = sfmtavx_equidistribution<w512_t, SFMTAVX512F,
-                                   SFMTAVX512F_param, 512>(opt);
-    return r;
+    equidistribution eq(opt);
+    return dispatch_mexp<1279>(opt.params.mexp, eq);
 }
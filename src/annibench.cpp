@@ -0,0 +1,95 @@
+/**
+ * @file annibench.cpp
+ *
+ * @brief compare annihilate() of MTToolBox with window_annihilate()
+ *
+ * For each mexp from 607 to 19937, a generator with random parameters
+ * and a random polynomial of degree bitSize(), as large as those of
+ * calc_fixpoint(), are made. Both routines are applied to copies of
+ * the generator, the results are compared, and times are printed.
+ */
+
+#include "devavxprng.h"
+#include "SFMTAVX2search.hpp"
+#include "SFMTAVX512Fsearch.hpp"
+#include "dSFMTAVX2search.hpp"
+#include "dSFMTAVX512Fsearch.hpp"
+#include "PolynomialEvaluation.hpp"
+#include "AnniBenchOptions.hpp"
+#include <MTToolBox/MersenneTwister.hpp>
+#include <MTToolBox/period.hpp>
+#include <NTL/GF2X.h>
+#include <chrono>
+
+using namespace MTToolBox;
+using namespace NTL;
+
+namespace {
+    const int mexps[] = {607, 1279, 2281, 4253, 11213, 19937};
+
+    /**
+     * @return false if results are different
+     */
+    template<typename G, typename U>
+    bool bench(const AnniBenchOptions& opt)
+    {
+        using namespace std;
+        using namespace std::chrono;
+        MersenneTwister mt(opt.seed);
+        SetSeed(ZZ(opt.seed));
+        cout << "mexp, degree, window, annihilate(ms), "
+             << "window_annihilate(ms)" << endl;
+        bool same = true;
+        for (size_t i = 0; i < sizeof(mexps) / sizeof(mexps[0]); i++) {
+            G g(mexps[i]);
+            g.setUpParam(mt);
+            U seed;
+            setZero(seed);
+            seed.u64[0] = mt.generate();
+            g.seed(seed);
+            for (int r = 0; r < opt.repeat; r++) {
+                GF2X poly;
+                random(poly, g.bitSize());
+                SetCoeff(poly, g.bitSize());
+                G old(g);
+                G win(g);
+                auto start = steady_clock::now();
+                annihilate<U>(&old, poly);
+                auto middle = steady_clock::now();
+                window_annihilate(&win, poly);
+                auto end = steady_clock::now();
+                old.add(&win);
+                if (!old.isZero()) {
+                    cout << "results differ: " << g.getParamString()
+                         << endl;
+                    same = false;
+                }
+                cout << dec << mexps[i] << ", " << deg(poly) << ", "
+                     << horner_window(deg(poly)) << ", "
+                     << duration_cast<milliseconds>(middle - start).count()
+                     << ", "
+                     << duration_cast<milliseconds>(end - middle).count()
+                     << endl;
+            }
+        }
+        return same;
+    }
+}
+
+int main(int argc, char** argv) {
+    AnniBenchOptions opt;
+    if (!opt.parse(argc, argv)) {
+        return -1;
+    }
+    bool same;
+    if (opt.type == "SFMTAVX2") {
+        same = bench<SFMTAVX2, w256_t>(opt);
+    } else if (opt.type == "SFMTAVX512F") {
+        same = bench<SFMTAVX512F, w512_t>(opt);
+    } else if (opt.type == "dSFMTAVX2") {
+        same = bench<dSFMTAVX2, w256_t>(opt);
+    } else {
+        same = bench<dSFMTAVX512F, w512_t>(opt);
+    }
+    return same ? 0 : -1;
+}
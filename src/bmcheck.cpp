@@ -0,0 +1,154 @@
+/**
+ * @file bmcheck.cpp
+ *
+ * @brief compare bitsliced_berlekamp_massey() with Berlekamp-Massey
+ * of one sequence, for make check
+ *
+ * 64 sequences are made by linear feedback shift registers of random
+ * degrees, taps and seeds, some of them zero, and random sequences.
+ * Linear complexity and connection polynomial of each lane must be
+ * same as those by the textbook algorithm applied to the lane alone.
+ */
+
+#include "devavxprng.h"
+#include "BitslicedMinPoly.hpp"
+#include <iostream>
+#include <random>
+
+using namespace MTToolBox;
+
+namespace {
+    const uint64_t check_seed = 1234;
+    const int rounds = 20;
+    const int max_degree = 300;
+
+    /*
+     * Berlekamp-Massey algorithm of one sequence.
+     * @param[out] c connection polynomial of max_degree + 1 terms
+     * @return linear complexity
+     */
+    int berlekamp_massey(std::vector<int>& c, const std::vector<int>& s,
+                         int max_degree)
+    {
+        using namespace std;
+        int cap = max_degree + 1;
+        c.assign(cap, 0);
+        vector<int> b(cap, 0);
+        c[0] = 1;
+        b[0] = 1;
+        int L = 0;
+        int m = 1;
+        for (int n = 0; n < static_cast<int>(s.size()); n++) {
+            int d = s[n];
+            for (int i = 1; i <= L && i <= n && i < cap; i++) {
+                d ^= c[i] & s[n - i];
+            }
+            if (d == 0) {
+                m++;
+                continue;
+            }
+            vector<int> t(c);
+            for (int j = 0; j + m < cap; j++) {
+                c[j + m] ^= b[j];
+            }
+            if (2 * L <= n) {
+                L = n + 1 - L;
+                b = t;
+                m = 1;
+            } else {
+                m++;
+            }
+        }
+        return L;
+    }
+
+    /*
+     * bit l of seq[n] is n-th term of lane l. Random lanes are made
+     * only if \b random is true.
+     */
+    void make_sequences(std::vector<uint64_t>& seq, std::mt19937_64& mt,
+                        int length, int degree, bool random)
+    {
+        using namespace std;
+        seq.assign(length, 0);
+        for (int l = 0; l < 64; l++) {
+            int kind = mt() % 8;
+            if (kind == 0) {
+                continue; // zero sequence
+            }
+            vector<int> s(length);
+            if (kind == 1 && random) {
+                for (int n = 0; n < length; n++) {
+                    s[n] = mt() & 1;
+                }
+            } else {
+                int d = 1 + mt() % degree;
+                vector<int> taps(d);
+                for (int i = 0; i < d; i++) {
+                    taps[i] = mt() & 1;
+                    s[i] = mt() & 1;
+                }
+                taps[d - 1] = 1;
+                for (int n = d; n < length; n++) {
+                    int x = 0;
+                    for (int i = 0; i < d; i++) {
+                        x ^= taps[i] & s[n - 1 - i];
+                    }
+                    s[n] = x;
+                }
+            }
+            for (int n = 0; n < length; n++) {
+                seq[n] |= static_cast<uint64_t>(s[n]) << l;
+            }
+        }
+    }
+
+    bool check(int length, int degree, int max_degree, bool random)
+    {
+        using namespace std;
+        mt19937_64 mt(check_seed + length);
+        for (int r = 0; r < rounds; r++) {
+            vector<uint64_t> seq;
+            make_sequences(seq, mt, length, degree, random);
+            vector<uint64_t> c;
+            int L[64];
+            bitsliced_berlekamp_massey(c, L, &seq[0], length, max_degree);
+            for (int l = 0; l < 64; l++) {
+                vector<int> s(length);
+                for (int n = 0; n < length; n++) {
+                    s[n] = (seq[n] >> l) & 1;
+                }
+                vector<int> c1;
+                int L1 = berlekamp_massey(c1, s, max_degree);
+                if (L[l] != L1) {
+                    return false;
+                }
+                for (int j = 0; j <= max_degree; j++) {
+                    if (static_cast<int>((c[j] >> l) & 1) != c1[j]) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    bool report(const char * name, bool ok)
+    {
+        using namespace std;
+        cout << name << ": " << (ok ? "ok" : "NG") << endl;
+        return ok;
+    }
+}
+
+int main() {
+    bool ok = true;
+    // as getLCMPoly(): 2 * max_degree terms of complexity <= max_degree
+    ok = report("bitsliced Berlekamp-Massey",
+                check(2 * max_degree, max_degree, max_degree, false)) && ok;
+    // random lanes may exceed max_degree, so no term is dropped
+    ok = report("bitsliced Berlekamp-Massey, random",
+                check(2 * max_degree, max_degree, 2 * max_degree, true))
+        && ok;
+    return ok ? 0 : 1;
+}
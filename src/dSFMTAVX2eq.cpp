@@ -1,18 +1,37 @@
 #include "devavxprng.h"
 #include "dSFMTAVX2search.hpp"
 #include "EQOptions.hpp"
+#include "MexpDispatch.hpp"
 #include "dSFMTAVXeq.hpp"
 
 using namespace MTToolBox;
 
+namespace {
+    /**
+     * calculate equidistribution by the generator specialized for mexp.
+     */
+    class equidistribution {
+    public:
+        equidistribution(EQOptions<dSFMTAVX2_param>& opt) : opt(opt) {
+        }
+
+        template<int MEXP>
+        int run() {
+            typedef dSFMTAVX2_T<0, 0, MEXP> gen;
+            return dsfmtavx_equidistribution<w256_t, gen, dSFMTAVX2_param,
+                                             256>(opt);
+        }
+    private:
+        EQOptions<dSFMTAVX2_param>& opt;
+    };
+}
+
 int main(int argc, char * argv[])
 {
     EQOptions<dSFMTAVX2_param> opt;
     if (!opt.parse(argc, argv)) {
         return -1;
     }
-    int r
-        = dsfmtavx_equidistribution<w256_t, dSFMTAVX2,
-                                    dSFMTAVX2_param, 256>(opt);
-    return r;
+    equidistribution eq(opt);
+    return dispatch_mexp<607>(opt.params.mexp, eq);
 }
@@ -5,18 +5,47 @@
 #include "devavxprng.h"
 #include "dSFMTAVX512Fsearch.hpp"
 #include "DCOptions.hpp"
+#include "MexpDispatch.hpp"
 #include "dSFMTAVXdc.hpp"
 
 using namespace MTToolBox;
 
+namespace {
+    enum {fixed_sl1 = 45, fixed_perm = 1};
+
+    /**
+     * search by the generator specialized for mexp, and for shift and
+     * permutation parameters if they are fixed to the default values.
+     */
+    class dc_search {
+    public:
+        dc_search(DCOptions& opt, bool fixed) : opt(opt), fixed(fixed) {
+        }
+
+        template<int MEXP>
+        int run() {
+            typedef dSFMTAVX512F_T<fixed_sl1, fixed_perm, MEXP> fixed_gen;
+            typedef dSFMTAVX512F_T<0, 0, MEXP> gen;
+            if (fixed) {
+                return dsfmtavx_search<w512_t, fixed_gen, 512>(opt, opt.count);
+            }
+            return dsfmtavx_search<w512_t, gen, 512>(opt, opt.count);
+        }
+    private:
+        DCOptions& opt;
+        bool fixed;
+    };
+}
+
 int main(int argc, char** argv) {
     DCOptions opt(1279);
     opt.useSR1 = false;
-    opt.fixedSL1 = 45;
-    opt.fixedPerm = 1;
+    opt.fixedSL1 = fixed_sl1;
+    opt.fixedPerm = fixed_perm;
     bool parse = opt.parse(argc, argv);
     if (!parse) {
         return -1;
     }
-    return dsfmtavx_search<w512_t, dSFMTAVX512F, 512>(opt, opt.count);
+    dc_search s(opt, opt.allFixed(fixed_sl1, 0, fixed_perm));
+    return dispatch_mexp<1279>(opt.mexp, s);
 }
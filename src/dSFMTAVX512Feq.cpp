@@ -1,18 +1,37 @@
 #include "devavxprng.h"
 #include "dSFMTAVX512Fsearch.hpp"
 #include "EQOptions.hpp"
+#include "MexpDispatch.hpp"
 #include "dSFMTAVXeq.hpp"
 
 using namespace MTToolBox;
 
+namespace {
+    /**
+     * calculate equidistribution by the generator specialized for mexp.
+     */
+    class equidistribution {
+    public:
+        equidistribution(EQOptions<dSFMTAVX512F_param>& opt) : opt(opt) {
+        }
+
+        template<int MEXP>
+        int run() {
+            typedef dSFMTAVX512F_T<0, 0, MEXP> gen;
+            return dsfmtavx_equidistribution<w512_t, gen, dSFMTAVX512F_param,
+                                             512>(opt);
+        }
+    private:
+        EQOptions<dSFMTAVX512F_param>& opt;
+    };
+}
+
 int main(int argc, char * argv[])
 {
     EQOptions<dSFMTAVX512F_param> opt;
     if (!opt.parse(argc, argv)) {
         return -1;
     }
-    int r
-        = dsfmtavx_equidistribution<w512_t, dSFMTAVX512F,
-                                   dSFMTAVX512F_param, 512>(opt);
-    return r;
+    equidistribution eq(opt);
+    return dispatch_mexp<1279>(opt.params.mexp, eq);
 }
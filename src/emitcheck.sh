@@ -0,0 +1,72 @@
+#!/bin/sh
+#
+# emitcheck.sh
+#
+# run known answer tests and benchmarks emitted by emitgen, for make
+# check.
+#
+# For each type of generator, emitgen writes the generator, the known
+# answer test and the benchmark of one parameter set of a small mexp
+# into emitcheck.tmp. They are compiled by $CC and run, the benchmark
+# for a few rounds only. Types which the compiler or the CPU can't run
+# are skipped, and the script exits with 77 (skip) if no type can run.
+#
+# Parameters need not give the maximal period, the known answer test
+# compares the emitted code with generate() of the search class.
+
+CC=${CC:-cc}
+dir=emitcheck.tmp
+rm -rf $dir
+mkdir $dir || exit 1
+
+# can_run feature flag
+can_run() {
+    cat > $dir/probe.c <<EOF
+int main(void)
+{
+    __builtin_cpu_init();
+    return !__builtin_cpu_supports("$1");
+}
+EOF
+    $CC $2 -o $dir/probe $dir/probe.c > /dev/null 2>&1 && $dir/probe
+}
+
+# check type feature flag line
+check() {
+    if ! can_run $2 $3; then
+        echo "$1: SKIP"
+        return 77
+    fi
+    echo "$4" | ./emitgen -t $1 -o $dir -c 100 || return 1
+    name=`echo $1 | tr 'A-Z' 'a-z'`_`echo "$4" | cut -d, -f1`_0
+    $CC -O2 $3 -I$dir -o $dir/${name}_kat $dir/${name}_kat.c || return 1
+    $CC -O2 $3 -I$dir -o $dir/${name}_bench $dir/${name}_bench.c || return 1
+    $dir/${name}_kat || return 1
+    $dir/${name}_bench 10 || return 1
+}
+
+m4=dfffffefddfecb7f.bffaffff7bfffdff.ffbfffffeffffffb.aff3ef3fb5ffff7f
+d4=000fffefddfecb7f.000affff7bfffdff.000fffffeffffffb.0003ef3fb5ffff7f
+f4=0000000000000000.0000000000000000.0000000000000000.0000000000000000
+p4=0000000000000000.0000000000000000.0000000000000000.0000000000000001
+m8=$m4.$m4
+d8=$d4.$d4
+f8=$f4.$f4
+p8=$f4.$p4
+
+status=77
+for t in "SFMTAVX2 avx2 -mavx2 1279,3,19,7,1,$m4,$p4," \
+         "SFMTAVX512F avx512f -mavx512f 1279,1,19,7,3,$m8,$p8," \
+         "dSFMTAVX2 avx2 -mavx2 1279,3,19,1,$d4,$f4,$p4," \
+         "dSFMTAVX512F avx512f -mavx512f 1279,1,19,3,$d8,$f8,$p8,"
+do
+    check $t
+    r=$?
+    if [ $r -eq 1 ]; then
+        echo "$t: NG"
+        status=1
+    elif [ $r -eq 0 ] && [ $status -eq 77 ]; then
+        status=0
+    fi
+done
+exit $status
@@ -0,0 +1,185 @@
+/**
+ * @file emitgen.cpp
+ *
+ * @brief emit C generators from parameters found by dc tools
+ *
+ * For each parameter line, three files are written to the output
+ * directory: name.h, the generator, name_bench.c, the throughput
+ * benchmark, and name_kat.c, the known answer test.
+ */
+
+#include "devavxprng.h"
+#include "SFMTAVX2search.hpp"
+#include "SFMTAVX512Fsearch.hpp"
+#include "dSFMTAVX2search.hpp"
+#include "dSFMTAVX512Fsearch.hpp"
+#include "PeriodCertification.hpp"
+#include "CodeEmitter.hpp"
+#include "EmitOptions.hpp"
+#include <vector>
+#include <fstream>
+
+using namespace MTToolBox;
+
+namespace {
+    template<typename U>
+    std::vector<uint64_t> lanes(const U& x) {
+        return std::vector<uint64_t>(x.u64, x.u64 + sizeof(U) / 8);
+    }
+
+    /*
+     * mix_words follows seed() of each search class, SFMTAVX512F does
+     * not mix the lung.
+     */
+    void param_spec(emit_spec& spec, const SFMTAVX2_param& p) {
+        spec.bits = 256;
+        spec.dsfmt = false;
+        spec.sr1 = p.sr1;
+        spec.mask = lanes(p.mat1);
+        spec.parity = lanes(p.parity1);
+        spec.mix_words = (spec.n + 1) * 8;
+    }
+
+    void param_spec(emit_spec& spec, const SFMTAVX512F_param& p) {
+        spec.bits = 512;
+        spec.dsfmt = false;
+        spec.sr1 = p.sr1;
+        spec.mask = lanes(p.mat1);
+        spec.parity = lanes(p.parity1);
+        spec.mix_words = spec.n * 16;
+    }
+
+    void param_spec(emit_spec& spec, const dSFMTAVX2_param& p) {
+        spec.bits = 256;
+        spec.dsfmt = true;
+        spec.sr1 = 12;
+        spec.mask = lanes(p.msk1);
+        spec.parity = lanes(p.parity1);
+        spec.mix_words = (spec.n + 1) * 4;
+    }
+
+    void param_spec(emit_spec& spec, const dSFMTAVX512F_param& p) {
+        spec.bits = 512;
+        spec.dsfmt = true;
+        spec.sr1 = 12;
+        spec.mask = lanes(p.msk1);
+        spec.parity = lanes(p.parity1);
+        spec.mix_words = (spec.n + 1) * 8;
+    }
+
+    template<typename U>
+    std::vector<uint64_t> seed_words(const U& seed, bool dsfmt) {
+        if (dsfmt) {
+            return lanes(seed);
+        }
+        std::vector<uint64_t> words;
+        for (size_t i = 0; i < sizeof(U) / 4; i++) {
+            words.push_back(seed.u[i]);
+        }
+        return words;
+    }
+
+    bool write_file(const std::string& path, const CodeEmitter& emitter,
+                    void (CodeEmitter::*emit)(std::ostream&) const,
+                    bool verbose) {
+        using namespace std;
+        ofstream ofs(path.c_str());
+        (emitter.*emit)(ofs);
+        ofs.close();
+        if (!ofs) {
+            cerr << "can't write " << path << endl;
+            return false;
+        }
+        if (verbose) {
+            cout << path << endl;
+        }
+        return true;
+    }
+
+    /**
+     * emit generator, benchmark and known answer test of a parameter
+     * set. Expected values of the test are outputs of generate() after
+     * period certification. The seed is the first one from 4357 whose
+     * lung is fixed by it, so the test also checks the fix.
+     */
+    template<typename G, typename U, typename P>
+    bool emit(const std::string& line, int line_no, const EmitOptions& opt)
+    {
+        using namespace std;
+        P param;
+        vector<char> buf(line.begin(), line.end());
+        buf.push_back(0);
+        param.readFromString(&buf[0]);
+        G gen(param);
+        emit_spec spec;
+        spec.type = opt.type;
+        stringstream ss;
+        ss << opt.name << "_" << dec << param.mexp << "_" << line_no;
+        spec.name = ss.str();
+        spec.param_string = gen.getParamString();
+        spec.mexp = param.mexp;
+        spec.pos1 = param.pos1;
+        spec.sl1 = param.sl1;
+        spec.perm = param.perm;
+        int bits = sizeof(U) * 8;
+        if (opt.type[0] == 'd') {
+            spec.n = (gen.bitSize() - bits) / (bits / 16 * 13);
+        } else {
+            spec.n = gen.bitSize() / bits - 1;
+        }
+        param_spec(spec, param);
+        U seed;
+        setZero(seed);
+        for (seed.u64[0] = 4357; ; seed.u64[0]++) {
+            gen.seed(seed);
+            if (period_certification(gen) == 0) {
+                break;
+            }
+        }
+        spec.seed = seed_words(seed, spec.dsfmt);
+        int count = opt.kat_count;
+        if (count == 0) {
+            count = spec.n * 3 + 7;
+        }
+        for (int i = 0; i < count; i++) {
+            spec.expected.push_back(lanes(gen.generate()));
+        }
+        CodeEmitter emitter(spec);
+        string base = opt.outdir + "/" + spec.name;
+        return write_file(base + ".h", emitter, &CodeEmitter::emit_header,
+                          opt.verbose)
+            && write_file(base + "_bench.c", emitter,
+                          &CodeEmitter::emit_bench, opt.verbose)
+            && write_file(base + "_kat.c", emitter, &CodeEmitter::emit_kat,
+                          opt.verbose);
+    }
+}
+
+int main(int argc, char** argv) {
+    using namespace std;
+    EmitOptions opt;
+    if (!opt.parse(argc, argv)) {
+        return -1;
+    }
+    string line;
+    int line_no = 0;
+    bool ok = true;
+    while (ok && getline(cin, line)) {
+        if (line.empty() || line[0] < '0' || line[0] > '9') {
+            continue;
+        }
+        if (opt.type == "SFMTAVX2") {
+            ok = emit<SFMTAVX2, w256_t, SFMTAVX2_param>(line, line_no, opt);
+        } else if (opt.type == "SFMTAVX512F") {
+            ok = emit<SFMTAVX512F, w512_t, SFMTAVX512F_param>(
+                line, line_no, opt);
+        } else if (opt.type == "dSFMTAVX2") {
+            ok = emit<dSFMTAVX2, w256_t, dSFMTAVX2_param>(line, line_no, opt);
+        } else {
+            ok = emit<dSFMTAVX512F, w512_t, dSFMTAVX512F_param>(
+                line, line_no, opt);
+        }
+        line_no++;
+    }
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,195 @@
+/**
+ * @file eqcheck.cpp
+ *
+ * @brief compare k(v) of all v by one lattice with k(v) of each v,
+ * for make check
+ *
+ * For each type of generator, generators with random parameters of a
+ * small mexp are made, and check_SIMD_all_equidist() and
+ * check_dSFMT_all_equidist() compare calc_*_all_equidist(), which the
+ * eq tools use, with calc_*_equidist() for each v, which is the
+ * algorithm of MTToolBox. calc_*_all_equidist_parallel(), which
+ * evaluates weight modes by threads, must give the same k(v).
+ * calc_*_equidistribution_bound() must give the same k(v) from
+ * v = bit_len down to the v where the sum of defects exceeds the
+ * limit, and stop there.
+ *
+ * The generators are not annihilated, because random parameters
+ * rarely have a factor of degree mexp, so bitSize() is given as the
+ * theoretical bound instead of mexp.
+ */
+
+#include "devavxprng.h"
+#include "SFMTAVX2search.hpp"
+#include "SFMTAVX512Fsearch.hpp"
+#include "dSFMTAVX2search.hpp"
+#include "dSFMTAVX512Fsearch.hpp"
+#include "AlgorithmSIMDEquidistribution.hpp"
+#include "AlgorithmDSFMTEquidistribution.hpp"
+#include <MTToolBox/MersenneTwister.hpp>
+
+using namespace MTToolBox;
+using namespace NTL;
+
+namespace {
+    const int mexp = 1279;
+    const int params = 1;
+    const uint64_t check_seed = 1234;
+    const int threads = 4;
+
+    template<typename G, typename U>
+    G random_generator(MersenneTwister& mt)
+    {
+        G g(mexp);
+        g.setUpParam(mt);
+        U seed;
+        setZero(seed);
+        seed.u64[0] = mt.generate();
+        g.seed(seed);
+        return g;
+    }
+
+    bool same(const int a[], const int b[], int bit_len)
+    {
+        for (int i = 0; i < bit_len; i++) {
+            if (a[i] != b[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*
+     * check k(v) and the sum of defects given by
+     * calc_*_equidistribution_bound() with limit \b max_delta
+     * @param full k(v) of all v
+     * @param bound k(v) by the bound, -1 if not computed
+     * @param sum return value of the bound
+     */
+    bool check_bound(const int full[], const int bound[], int bit_len,
+                     int mexp, int max_delta, int sum)
+    {
+        int partial = 0;
+        int v = bit_len;
+        for (; v > 0; v--) {
+            if (bound[v - 1] != full[v - 1]) {
+                return false;
+            }
+            partial += mexp / v - full[v - 1];
+            if (partial > max_delta) {
+                break;
+            }
+        }
+        if (sum != partial) {
+            return false;
+        }
+        for (v--; v > 0; v--) {
+            if (bound[v - 1] != -1) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int sum_of_defects(const int veq[], int bit_len, int mexp)
+    {
+        int sum = 0;
+        for (int i = 0; i < bit_len; i++) {
+            sum += mexp / (i + 1) - veq[i];
+        }
+        return sum;
+    }
+
+    template<typename G, typename U, int bitWidth>
+    bool check_sfmt(const char * type)
+    {
+        using namespace std;
+        MersenneTwister mt(check_seed);
+        bool ok = true;
+        for (int i = 0; i < params; i++) {
+            G g = random_generator<G, U>(mt);
+            SIMDInfo info;
+            info.bitSize = bitWidth;
+            info.fastMode = false;
+            int veq64[64];
+            int veq32[32];
+            int par[64];
+            info.bitMode = 64;
+            info.elementNo = bitWidth / 64;
+            bool r = check_SIMD_all_equidist<U, G>(veq64, 64, g, info,
+                                                   g.bitSize());
+            calc_SIMD_all_equidist_parallel<U, G>(par, 64, g, info,
+                                                  g.bitSize(), threads);
+            r = same(veq64, par, 64) && r;
+            DeltaBoundStats stats;
+            int sum = sum_of_defects(veq64, 64, g.bitSize());
+            int limits[] = {sum, sum / 2};
+            for (int j = 0; j < 2; j++) {
+                int b = calc_SIMD_equidistribution_bound<U, G>
+                    (g, par, 64, info, g.bitSize(), limits[j], stats);
+                r = check_bound(veq64, par, 64, g.bitSize(), limits[j], b)
+                    && r;
+            }
+            info.bitMode = 32;
+            info.elementNo = bitWidth / 32;
+            r = check_SIMD_all_equidist<U, G>(veq32, 32, g, info,
+                                              g.bitSize()) && r;
+            calc_SIMD_all_equidist_parallel<U, G>(par, 32, g, info,
+                                                  g.bitSize(), threads);
+            r = same(veq32, par, 32) && r;
+            cout << type << " " << g.getParamString() << ": "
+                 << (r ? "ok" : "NG") << endl;
+            ok = ok && r;
+        }
+        return ok;
+    }
+
+    template<typename G, typename U, int bitWidth>
+    bool check_dsfmt(const char * type)
+    {
+        using namespace std;
+        MersenneTwister mt(check_seed);
+        bool ok = true;
+        for (int i = 0; i < params; i++) {
+            G g = random_generator<G, U>(mt);
+            DSFMTInfo info;
+            info.bitSize = bitWidth;
+            info.elementNo = bitWidth / 64;
+            int veq52[52];
+            int par[52];
+            bool r = check_dSFMT_all_equidist<U, G>(veq52, 52, g, info,
+                                                    g.bitSize());
+            calc_dSFMT_all_equidist_parallel<U, G>(par, 52, g, info,
+                                                   g.bitSize(), threads);
+            r = same(veq52, par, 52) && r;
+            DeltaBoundStats stats;
+            int sum = sum_of_defects(veq52, 52, g.bitSize());
+            int limits[] = {sum, sum / 2};
+            for (int j = 0; j < 2; j++) {
+                int b = calc_dSFMT_equidistribution_bound<U, G>
+                    (g, par, 52, info, g.bitSize(), limits[j], stats);
+                r = check_bound(veq52, par, 52, g.bitSize(), limits[j], b)
+                    && r;
+            }
+            cout << type << " " << g.getParamString() << ": "
+                 << (r ? "ok" : "NG") << endl;
+            ok = ok && r;
+        }
+        return ok;
+    }
+}
+
+int main() {
+    using namespace std;
+    bool ok = true;
+    try {
+        ok = check_sfmt<SFMTAVX2, w256_t, 256>("SFMTAVX2") && ok;
+        ok = check_sfmt<SFMTAVX512F, w512_t, 512>("SFMTAVX512F") && ok;
+        ok = check_dsfmt<dSFMTAVX2, w256_t, 256>("dSFMTAVX2") && ok;
+        ok = check_dsfmt<dSFMTAVX512F, w512_t, 512>("dSFMTAVX512F") && ok;
+    } catch (std::exception * e) {
+        cerr << e->what() << endl;
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
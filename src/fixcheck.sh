@@ -0,0 +1,25 @@
+#!/bin/sh
+#
+# fixcheck.sh
+#
+# search dSFMTAVX2 parameter sets of a small mexp with --fixpoint
+# check, for make check.
+#
+# Each fix point is computed by polynomials and by the linear equation
+# of GF2Matrix, and dSFMTAVX2dc prints "differ" when period
+# certification by the two fix points is not same.
+
+out=fixcheck.tmp
+./dSFMTAVX2dc -s 1234 -c 2 --fixpoint check 607 > $out || exit 1
+if grep differ $out > /dev/null; then
+    cat $out
+    echo "fixpoint check: NG"
+    exit 1
+fi
+if [ `grep -c '^607,' $out` -ne 2 ]; then
+    cat $out
+    echo "fixpoint check: NG"
+    exit 1
+fi
+echo "fixpoint check: ok"
+rm -f $out
@@ -0,0 +1,147 @@
+/**
+ * @file gf2check.cpp
+ *
+ * @brief check GF2Matrix::solve(), for make check
+ *
+ * Random matrices of sizes around the strip of eight columns and the
+ * word of 64 bits, some of them of less rank, are made with b = Mx0,
+ * and the solution x must satisfy Mx = b. A row of M which is the
+ * sum of two other rows gets b of the other parity, and then solve()
+ * must return false.
+ */
+
+#include "devavxprng.h"
+#include "GF2Matrix.hpp"
+#include <iostream>
+#include <random>
+
+using namespace MTToolBox;
+
+namespace {
+    const uint64_t check_seed = 1234;
+    const int rounds = 20;
+
+    /*
+     * rows x (n + 1) matrix of M and b = Mx0. When \b rank_drop is
+     * true, row i is the sum of two rows above it for some i.
+     */
+    void make_matrix(std::vector<std::vector<int> >& m, std::mt19937_64& mt,
+                     int rows, int n, bool rank_drop)
+    {
+        using namespace std;
+        m.assign(rows, vector<int>(n + 1, 0));
+        vector<int> x0(n);
+        for (int j = 0; j < n; j++) {
+            x0[j] = mt() & 1;
+        }
+        for (int i = 0; i < rows; i++) {
+            if (rank_drop && i >= 2 && mt() % 4 == 0) {
+                int a = mt() % i;
+                int b = mt() % i;
+                for (int j = 0; j < n; j++) {
+                    m[i][j] = m[a][j] ^ m[b][j];
+                }
+            } else {
+                for (int j = 0; j < n; j++) {
+                    m[i][j] = mt() & 1;
+                }
+            }
+            int s = 0;
+            for (int j = 0; j < n; j++) {
+                s ^= m[i][j] & x0[j];
+            }
+            m[i][n] = s;
+        }
+    }
+
+    bool solve(const std::vector<std::vector<int> >& m, int rows, int n,
+               std::vector<bool>& x)
+    {
+        GF2Matrix g(rows, n + 1);
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j <= n; j++) {
+                g.set(i, j, m[i][j] != 0);
+            }
+        }
+        return g.solve(x);
+    }
+
+    bool satisfied(const std::vector<std::vector<int> >& m, int rows, int n,
+                   const std::vector<bool>& x)
+    {
+        if (static_cast<int>(x.size()) != n) {
+            return false;
+        }
+        for (int i = 0; i < rows; i++) {
+            int s = 0;
+            for (int j = 0; j < n; j++) {
+                s ^= m[i][j] & static_cast<int>(x[j]);
+            }
+            if (s != m[i][n]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool check_solvable()
+    {
+        using namespace std;
+        mt19937_64 mt(check_seed);
+        const int sizes[] = {1, 7, 8, 9, 63, 64, 65, 200};
+        for (int s = 0; s < 8; s++) {
+            for (int r = 0; r < rounds; r++) {
+                int n = sizes[s];
+                int rows = n + static_cast<int>(mt() % 3);
+                vector<vector<int> > m;
+                make_matrix(m, mt, rows, n, r % 2 == 1);
+                vector<bool> x;
+                if (!solve(m, rows, n, x) || !satisfied(m, rows, n, x)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool check_unsolvable()
+    {
+        using namespace std;
+        mt19937_64 mt(check_seed + 1);
+        const int sizes[] = {8, 9, 64, 65, 200};
+        for (int s = 0; s < 5; s++) {
+            for (int r = 0; r < rounds; r++) {
+                int n = sizes[s];
+                int rows = n;
+                vector<vector<int> > m;
+                make_matrix(m, mt, rows, n, false);
+                int i = 2 + static_cast<int>(mt() % (rows - 2));
+                int a = static_cast<int>(mt() % i);
+                int b = (a + 1) % i;
+                for (int j = 0; j < n; j++) {
+                    m[i][j] = m[a][j] ^ m[b][j];
+                }
+                m[i][n] = m[a][n] ^ m[b][n] ^ 1;
+                vector<bool> x;
+                if (solve(m, rows, n, x)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool report(const char * name, bool ok)
+    {
+        using namespace std;
+        cout << name << ": " << (ok ? "ok" : "NG") << endl;
+        return ok;
+    }
+}
+
+int main() {
+    bool ok = true;
+    ok = report("GF2Matrix solvable", check_solvable()) && ok;
+    ok = report("GF2Matrix unsolvable", check_unsolvable()) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file jumpcache.cpp
+ *
+ * @brief build jump polynomial file from parameters found by dc tools
+ */
+
+#include "devavxprng.h"
+#include "SFMTAVX2search.hpp"
+#include "SFMTAVX512Fsearch.hpp"
+#include "dSFMTAVX2search.hpp"
+#include "dSFMTAVX512Fsearch.hpp"
+#include "Jump.hpp"
+#include "JumpCache.hpp"
+#include "JumpCacheOptions.hpp"
+#include <vector>
+#include <chrono>
+
+using namespace MTToolBox;
+using namespace NTL;
+
+namespace {
+    /**
+     * add characteristic polynomial and x^(2^k) for k = 0 to max_k
+     * of a parameter set.
+     */
+    template<typename G, typename U, typename P>
+    void add_entries(JumpCacheWriter& writer, const std::string& line,
+                     const JumpCacheOptions& opt)
+    {
+        using namespace std;
+        using namespace std::chrono;
+        auto start = system_clock::now();
+        P param;
+        vector<char> buf(line.begin(), line.end());
+        buf.push_back(0);
+        param.readFromString(&buf[0]);
+        G gen(param);
+        U seed;
+        setZero(seed);
+        seed.u64[0] = 1;
+        gen.seed(seed);
+        GeneratorJump<G, U> jumper(gen);
+        string key = gen.getParamString();
+        const GF2X& poly = jumper.getCharacteristic();
+        writer.add(key, -1, poly);
+        GF2XModulus modulus;
+        build(modulus, poly);
+        GF2X jump_poly;
+        calc_jump_poly_pow2(jump_poly, 0, modulus);
+        for (int k = 0; k <= opt.max_k; k++) {
+            writer.add(key, k, jump_poly);
+            SqrMod(jump_poly, jump_poly, modulus);
+        }
+        if (opt.verbose) {
+            auto end = system_clock::now();
+            auto dur = end - start;
+            auto msec = duration_cast<std::chrono::milliseconds>(dur).count();
+            cout << key << endl;
+            cout << "deg = " << dec << deg(poly)
+                 << " time = " << dec << msec << "ms" << endl;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    using namespace std;
+    JumpCacheOptions opt;
+    if (!opt.parse(argc, argv)) {
+        return -1;
+    }
+    JumpCacheWriter writer;
+    string line;
+    int count = 0;
+    try {
+        while (getline(cin, line)) {
+            if (line.empty() || line[0] < '0' || line[0] > '9') {
+                continue;
+            }
+            if (opt.type == "SFMTAVX2") {
+                add_entries<SFMTAVX2, w256_t, SFMTAVX2_param>(
+                    writer, line, opt);
+            } else if (opt.type == "SFMTAVX512F") {
+                add_entries<SFMTAVX512F, w512_t, SFMTAVX512F_param>(
+                    writer, line, opt);
+            } else if (opt.type == "dSFMTAVX2") {
+                add_entries<dSFMTAVX2, w256_t, dSFMTAVX2_param>(
+                    writer, line, opt);
+            } else {
+                add_entries<dSFMTAVX512F, w512_t, dSFMTAVX512F_param>(
+                    writer, line, opt);
+            }
+            count++;
+        }
+        writer.write(opt.path);
+    } catch (std::exception * e) {
+        cerr << e->what() << endl;
+        return -1;
+    }
+    if (opt.verbose) {
+        cout << dec << count << " parameters written to " << opt.path
+             << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,179 @@
+/**
+ * @file jumpcheck.cpp
+ *
+ * @brief compare jump ahead with stepping by next_state(), for make check
+ *
+ * For some small mexps and each type of generator, a generator with
+ * random parameters is made, and check_jump() compares jump() and
+ * jump_pow2() with up to max_steps calls of next_state().
+ *
+ * The polynomials of the generators are written to a jump cache file
+ * as jumpcache does, and read back by JumpCache. GeneratorJump made
+ * from the file must jump as stepping does, and files cut short must
+ * be rejected.
+ */
+
+#include "devavxprng.h"
+#include "SFMTAVX2search.hpp"
+#include "SFMTAVX512Fsearch.hpp"
+#include "dSFMTAVX2search.hpp"
+#include "dSFMTAVX512Fsearch.hpp"
+#include "Jump.hpp"
+#include "JumpCache.hpp"
+#include <MTToolBox/MersenneTwister.hpp>
+#include <vector>
+#include <fstream>
+
+using namespace MTToolBox;
+using namespace NTL;
+
+namespace {
+    const int mexps[] = {1279, 2281, 4253};
+    const int max_steps = 300;
+    // 2^cache_k <= max_steps, so that check_jump() uses all entries
+    const int cache_k = 8;
+    const uint64_t check_seed = 1234;
+
+    /*
+     * add characteristic polynomial and x^(2^k) for k = 0 to cache_k
+     * of \b g, as jumpcache does.
+     */
+    template<typename G, typename U>
+    void add_entries(JumpCacheWriter& writer, const G& g,
+                     const GeneratorJump<G, U>& jumper)
+    {
+        using namespace std;
+        G tmp(g);
+        string key = tmp.getParamString();
+        const GF2X& poly = jumper.getCharacteristic();
+        writer.add(key, -1, poly);
+        GF2XModulus modulus;
+        build(modulus, poly);
+        GF2X jump_poly;
+        calc_jump_poly_pow2(jump_poly, 0, modulus);
+        for (int k = 0; k <= cache_k; k++) {
+            writer.add(key, k, jump_poly);
+            SqrMod(jump_poly, jump_poly, modulus);
+        }
+    }
+
+    /*
+     * find() must give polynomials written, and GeneratorJump made
+     * from the file must jump as stepping does.
+     */
+    template<typename G, typename U>
+    bool check_cache(const char * type, const std::vector<G>& gens,
+                     const std::vector<GF2X>& polys,
+                     const std::string& path)
+    {
+        using namespace std;
+        JumpCache cache(path);
+        bool ok = cache.size() == int(gens.size()) * (cache_k + 2);
+        GF2X poly;
+        ok = !cache.find(poly, "no such parameter", -1) && ok;
+        for (size_t i = 0; i < gens.size(); i++) {
+            G tmp(gens[i]);
+            string key = tmp.getParamString();
+            bool r = cache.find(poly, key, -1) && poly == polys[i];
+            r = cache.max_k(key) == cache_k && r;
+            r = !cache.find(poly, key, cache_k + 1) && r;
+            // shorter and longer keys must not match
+            r = !cache.find(poly, key.substr(0, key.size() - 1), -1) && r;
+            r = !cache.find(poly, key + "0", -1) && r;
+            GeneratorJump<G, U> jumper(gens[i], cache);
+            r = jumper.getCharacteristic() == polys[i] && r;
+            r = check_jump(jumper, gens[i], max_steps) && r;
+            cout << type << " mexp = " << dec << mexps[i]
+                 << " cache: " << (r ? "ok" : "NG") << endl;
+            ok = ok && r;
+        }
+        return ok;
+    }
+
+    /*
+     * JumpCache must reject first \b length bytes of \b path.
+     */
+    bool check_truncated(const std::string& path, size_t length)
+    {
+        using namespace std;
+        ifstream ifs(path.c_str(), ios::in | ios::binary);
+        vector<char> bytes((istreambuf_iterator<char>(ifs)),
+                           istreambuf_iterator<char>());
+        if (length > bytes.size()) {
+            return false;
+        }
+        string cut = path + ".cut";
+        ofstream ofs(cut.c_str(), ios::out | ios::binary | ios::trunc);
+        ofs.write(&bytes[0], length);
+        ofs.close();
+        bool rejected = false;
+        try {
+            JumpCache cache(cut);
+        } catch (std::runtime_error * e) {
+            delete e;
+            rejected = true;
+        }
+        remove(cut.c_str());
+        return rejected;
+    }
+
+    template<typename G, typename U>
+    bool check(const char * type)
+    {
+        using namespace std;
+        MersenneTwister mt(check_seed);
+        bool ok = true;
+        JumpCacheWriter writer;
+        vector<G> gens;
+        vector<GF2X> polys;
+        for (size_t i = 0; i < sizeof(mexps) / sizeof(mexps[0]); i++) {
+            G g(mexps[i]);
+            g.setUpParam(mt);
+            U seed;
+            setZero(seed);
+            seed.u64[0] = mt.generate();
+            g.seed(seed);
+            GeneratorJump<G, U> jumper(g);
+            bool r = check_jump(jumper, g, max_steps);
+            cout << type << " mexp = " << dec << mexps[i] << ": "
+                 << (r ? "ok" : "NG") << endl;
+            if (!r) {
+                cout << g.getParamString() << endl;
+                ok = false;
+            }
+            add_entries(writer, g, jumper);
+            gens.push_back(g);
+            polys.push_back(jumper.getCharacteristic());
+        }
+        string path = string(type) + ".jumpcheck";
+        writer.write(path);
+        ok = check_cache<G, U>(type, gens, polys, path) && ok;
+        ifstream ifs(path.c_str(), ios::in | ios::binary | ios::ate);
+        size_t length = ifs.tellg();
+        ifs.close();
+        // in the header, in the table of entries and in the data,
+        // the last 8 bytes have a byte of data before the padding
+        bool r = check_truncated(path, sizeof(jump_cache_header) - 1);
+        r = check_truncated(path, sizeof(jump_cache_header)
+                            + sizeof(jump_cache_entry)) && r;
+        r = check_truncated(path, length - 8) && r;
+        cout << type << " truncated cache: " << (r ? "ok" : "NG") << endl;
+        remove(path.c_str());
+        return ok && r;
+    }
+}
+
+int main() {
+    using namespace std;
+    bool ok = true;
+    try {
+        ok = check<SFMTAVX2, w256_t>("SFMTAVX2") && ok;
+        ok = check<SFMTAVX512F, w512_t>("SFMTAVX512F") && ok;
+        ok = check<dSFMTAVX2, w256_t>("dSFMTAVX2") && ok;
+        ok = check<dSFMTAVX512F, w512_t>("dSFMTAVX512F") && ok;
+    } catch (std::exception * e) {
+        cerr << e->what() << endl;
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,39 @@
+/**
+ * @file kernelcheck.cpp
+ *
+ * @brief compare SIMD kernels with the scalar reference, for make check
+ */
+
+#include "devavxprng.h"
+#include "w256.hpp"
+#include "w512.hpp"
+#include "SIMDKernel.hpp"
+
+using namespace MTToolBox;
+
+namespace {
+    const uint64_t check_seed = 1234;
+    const int check_count = 10000;
+
+    bool report(const char * name, bool ok)
+    {
+        using namespace std;
+        cout << name << ": " << (ok ? "ok" : "NG") << endl;
+        return ok;
+    }
+}
+
+int main() {
+    bool ok = true;
+    ok = report("w256_t kernels",
+                check_w256_kernels(check_seed, check_count)) && ok;
+    ok = report("w512_t kernels",
+                check_w512_kernels(check_seed, check_count)) && ok;
+#if RUNTIME_DISPATCH
+    ok = report("w256_t kernel table",
+                check_kernel_table<w256_t>(check_seed, check_count)) && ok;
+    ok = report("w512_t kernel table",
+                check_kernel_table<w512_t>(check_seed, check_count)) && ok;
+#endif
+    return ok ? 0 : 1;
+}
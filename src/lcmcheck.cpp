@@ -0,0 +1,103 @@
+/**
+ * @file lcmcheck.cpp
+ *
+ * @brief check that getLCMPoly() by threads stops early, for make check
+ *
+ * A dSFMT generator with random parameters and zero state gives
+ * zero sequences of lung, so the LCM is made from generators of one
+ * bit state. The minimal polynomial of one of them is usually the
+ * characteristic polynomial, and the LCM reaches bitSize() in the
+ * first batches. getLCMPoly() by one thread and by threads must give
+ * the same LCM, and threads must stop soon after the batch where one
+ * thread stops, instead of folding all batches. The check is skipped
+ * if no LCM reaches bitSize().
+ */
+
+#include "devavxprng.h"
+#include "dSFMTAVX2search.hpp"
+#include "dSFMTAVX512Fsearch.hpp"
+#include "Annihilate.hpp"
+#include <MTToolBox/MersenneTwister.hpp>
+
+using namespace MTToolBox;
+using namespace NTL;
+
+namespace {
+    const int mexp = 4253;
+    const int params = 10;
+    const int threads = 4;
+    const uint64_t check_seed = 1234;
+
+    /*
+     * @return number of parameter sets whose LCM reached bitSize(),
+     * -1 if the check failed
+     */
+    template<typename G, typename U>
+    int check_early_stop()
+    {
+        using namespace std;
+        MersenneTwister mt(check_seed);
+        int saturated = 0;
+        for (int i = 0; i < params; i++) {
+            G g(mexp);
+            g.setUpParam(mt);
+            g.setZero();
+            int batches = (g.bitSize() + 63) / 64;
+            Annihilate<G, U> serial(1);
+            Annihilate<G, U> parallel(threads);
+            GF2X a;
+            GF2X b;
+            serial.getLCMPoly(a, g);
+            parallel.getLCMPoly(b, g);
+            if (a != b) {
+                cout << g.getParamString() << endl;
+                return -1;
+            }
+            if (deg(a) != g.bitSize()) {
+                continue;
+            }
+            saturated++;
+            int folded = parallel.getFoldedBatches();
+            cout << "batches = " << dec << batches
+                 << " folded by one thread = " << serial.getFoldedBatches()
+                 << " by threads = " << folded << endl;
+            // threads may fold batches taken before the LCM is full
+            if (folded > serial.getFoldedBatches() + 2 * threads) {
+                cout << g.getParamString() << endl;
+                return -1;
+            }
+        }
+        return saturated;
+    }
+
+    bool report(const char * name, bool ok)
+    {
+        using namespace std;
+        cout << name << ": " << (ok ? "ok" : "NG") << endl;
+        return ok;
+    }
+}
+
+int main() {
+    using namespace std;
+    int r1;
+    int r2;
+    try {
+        r1 = check_early_stop<dSFMTAVX2, w256_t>();
+        r2 = check_early_stop<dSFMTAVX512F, w512_t>();
+    } catch (std::exception * e) {
+        cerr << e->what() << endl;
+        return 1;
+    }
+    if (r1 < 0 || r2 < 0) {
+        report("getLCMPoly early stop", false);
+        return 1;
+    }
+    if (r1 + r2 == 0) {
+        // no LCM reached bitSize(), early stop can't be checked
+        cout << "getLCMPoly early stop: SKIP" << endl;
+        return 77;
+    }
+    report("getLCMPoly early stop", true);
+    return 0;
+}
@@ -0,0 +1,172 @@
+/**
+ * @file modecheck.cpp
+ *
+ * @brief check ParallelModes.hpp, for make check
+ *
+ * Random values of pairs of start mode and weight mode are folded by
+ * parallel_mode_minmax() with several numbers of threads, and by
+ * ModeMinMax::fold(), and compared with the serial loop of
+ * calc_SIMD_equidist(), whose maximum over weight modes is not reset
+ * for each start mode. atomic_fetch_max() and atomic_fetch_min() are
+ * called by threads at once, and an exception thrown by a pair must
+ * be thrown again.
+ */
+
+#include "devavxprng.h"
+#include "ParallelModes.hpp"
+#include <iostream>
+#include <random>
+
+using namespace MTToolBox;
+
+namespace {
+    const uint64_t check_seed = 1234;
+    const int start_no = 4;
+    const int weight_no = 8;
+    const int n = 64;
+    const int rounds = 100;
+
+    void serial_minmax(const std::vector<int>& value, int veq[])
+    {
+        std::vector<int> veq_weight(n, -1);
+        for (int i = 0; i < n; i++) {
+            veq[i] = INT_MAX;
+        }
+        for (int s = 0; s < start_no; s++) {
+            for (int w = 0; w < weight_no; w++) {
+                for (int i = 0; i < n; i++) {
+                    int e = value[(s * weight_no + w) * n + i];
+                    if (e > veq_weight[i]) {
+                        veq_weight[i] = e;
+                    }
+                }
+            }
+            for (int i = 0; i < n; i++) {
+                if (veq[i] > veq_weight[i]) {
+                    veq[i] = veq_weight[i];
+                }
+            }
+        }
+    }
+
+    bool check_minmax()
+    {
+        using namespace std;
+        mt19937_64 mt(check_seed);
+        uniform_int_distribution<int> dist(0, 1000);
+        vector<int> start_modes;
+        vector<int> weight_modes;
+        for (int s = 0; s < start_no; s++) {
+            start_modes.push_back(s);
+        }
+        for (int w = 0; w < weight_no; w++) {
+            weight_modes.push_back(w + 1);
+        }
+        for (int r = 0; r < rounds; r++) {
+            vector<int> value(start_no * weight_no * n);
+            for (size_t i = 0; i < value.size(); i++) {
+                value[i] = dist(mt);
+            }
+            int expected[n];
+            serial_minmax(value, expected);
+            auto eval = [&value](int sm, int wm, int e[]) {
+                for (int i = 0; i < n; i++) {
+                    e[i] = value[(sm * weight_no + wm - 1) * n + i];
+                }
+            };
+            const int threads[] = {1, 3, 8};
+            for (int t = 0; t < 3; t++) {
+                int veq[n];
+                parallel_mode_minmax(eval, start_modes, weight_modes, n,
+                                     threads[t], veq);
+                for (int i = 0; i < n; i++) {
+                    if (veq[i] != expected[i]) {
+                        return false;
+                    }
+                }
+            }
+            vector<int> m(start_no * n, -1);
+            for (int s = 0; s < start_no; s++) {
+                for (int w = 0; w < weight_no; w++) {
+                    for (int i = 0; i < n; i++) {
+                        int e = value[(s * weight_no + w) * n + i];
+                        if (e > m[s * n + i]) {
+                            m[s * n + i] = e;
+                        }
+                    }
+                }
+            }
+            int veq[n];
+            ModeMinMax::fold(&m[0], start_no, n, veq);
+            for (int i = 0; i < n; i++) {
+                if (veq[i] != expected[i]) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool check_atomic()
+    {
+        using namespace std;
+        const int th = 8;
+        const int count = 100000;
+        atomic<int> maximum(-1);
+        atomic<int> minimum(INT_MAX);
+        vector<thread> pool;
+        for (int t = 0; t < th; t++) {
+            pool.push_back(thread([t, &maximum, &minimum]() {
+                        for (int i = 0; i < count; i++) {
+                            int x = i * th + t;
+                            atomic_fetch_max(maximum, x);
+                            atomic_fetch_min(minimum, x);
+                        }
+                    }));
+        }
+        for (int t = 0; t < th; t++) {
+            pool[t].join();
+        }
+        return maximum == th * count - 1 && minimum == 0;
+    }
+
+    bool check_error()
+    {
+        using namespace std;
+        vector<int> start_modes(1, 0);
+        vector<int> weight_modes;
+        for (int w = 1; w <= weight_no; w++) {
+            weight_modes.push_back(w);
+        }
+        auto eval = [](int, int wm, int e[]) {
+            if (wm == 3) {
+                throw new logic_error("check");
+            }
+            e[0] = wm;
+        };
+        int veq;
+        try {
+            parallel_mode_minmax(eval, start_modes, weight_modes, 1, 4,
+                                 &veq);
+        } catch (logic_error * e) {
+            delete e;
+            return true;
+        }
+        return false;
+    }
+
+    bool report(const char * name, bool ok)
+    {
+        using namespace std;
+        cout << name << ": " << (ok ? "ok" : "NG") << endl;
+        return ok;
+    }
+}
+
+int main() {
+    bool ok = true;
+    ok = report("parallel_mode_minmax", check_minmax()) && ok;
+    ok = report("atomic_fetch_max and min", check_atomic()) && ok;
+    ok = report("parallel_mode_minmax error", check_error()) && ok;
+    return ok ? 0 : 1;
+}
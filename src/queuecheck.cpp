@@ -0,0 +1,196 @@
+/**
+ * @file queuecheck.cpp
+ *
+ * @brief check LockFreeQueue and parallel_search(), for make check
+ *
+ * Producers push distinct numbers into a small LockFreeQueue while
+ * consumers pop them, and every number must be popped exactly once.
+ * A ResultQueue of two lines must pass all lines of four producers.
+ * parallel_search() must write count lines when workers find enough
+ * lines, and all lines found when workers end before count.
+ */
+
+#include "devavxprng.h"
+#include "LockFreeQueue.hpp"
+#include "ParallelSearch.hpp"
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+using namespace MTToolBox;
+
+namespace {
+    const int producers = 4;
+    const int consumers = 4;
+    const long per_producer = 100000;
+
+    bool check_single()
+    {
+        LockFreeQueue<long> queue(4);
+        long x;
+        if (queue.pop(x)) {
+            return false;
+        }
+        for (long i = 0; i < 4; i++) {
+            if (!queue.push(i)) {
+                return false;
+            }
+        }
+        if (queue.push(4)) {
+            return false;
+        }
+        for (long i = 0; i < 4; i++) {
+            if (!queue.pop(x) || x != i) {
+                return false;
+            }
+        }
+        if (queue.pop(x)) {
+            return false;
+        }
+        try {
+            LockFreeQueue<long> bad(6);
+            return false;
+        } catch (std::logic_error * e) {
+            delete e;
+        }
+        return true;
+    }
+
+    bool check_mpmc()
+    {
+        using namespace std;
+        const long total = producers * per_producer;
+        LockFreeQueue<long> queue(16);
+        vector<atomic<int> > seen(total);
+        for (long i = 0; i < total; i++) {
+            seen[i] = 0;
+        }
+        atomic<long> popped(0);
+        vector<thread> pool;
+        for (int p = 0; p < producers; p++) {
+            pool.push_back(thread([p, &queue]() {
+                        for (long i = 0; i < per_producer; i++) {
+                            while (!queue.push(p * per_producer + i)) {
+                                this_thread::yield();
+                            }
+                        }
+                    }));
+        }
+        for (int c = 0; c < consumers; c++) {
+            pool.push_back(thread([&queue, &seen, &popped, total]() {
+                        long x;
+                        while (popped < total) {
+                            if (queue.pop(x)) {
+                                seen[x]++;
+                                popped++;
+                            } else {
+                                this_thread::yield();
+                            }
+                        }
+                    }));
+        }
+        for (size_t i = 0; i < pool.size(); i++) {
+            pool[i].join();
+        }
+        for (long i = 0; i < total; i++) {
+            if (seen[i] != 1) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*
+     * producers push into a small ResultQueue, so that both sides
+     * often sleep, and one consumer pops until all producers end.
+     */
+    bool check_result_queue()
+    {
+        using namespace std;
+        const long per = 20000;
+        ResultQueue queue(2);
+        atomic<bool> stop(false);
+        queue.add_producers(producers);
+        vector<thread> pool;
+        for (int p = 0; p < producers; p++) {
+            pool.push_back(thread([&queue, &stop]() {
+                        for (long i = 0; i < per; i++) {
+                            queue.push(new string("x"), stop);
+                        }
+                        queue.producer_end();
+                    }));
+        }
+        long n = 0;
+        string * line;
+        while ((line = queue.pop(stop)) != NULL) {
+            delete line;
+            n++;
+        }
+        for (size_t i = 0; i < pool.size(); i++) {
+            pool[i].join();
+        }
+        return n == producers * per;
+    }
+
+    /*
+     * workers push \b lines lines each, or until stop if lines < 0.
+     */
+    long search_lines(long count, long lines)
+    {
+        using namespace std;
+        auto worker = [lines](int w, ResultQueue& queue,
+                              const atomic<bool>& stop) {
+            for (long i = 0; lines < 0 || i < lines; i++) {
+                if (stop) {
+                    return;
+                }
+                if (!push_result(queue, to_string(w), stop)) {
+                    return;
+                }
+            }
+        };
+        stringstream ss;
+        long written = parallel_search(producers, count, worker, ss);
+        long n = 0;
+        string line;
+        while (getline(ss, line)) {
+            int w = stoi(line);
+            if (w < 0 || w >= producers) {
+                return -1;
+            }
+            n++;
+        }
+        return n == written ? written : -1;
+    }
+
+    bool check_search()
+    {
+        // more lines than the queue holds
+        if (search_lines(1000, -1) != 1000) {
+            return false;
+        }
+        // workers end before count
+        if (search_lines(1000, 10) != producers * 10) {
+            return false;
+        }
+        return search_lines(1000, 0) == 0;
+    }
+
+    bool report(const char * name, bool ok)
+    {
+        using namespace std;
+        cout << name << ": " << (ok ? "ok" : "NG") << endl;
+        return ok;
+    }
+}
+
+int main() {
+    bool ok = true;
+    ok = report("LockFreeQueue", check_single()) && ok;
+    ok = report("LockFreeQueue threads", check_mpmc()) && ok;
+    ok = report("ResultQueue", check_result_queue()) && ok;
+    ok = report("parallel_search", check_search()) && ok;
+    return ok ? 0 : 1;
+}
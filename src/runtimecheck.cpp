@@ -0,0 +1,176 @@
+/**
+ * @file runtimecheck.cpp
+ *
+ * @brief compare libdevavxprng with the search classes, for make check
+ *
+ * For some small mexps and each type of generator, random parameters
+ * and a random parity check vector are given to the search class and,
+ * through the parameter string, to RuntimeGenerator. Outputs of
+ * generate() after period certification are compared with next() and
+ * fill(). The seed is the first one from check_seed whose lung is
+ * fixed by period certification, so the fix is also checked.
+ *
+ * fill() and fill_bytes() of the search classes are compared with
+ * generate() for lengths which are not multiples of the state size
+ * nor of the block of BulkOutput.hpp, and for buffers aligned for non
+ * temporal stores, aligned to 8 bytes and not aligned.
+ */
+
+#include "devavxprng.h"
+#include "RuntimeGenerator.hpp"
+#include "SFMTAVX2search.hpp"
+#include "SFMTAVX512Fsearch.hpp"
+#include "dSFMTAVX2search.hpp"
+#include "dSFMTAVX512Fsearch.hpp"
+#include "PeriodCertification.hpp"
+#include <MTToolBox/MersenneTwister.hpp>
+#include <vector>
+#include <string.h>
+
+using namespace MTToolBox;
+
+namespace {
+    const int mexps[] = {1279, 2281, 4253};
+    const uint64_t check_seed = 4357;
+
+    template<typename G, typename U>
+    bool check_one(G& g, const runtime_param& param, int count)
+    {
+        using namespace std;
+        const int words = sizeof(U) / 8;
+        U seed;
+        setZero(seed);
+        for (seed.u64[0] = check_seed; ; seed.u64[0]++) {
+            g.seed(seed);
+            if (period_certification(g) == 0) {
+                break;
+            }
+        }
+        RuntimeGenerator by_next(param);
+        RuntimeGenerator by_fill(param);
+        by_next.seed(seed.u64[0]);
+        by_fill.seed(seed.u64[0]);
+        vector<uint64_t> filled(count * words);
+        by_fill.fill(&filled[0], count);
+        vector<uint64_t> out(words);
+        for (int i = 0; i < count; i++) {
+            U expected = g.generate();
+            by_next.next(&out[0]);
+            for (int j = 0; j < words; j++) {
+                if (out[j] != expected.u64[j]
+                    || filled[i * words + j] != expected.u64[j]) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /*
+     * pointer to \b offset bytes after a 64-byte boundary in \b raw
+     */
+    unsigned char * aligned_at(std::vector<unsigned char>& raw, int offset)
+    {
+        uintptr_t p = reinterpret_cast<uintptr_t>(&raw[0]);
+        return &raw[0] + ((64 - p % 64) % 64) + offset;
+    }
+
+    template<typename G, typename U>
+    bool check_fill(const G& g)
+    {
+        using namespace std;
+        const int offsets[] = {0, 8, 1};
+        const size_t lengths[] = {1, bulk_block_size - 1,
+                                  static_cast<size_t>(
+                                      g.bitSize() / (sizeof(U) * 8) + 1),
+                                  bulk_block_size * 2 + 3};
+        G by_generate(g);
+        G by_fill(g);
+        for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++) {
+            for (size_t j = 0; j < sizeof(lengths) / sizeof(lengths[0]); j++) {
+                size_t n = lengths[j];
+                size_t nbytes = n * sizeof(U) + 5;
+                vector<unsigned char> raw(nbytes + 64 + offsets[i]);
+                unsigned char * p = aligned_at(raw, offsets[i]);
+                if (offsets[i] % 8 == 0) {
+                    by_fill.fill(reinterpret_cast<U *>(p), n);
+                    nbytes = n * sizeof(U);
+                } else {
+                    by_fill.fill_bytes(p, nbytes);
+                }
+                for (size_t k = 0; k * sizeof(U) < nbytes; k++) {
+                    U expected = by_generate.generate();
+                    size_t m = sizeof(U);
+                    if (nbytes - k * sizeof(U) < m) {
+                        m = nbytes - k * sizeof(U);
+                    }
+                    if (memcmp(p + k * sizeof(U), &expected, m) != 0) {
+                        return false;
+                    }
+                }
+            }
+        }
+        // fill_bytes on an aligned buffer with a tail
+        vector<unsigned char> raw(sizeof(U) * 3 + 64);
+        unsigned char * p = aligned_at(raw, 0);
+        by_fill.fill_bytes(p, sizeof(U) * 2 + 3);
+        for (int k = 0; k < 3; k++) {
+            U expected = by_generate.generate();
+            size_t m = k < 2 ? sizeof(U) : 3;
+            if (memcmp(p + k * sizeof(U), &expected, m) != 0) {
+                return false;
+            }
+        }
+        return by_generate.generate() == by_fill.generate();
+    }
+
+    template<typename G, typename U>
+    bool check(const char * type)
+    {
+        using namespace std;
+        MersenneTwister mt(check_seed);
+        bool ok = true;
+        for (size_t i = 0; i < sizeof(mexps) / sizeof(mexps[0]); i++) {
+            G g(mexps[i]);
+            g.setUpParam(mt);
+            U parity;
+            for (size_t j = 0; j < sizeof(U) / 8; j++) {
+                parity.u64[j] = mt.generate();
+                parity.u64[j] = (parity.u64[j] << 32) | mt.generate();
+            }
+            // the lung is fixed by the search of a bit of parity
+            parity.u64[0] &= ~UINT64_C(1);
+            g.setParityValue(parity);
+            runtime_param param;
+            bool r = parse_runtime_param(param, type, g.getParamString());
+            if (r) {
+                r = check_one<G, U>(g, param, param.size * 3 + 7);
+            }
+            if (r) {
+                r = check_fill<G, U>(g);
+            }
+            cout << type << " mexp = " << dec << mexps[i] << ": "
+                 << (r ? "ok" : "NG") << endl;
+            if (!r) {
+                cout << g.getParamString() << endl;
+                ok = false;
+            }
+        }
+        return ok;
+    }
+}
+
+int main() {
+    using namespace std;
+    bool ok = true;
+    try {
+        ok = check<SFMTAVX2, w256_t>("SFMTAVX2") && ok;
+        ok = check<SFMTAVX512F, w512_t>("SFMTAVX512F") && ok;
+        ok = check<dSFMTAVX2, w256_t>("dSFMTAVX2") && ok;
+        ok = check<dSFMTAVX512F, w512_t>("dSFMTAVX512F") && ok;
+    } catch (std::exception * e) {
+        cerr << e->what() << endl;
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
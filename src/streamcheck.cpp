@@ -0,0 +1,120 @@
+/**
+ * @file streamcheck.cpp
+ *
+ * @brief check streams of the stream id mode of dc tools, for make check
+ *
+ * Parameter sequences of streams are made as dc tools make them, by
+ * setUpParam() with the parameter generator seeded by stream_seed()
+ * and the stream id set. Sequences of different ids must not have a
+ * parameter set in common, and the sequence of an id must be the same
+ * when it is made again. StreamTable must give each id once to
+ * threads and reject an irreducible factor registered before.
+ */
+
+#include "devavxprng.h"
+#include "SFMTAVX2search.hpp"
+#include "dSFMTAVX2search.hpp"
+#include "StreamSearch.hpp"
+#include <MTToolBox/MersenneTwister.hpp>
+#include <MTToolBox/MersenneTwister64.hpp>
+#include <set>
+#include <string>
+
+using namespace MTToolBox;
+using namespace NTL;
+
+namespace {
+    const uint64_t check_seed = 1234;
+    const int mexp = 19937;
+    const long ids = 256;
+    const int params_per_id = 8;
+
+    template<typename G, typename R>
+    std::vector<std::string> param_sequence(long id)
+    {
+        std::vector<std::string> seq;
+        R mt(stream_seed(check_seed, id));
+        G g(mexp);
+        g.setStreamID(id);
+        for (int i = 0; i < params_per_id; i++) {
+            g.setUpParam(mt);
+            seq.push_back(g.getParamString());
+        }
+        return seq;
+    }
+
+    template<typename G, typename R>
+    bool check_sequences()
+    {
+        std::set<std::string> all;
+        for (long id = 0; id < ids; id++) {
+            std::vector<std::string> seq = param_sequence<G, R>(id);
+            if (seq != param_sequence<G, R>(id)) {
+                return false;
+            }
+            for (size_t i = 0; i < seq.size(); i++) {
+                if (!all.insert(seq[i]).second) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool check_table()
+    {
+        const long first = 100;
+        StreamTable table(first, ids);
+        std::vector<std::atomic<int> > taken(ids);
+        for (long i = 0; i < ids; i++) {
+            taken[i] = 0;
+        }
+        auto worker = [&table, &taken](long id) -> bool {
+            taken[id - first]++;
+            table.set_line(id, std::to_string(id));
+            return true;
+        };
+        if (!run_stream_workers(table, worker, 4)) {
+            return false;
+        }
+        for (long i = 0; i < ids; i++) {
+            if (taken[i] != 1) {
+                return false;
+            }
+        }
+        if (table.next_id() != -1) {
+            return false;
+        }
+        GF2X a;
+        GF2X b;
+        SetCoeff(a, 19937);
+        SetCoeff(a, 0);
+        SetCoeff(b, 19937);
+        SetCoeff(b, 1);
+        return table.add_polynomial(a) && table.add_polynomial(b)
+            && !table.add_polynomial(a) && table.get_duplicates() == 1;
+    }
+
+    bool report(const char * name, bool ok)
+    {
+        using namespace std;
+        cout << name << ": " << (ok ? "ok" : "NG") << endl;
+        return ok;
+    }
+}
+
+int main() {
+    using namespace std;
+    bool ok = true;
+    try {
+        ok = report("SFMTAVX2 streams",
+                    check_sequences<SFMTAVX2, MersenneTwister>()) && ok;
+        ok = report("dSFMTAVX2 streams",
+                    check_sequences<dSFMTAVX2, MersenneTwister64>()) && ok;
+        ok = report("stream table", check_table()) && ok;
+    } catch (std::exception * e) {
+        cerr << e->what() << endl;
+        return 1;
+    }
+    return ok ? 0 : 1;
+}